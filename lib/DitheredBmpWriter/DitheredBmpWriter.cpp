@@ -0,0 +1,118 @@
+#include "DitheredBmpWriter.h"
+
+#include <HardwareSerial.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+void write16(Print& out, const uint16_t value) {
+  out.write(value & 0xFF);
+  out.write((value >> 8) & 0xFF);
+}
+
+void write32(Print& out, const uint32_t value) {
+  out.write(value & 0xFF);
+  out.write((value >> 8) & 0xFF);
+  out.write((value >> 16) & 0xFF);
+  out.write((value >> 24) & 0xFF);
+}
+
+void write32Signed(Print& out, const int32_t value) {
+  out.write(value & 0xFF);
+  out.write((value >> 8) & 0xFF);
+  out.write((value >> 16) & 0xFF);
+  out.write((value >> 24) & 0xFF);
+}
+}  // namespace
+
+DitheredBmpWriter::DitheredBmpWriter(Print& out, const int srcWidth, const int srcHeight, const int maxWidth,
+                                     const int maxHeight)
+    : out(out), ditherer(srcWidth, srcHeight, maxWidth, maxHeight) {
+  bytesPerRow = (ditherer.getOutWidth() * 2 + 31) / 32 * 4;
+}
+
+DitheredBmpWriter::~DitheredBmpWriter() { free(rowBuffer); }
+
+// 2-bit BMP header with the four grey level palette
+void DitheredBmpWriter::writeHeader() const {
+  const int outWidth = ditherer.getOutWidth();
+  const int outHeight = ditherer.getOutHeight();
+  const int imageSize = bytesPerRow * outHeight;
+  const uint32_t fileSize = 70 + imageSize;  // 14 (file header) + 40 (DIB header) + 16 (palette) + image
+
+  // BMP File Header (14 bytes)
+  out.write('B');
+  out.write('M');
+  write32(out, fileSize);  // File size
+  write32(out, 0);         // Reserved
+  write32(out, 70);        // Offset to pixel data
+
+  // DIB Header (BITMAPINFOHEADER - 40 bytes)
+  write32(out, 40);
+  write32Signed(out, outWidth);
+  write32Signed(out, -outHeight);  // Negative height = top-down bitmap
+  write16(out, 1);                 // Color planes
+  write16(out, 2);                 // Bits per pixel (2 bits)
+  write32(out, 0);                 // BI_RGB (no compression)
+  write32(out, imageSize);
+  write32(out, 2835);  // xPixelsPerMeter (72 DPI)
+  write32(out, 2835);  // yPixelsPerMeter (72 DPI)
+  write32(out, 4);     // colorsUsed
+  write32(out, 4);     // colorsImportant
+
+  // Color Palette (4 colors x 4 bytes = 16 bytes)
+  // Format: Blue, Green, Red, Reserved (BGRA)
+  uint8_t palette[16] = {
+      0x00, 0x00, 0x00, 0x00,  // Color 0: Black
+      0x55, 0x55, 0x55, 0x00,  // Color 1: Dark gray (85)
+      0xAA, 0xAA, 0xAA, 0x00,  // Color 2: Light gray (170)
+      0xFF, 0xFF, 0xFF, 0x00   // Color 3: White
+  };
+  for (const uint8_t i : palette) {
+    out.write(i);
+  }
+}
+
+bool DitheredBmpWriter::begin() {
+  if (!ditherer.begin()) {
+    return false;
+  }
+
+  // Packed 2-bit output row
+  rowBuffer = static_cast<uint8_t*>(malloc(bytesPerRow));
+  if (!rowBuffer) {
+    Serial.printf("[%lu] [BMP] Failed to allocate conversion buffers\n", millis());
+    return false;
+  }
+
+  const int srcWidth = ditherer.getSrcWidth();
+  const int srcHeight = ditherer.getSrcHeight();
+  if (ditherer.getOutWidth() != srcWidth || ditherer.getOutHeight() != srcHeight) {
+    Serial.printf("[%lu] [BMP] Scaling %dx%d to %dx%d\n", millis(), srcWidth, srcHeight, ditherer.getOutWidth(),
+                  ditherer.getOutHeight());
+  }
+  writeHeader();
+  return true;
+}
+
+void DitheredBmpWriter::writeRow(const uint8_t* luminance) {
+  const uint8_t* levels = ditherer.addRow(luminance);
+  if (levels) {
+    writeLevels(levels);
+  }
+}
+
+void DitheredBmpWriter::writeLevels(const uint8_t* levels) {
+  // Pack 4 pixels per byte (2 bits each)
+  memset(rowBuffer, 0, bytesPerRow);
+  for (int outX = 0; outX < ditherer.getOutWidth(); outX++) {
+    const int byteIndex = (outX * 2) / 8;
+    const int bitOffset = 6 - ((outX * 2) % 8);  // 6, 4, 2, 0
+    rowBuffer[byteIndex] |= (levels[outX] << bitOffset);
+  }
+
+  // Write row with padding
+  out.write(rowBuffer, bytesPerRow);
+}
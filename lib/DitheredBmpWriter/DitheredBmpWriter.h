@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Print.h>
+
+#include <cstdint>
+
+#include "GreyDitherer.h"
+
+// Writes a top-down 2-bit BMP from 8-bit luminance rows fed in source order. Rows are scaled down and dithered by a
+// GreyDitherer, so only one output row of state is kept regardless of the source size.
+class DitheredBmpWriter {
+  Print& out;
+  GreyDitherer ditherer;
+  int bytesPerRow = 0;
+  uint8_t* rowBuffer = nullptr;
+
+  void writeHeader() const;
+  void writeLevels(const uint8_t* levels);
+
+ public:
+  DitheredBmpWriter(Print& out, int srcWidth, int srcHeight, int maxWidth, int maxHeight);
+  ~DitheredBmpWriter();
+  DitheredBmpWriter(const DitheredBmpWriter&) = delete;
+  DitheredBmpWriter& operator=(const DitheredBmpWriter&) = delete;
+
+  // Allocates the row state and writes the BMP headers
+  bool begin();
+  // Feeds the next source row, srcWidth luminance values
+  void writeRow(const uint8_t* luminance);
+  int getOutWidth() const { return ditherer.getOutWidth(); }
+  int getOutHeight() const { return ditherer.getOutHeight(); }
+};
@@ -0,0 +1,94 @@
+#include "GreyDitherer.h"
+
+#include <HardwareSerial.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+GreyDitherer::GreyDitherer(const int srcWidth, const int srcHeight, const int maxWidth, const int maxHeight)
+    : srcWidth(srcWidth), srcHeight(srcHeight) {
+  // Work out the output size, only ever scaling down
+  float scale = 1.0f;
+  if (maxWidth > 0 && srcWidth > maxWidth) {
+    scale = static_cast<float>(maxWidth) / static_cast<float>(srcWidth);
+  }
+  if (maxHeight > 0 && srcHeight > maxHeight) {
+    scale = std::min(scale, static_cast<float>(maxHeight) / static_cast<float>(srcHeight));
+  }
+  outWidth = std::max(1, static_cast<int>(srcWidth * scale));
+  outHeight = std::max(1, static_cast<int>(srcHeight * scale));
+}
+
+GreyDitherer::~GreyDitherer() {
+  free(levels);
+  free(accumulator);
+  free(errorRows);
+}
+
+bool GreyDitherer::begin() {
+  if (srcWidth <= 0 || srcHeight <= 0) {
+    Serial.printf("[%lu] [DTH] Invalid source size %dx%d\n", millis(), srcWidth, srcHeight);
+    return false;
+  }
+
+  // One output row of levels, box filter sums for one output row, and Floyd-Steinberg error (scaled by 16) for the
+  // output row being dithered and the next one, padded by a pixel on each side
+  levels = static_cast<uint8_t*>(malloc(outWidth));
+  accumulator = static_cast<uint32_t*>(calloc(outWidth, sizeof(uint32_t)));
+  errorRows = static_cast<int16_t*>(calloc(2 * (outWidth + 2), sizeof(int16_t)));
+  if (!levels || !accumulator || !errorRows) {
+    Serial.printf("[%lu] [DTH] Failed to allocate dither buffers\n", millis());
+    return false;
+  }
+  currentError = errorRows;
+  nextError = errorRows + outWidth + 2;
+  return true;
+}
+
+const uint8_t* GreyDitherer::addRow(const uint8_t* luminance) {
+  if (srcRow >= srcHeight || outRow >= outHeight) {
+    return nullptr;
+  }
+
+  // Box filter: every output column sums the source columns that fall into it
+  for (int outX = 0, srcX = 0; outX < outWidth; outX++) {
+    const int srcEnd = (outX + 1) * srcWidth / outWidth;
+    uint32_t sum = 0;
+    for (; srcX < srcEnd; srcX++) {
+      sum += luminance[srcX];
+    }
+    accumulator[outX] += sum;
+  }
+  rowsAccumulated++;
+  srcRow++;
+
+  // Keep accumulating until the last source row of this output row
+  if (srcRow < (outRow + 1) * srcHeight / outHeight) {
+    return nullptr;
+  }
+  ditherRow();
+  return levels;
+}
+
+void GreyDitherer::ditherRow() {
+  for (int outX = 0; outX < outWidth; outX++) {
+    const int colSpan = (outX + 1) * srcWidth / outWidth - outX * srcWidth / outWidth;
+    const int average = static_cast<int>(accumulator[outX] / (colSpan * rowsAccumulated));
+
+    const int value = std::max(0, std::min(255, average + currentError[outX + 1] / 16));
+    const uint8_t level = (value + 42) / 85;
+    const int error = value - level * 85;
+    currentError[outX + 2] += error * 7;
+    nextError[outX] += error * 3;
+    nextError[outX + 1] += error * 5;
+    nextError[outX + 2] += error;
+    levels[outX] = level;
+  }
+
+  std::swap(currentError, nextError);
+  memset(nextError, 0, (outWidth + 2) * sizeof(int16_t));
+  memset(accumulator, 0, outWidth * sizeof(uint32_t));
+  rowsAccumulated = 0;
+  outRow++;
+}
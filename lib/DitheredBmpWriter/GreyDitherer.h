@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Box-filters 8-bit luminance rows fed in source order down to fit within the requested size (never scaled up) and
+// Floyd-Steinberg dithers them to the 4 grey levels, one output row at a time. Shared by the BMP writer and the
+// renderer so images look the same whether they're converted or drawn straight to the screen.
+class GreyDitherer {
+  int srcWidth;
+  int srcHeight;
+  int outWidth = 0;
+  int outHeight = 0;
+  int srcRow = 0;
+  int outRow = 0;
+  int rowsAccumulated = 0;
+  uint8_t* levels = nullptr;
+  uint32_t* accumulator = nullptr;
+  int16_t* errorRows = nullptr;
+  int16_t* currentError = nullptr;
+  int16_t* nextError = nullptr;
+
+  void ditherRow();
+
+ public:
+  GreyDitherer(int srcWidth, int srcHeight, int maxWidth, int maxHeight);
+  ~GreyDitherer();
+  GreyDitherer(const GreyDitherer&) = delete;
+  GreyDitherer& operator=(const GreyDitherer&) = delete;
+
+  // Allocates the row state, false if the source size is invalid or there isn't enough memory
+  bool begin();
+  // Feeds the next source row, srcWidth luminance values. Returns the next output row's levels (outWidth values,
+  // 0 = black, 1 = dark gray, 2 = light gray, 3 = white) once its last source row is in, null until then.
+  const uint8_t* addRow(const uint8_t* luminance);
+  int getSrcWidth() const { return srcWidth; }
+  int getSrcHeight() const { return srcHeight; }
+  int getOutWidth() const { return outWidth; }
+  int getOutHeight() const { return outHeight; }
+  // Output rows returned so far
+  int getOutRow() const { return outRow; }
+};
@@ -57,16 +57,38 @@ bool EpdFont::hasPrintableChars(const char* string) const {
   return w > 0 || h > 0;
 }
 
-const EpdGlyph* EpdFont::getGlyph(const uint32_t cp) const {
+// Intervals are sorted and non-overlapping (see fontconvert.py), so binary search for the last interval starting at
+// or before the code point
+const EpdGlyph* EpdFont::findGlyphInIntervals(const uint32_t cp) const {
   const EpdUnicodeInterval* intervals = data->intervals;
-  for (int i = 0; i < data->intervalCount; i++) {
-    const EpdUnicodeInterval* interval = &intervals[i];
-    if (cp >= interval->first && cp <= interval->last) {
-      return &data->glyph[interval->offset + (cp - interval->first)];
-    }
-    if (cp < interval->first) {
-      return nullptr;
+  uint32_t low = 0;
+  uint32_t high = data->intervalCount;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    if (intervals[mid].first <= cp) {
+      low = mid + 1;
+    } else {
+      high = mid;
     }
   }
-  return nullptr;
+
+  if (low == 0) {
+    return nullptr;
+  }
+
+  const EpdUnicodeInterval* interval = &intervals[low - 1];
+  if (cp > interval->last) {
+    return nullptr;
+  }
+  return &data->glyph[interval->offset + (cp - interval->first)];
+}
+
+const EpdGlyph* EpdFont::getGlyph(const uint32_t cp) const {
+  // Fonts generated before fontconvert.py emitted the table fall back to the interval search
+  if (cp < LATIN1_LOOKUP_SIZE && data->latin1Lookup) {
+    const uint16_t index = data->latin1Lookup[cp];
+    return index == EPD_FONT_NO_GLYPH ? nullptr : &data->glyph[index];
+  }
+
+  return findGlyphInIntervals(cp);
 }
@@ -2,7 +2,10 @@
 #include "EpdFontData.h"
 
 class EpdFont {
+  static constexpr uint32_t LATIN1_LOOKUP_SIZE = 0x100;
+
   void getTextBounds(const char* string, int startX, int startY, int* minX, int* minY, int* maxX, int* maxY) const;
+  const EpdGlyph* findGlyphInIntervals(uint32_t cp) const;
 
  public:
   const EpdFontData* data;
@@ -22,6 +22,9 @@ typedef struct {
   uint32_t offset;  ///< Index of the first code point into the glyph array
 } EpdUnicodeInterval;
 
+/// Sentinel used in `EpdFontData::latin1Lookup` for code points without a glyph
+constexpr uint16_t EPD_FONT_NO_GLYPH = 0xFFFF;
+
 /// Data stored for FONT AS A WHOLE
 typedef struct {
   const uint8_t* bitmap;                ///< Glyph bitmaps, concatenated
@@ -32,4 +35,5 @@ typedef struct {
   int ascender;                         ///< Maximal height of a glyph above the base line
   int descender;                        ///< Maximal height of a glyph below the base line
   bool is2Bit;
+  const uint16_t* latin1Lookup;  ///< Glyph index per code point U+0000-U+00FF, in flash, may be null
 } EpdFontData;
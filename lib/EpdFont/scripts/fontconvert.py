@@ -285,6 +285,22 @@ for i_start, i_end in intervals:
     offset += i_end - i_start + 1
 print ("};\n");
 
+# glyph index per code point U+0000-U+00FF, 0xFFFF (EPD_FONT_NO_GLYPH) where the font has no glyph. Kept in flash so
+# EpdFont can index Latin-1 directly without building the table in RAM.
+if len(glyph_props) >= 0xFFFF:
+    print("too many glyphs for a 16-bit latin1 lookup table!", file=sys.stderr)
+    sys.exit(1)
+latin1_lookup = [0xFFFF] * 0x100
+offset = 0
+for i_start, i_end in intervals:
+    for code_point in range(i_start, min(i_end, 0xFF) + 1):
+        latin1_lookup[code_point] = offset + code_point - i_start
+    offset += i_end - i_start + 1
+print(f"static const uint16_t {font_name}Latin1Lookup[256] = {{")
+for c in chunks(latin1_lookup, 16):
+    print ("    " + " ".join(f"0x{b:04X}," for b in c))
+print ("};\n");
+
 print(f"static const EpdFontData {font_name} = {{")
 print(f"    {font_name}Bitmaps,")
 print(f"    {font_name}Glyphs,")
@@ -294,4 +310,5 @@ print(f"    {norm_ceil(face.size.height)},")
 print(f"    {norm_ceil(face.size.ascender)},")
 print(f"    {norm_floor(face.size.descender)},")
 print(f"    {'true' if is2Bit else 'false'},")
+print(f"    {font_name}Latin1Lookup,")
 print("};")
@@ -1,15 +1,30 @@
 #include "Epub.h"
 
 #include <FsHelpers.h>
+#include <GifToBmpConverter.h>
 #include <HardwareSerial.h>
 #include <JpegToBmpConverter.h>
+#include <PngToBmpConverter.h>
 #include <SD.h>
 #include <ZipFile.h>
 
+#include "Epub/CssRuleTable.h"
+#include "Epub/Page.h"
 #include "Epub/parsers/ContainerParser.h"
 #include "Epub/parsers/ContentOpfParser.h"
+#include "Epub/parsers/CssParser.h"
+#include "Epub/parsers/TocNavParser.h"
 #include "Epub/parsers/TocNcxParser.h"
 
+namespace {
+// Covers are scaled down to the portrait screen size while decoding
+constexpr int COVER_MAX_WIDTH = 480;
+constexpr int COVER_MAX_HEIGHT = 800;
+// Thumbnails are fit to this box, from the DC coefficients only (1/8 scale) when the cover is big enough for that
+constexpr int THUMB_MAX_WIDTH = 200;
+constexpr int THUMB_MAX_HEIGHT = 300;
+}  // namespace
+
 bool Epub::findContentOpfFile(std::string* contentOpfFile) const {
   const auto containerPath = "META-INF/container.xml";
   size_t containerSize;
@@ -82,6 +97,10 @@ bool Epub::parseContentOpf(BookMetadataCache::BookMetadata& bookMetadata) {
   if (!opfParser.tocNcxPath.empty()) {
     tocNcxItem = opfParser.tocNcxPath;
   }
+  if (!opfParser.tocNavPath.empty()) {
+    tocNavItem = opfParser.tocNavPath;
+  }
+  stylesheetItems = std::move(opfParser.stylesheetPaths);
 
   Serial.printf("[%lu] [EBP] Successfully parsed content.opf\n", millis());
   return true;
@@ -96,17 +115,11 @@ bool Epub::parseTocNcxFile() const {
 
   Serial.printf("[%lu] [EBP] Parsing toc ncx file: %s\n", millis(), tocNcxItem.c_str());
 
-  const auto tmpNcxPath = getCachePath() + "/toc.ncx";
-  File tempNcxFile;
-  if (!FsHelpers::openFileForWrite("EBP", tmpNcxPath, tempNcxFile)) {
-    return false;
-  }
-  readItemContentsToStream(tocNcxItem, tempNcxFile, 1024);
-  tempNcxFile.close();
-  if (!FsHelpers::openFileForRead("EBP", tmpNcxPath, tempNcxFile)) {
+  size_t ncxSize;
+  if (!getItemSize(tocNcxItem, &ncxSize)) {
+    Serial.printf("[%lu] [EBP] Could not get size of toc ncx\n", millis());
     return false;
   }
-  const auto ncxSize = tempNcxFile.size();
 
   TocNcxParser ncxParser(contentBasePath, ncxSize, bookMetadataCache.get());
 
@@ -115,32 +128,56 @@ bool Epub::parseTocNcxFile() const {
     return false;
   }
 
-  const auto ncxBuffer = static_cast<uint8_t*>(malloc(1024));
-  if (!ncxBuffer) {
-    Serial.printf("[%lu] [EBP] Could not allocate memory for toc ncx parser\n", millis());
+  if (!readItemContentsToStream(tocNcxItem, ncxParser, 1024)) {
+    Serial.printf("[%lu] [EBP] Could not read toc ncx\n", millis());
     return false;
   }
 
-  while (tempNcxFile.available()) {
-    const auto readSize = tempNcxFile.read(ncxBuffer, 1024);
-    const auto processedSize = ncxParser.write(ncxBuffer, readSize);
+  Serial.printf("[%lu] [EBP] Parsed TOC items\n", millis());
+  return true;
+}
 
-    if (processedSize != readSize) {
-      Serial.printf("[%lu] [EBP] Could not process all toc ncx data\n", millis());
-      free(ncxBuffer);
-      tempNcxFile.close();
-      return false;
-    }
+bool Epub::parseTocNavFile() const {
+  Serial.printf("[%lu] [EBP] Parsing toc nav file: %s\n", millis(), tocNavItem.c_str());
+
+  size_t navSize;
+  if (!getItemSize(tocNavItem, &navSize)) {
+    Serial.printf("[%lu] [EBP] Could not get size of toc nav\n", millis());
+    return false;
   }
 
-  free(ncxBuffer);
-  tempNcxFile.close();
-  SD.remove(tmpNcxPath.c_str());
+  const auto navBasePath = tocNavItem.substr(0, tocNavItem.find_last_of('/') + 1);
+  TocNavParser navParser(navBasePath, navSize, bookMetadataCache.get());
 
-  Serial.printf("[%lu] [EBP] Parsed TOC items\n", millis());
+  if (!navParser.setup()) {
+    Serial.printf("[%lu] [EBP] Could not setup toc nav parser\n", millis());
+    return false;
+  }
+
+  if (!readItemContentsToStream(tocNavItem, navParser, 1024)) {
+    Serial.printf("[%lu] [EBP] Could not read toc nav\n", millis());
+    return false;
+  }
+
+  Serial.printf("[%lu] [EBP] Parsed TOC nav items\n", millis());
   return true;
 }
 
+// Compiles the supported subset of every stylesheet into one rule table, later stylesheets override earlier ones
+bool Epub::buildCssRuleTable() const {
+  CssRuleTable rules;
+  for (const auto& stylesheet : stylesheetItems) {
+    CssParser cssParser(&rules);
+    if (!readItemContentsToStream(stylesheet, cssParser, 1024)) {
+      Serial.printf("[%lu] [EBP] Could not read stylesheet %s - skipping\n", millis(), stylesheet.c_str());
+    }
+  }
+
+  Serial.printf("[%lu] [EBP] Parsed %u CSS rules from %u stylesheets\n", millis(),
+                static_cast<unsigned>(rules.getPendingRuleCount()), static_cast<unsigned>(stylesheetItems.size()));
+  return rules.writeToFile(getCssRuleTablePath());
+}
+
 // load in the meta data for the epub file
 bool Epub::load() {
   Serial.printf("[%lu] [EBP] Loading ePub: %s\n", millis(), filepath.c_str());
@@ -179,14 +216,30 @@ bool Epub::load() {
     return false;
   }
 
+  // Stylesheet pass, books render fine without their styles so failures aren't fatal
+  if (!buildCssRuleTable()) {
+    Serial.printf("[%lu] [EBP] Could not build CSS rule table - ignoring\n", millis());
+  }
+
   // TOC Pass
   if (!bookMetadataCache->beginTocPass()) {
     Serial.printf("[%lu] [EBP] Could not begin writing toc pass\n", millis());
     return false;
   }
-  if (!parseTocNcxFile()) {
-    Serial.printf("[%lu] [EBP] Could not parse toc\n", millis());
-    return false;
+  // Prefer the ncx when a book has both, books without either just have no chapter list
+  if (!tocNcxItem.empty()) {
+    if (!parseTocNcxFile()) {
+      Serial.printf("[%lu] [EBP] Could not parse toc\n", millis());
+      return false;
+    }
+  } else if (!tocNavItem.empty()) {
+    // nav documents are XHTML and often not well formed XML, e.g. an undeclared &nbsp;, the book still reads fine
+    if (!parseTocNavFile()) {
+      Serial.printf("[%lu] [EBP] Could not parse toc nav - continuing without a toc\n", millis());
+      bookMetadataCache->discardTocEntries();
+    }
+  } else {
+    Serial.printf("[%lu] [EBP] No ncx or nav toc found, continuing without a toc\n", millis());
   }
   if (!bookMetadataCache->endTocPass()) {
     Serial.printf("[%lu] [EBP] Could not end writing toc pass\n", millis());
@@ -221,6 +274,7 @@ bool Epub::load() {
 }
 
 bool Epub::clearCache() const {
+  PageImage::closeOpenFile();
   if (!SD.exists(cachePath.c_str())) {
     Serial.printf("[%lu] [EPB] Cache does not exist, no action needed\n", millis());
     return true;
@@ -251,6 +305,8 @@ void Epub::setupCacheDir() const {
 
 const std::string& Epub::getCachePath() const { return cachePath; }
 
+std::string Epub::getCssRuleTablePath() const { return cachePath + "/css.bin"; }
+
 const std::string& Epub::getPath() const { return filepath; }
 
 const std::string& Epub::getTitle() const {
@@ -270,6 +326,28 @@ bool Epub::generateCoverBmp() const {
     return true;
   }
 
+  return generateBmpFromCover(getCoverBmpPath(), false);
+}
+
+std::string Epub::getThumbBmpPath() const { return cachePath + "/thumb.bmp"; }
+
+bool Epub::isThumbBmpCurrent() const {
+  if (!bookMetadataCache || !SD.exists(getThumbBmpPath().c_str())) {
+    return false;
+  }
+
+  // Both files are written by the device, so their times come from the same clock
+  File thumb = SD.open(getThumbBmpPath().c_str());
+  File bookBin = SD.open(bookMetadataCache->getBookBinPath().c_str());
+  const bool current = thumb && thumb.size() > 0 && (!bookBin || thumb.getLastWrite() >= bookBin.getLastWrite());
+  thumb.close();
+  bookBin.close();
+  return current;
+}
+
+bool Epub::generateThumbBmp() const { return generateBmpFromCover(getThumbBmpPath(), true); }
+
+bool Epub::generateBmpFromCover(const std::string& bmpPath, const bool thumbnail) const {
   if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
     Serial.printf("[%lu] [EBP] Cannot generate cover BMP, cache not loaded\n", millis());
     return false;
@@ -281,47 +359,84 @@ bool Epub::generateCoverBmp() const {
     return false;
   }
 
-  if (coverImageHref.substr(coverImageHref.length() - 4) == ".jpg" ||
-      coverImageHref.substr(coverImageHref.length() - 5) == ".jpeg") {
-    Serial.printf("[%lu] [EBP] Generating BMP from JPG cover image\n", millis());
-    const auto coverJpgTempPath = getCachePath() + "/.cover.jpg";
+  Serial.printf("[%lu] [EBP] Generating BMP from cover image %s\n", millis(), coverImageHref.c_str());
 
-    File coverJpg;
-    if (!FsHelpers::openFileForWrite("EBP", coverJpgTempPath, coverJpg)) {
-      return false;
-    }
-    readItemContentsToStream(coverImageHref, coverJpg, 1024);
-    coverJpg.close();
+  File coverBmp;
+  if (!FsHelpers::openFileForWrite("EBP", bmpPath, coverBmp)) {
+    return false;
+  }
+
+  const bool success =
+      thumbnail ? convertImageToBmp(coverImageHref, coverBmp, THUMB_MAX_WIDTH, THUMB_MAX_HEIGHT, true)
+                : convertImageToBmp(coverImageHref, coverBmp, COVER_MAX_WIDTH, COVER_MAX_HEIGHT);
+  coverBmp.close();
 
-    if (!FsHelpers::openFileForRead("EBP", coverJpgTempPath, coverJpg)) {
+  if (!success) {
+    Serial.printf("[%lu] [EBP] Failed to generate BMP from cover image\n", millis());
+    SD.remove(bmpPath.c_str());
+  }
+  Serial.printf("[%lu] [EBP] Generated BMP from cover image, success: %s\n", millis(), success ? "yes" : "no");
+  return success;
+}
+
+bool Epub::convertImageToBmp(const std::string& itemHref, Print& bmpOut, const int maxWidth, const int maxHeight,
+                             const bool thumbnail) const {
+  const auto hasExtension = [&itemHref](const char* extension) {
+    const size_t length = strlen(extension);
+    if (itemHref.length() < length) {
       return false;
     }
+    for (size_t i = 0; i < length; i++) {
+      if (tolower(static_cast<unsigned char>(itemHref[itemHref.length() - length + i])) != extension[i]) {
+        return false;
+      }
+    }
+    return true;
+  };
+  const bool isJpg = hasExtension(".jpg") || hasExtension(".jpeg");
+  const bool isPng = hasExtension(".png");
+  const bool isGif = hasExtension(".gif");
+  if (!isJpg && !isPng && !isGif) {
+    Serial.printf("[%lu] [EBP] Image %s is not a JPG, PNG or GIF, skipping\n", millis(), itemHref.c_str());
+    return false;
+  }
 
-    File coverBmp;
-    if (!FsHelpers::openFileForWrite("EBP", getCoverBmpPath(), coverBmp)) {
-      coverJpg.close();
+  // Decode straight out of the archive so the image is never written to the SD card as a temp file
+  const ZipFile zip(SD_MOUNT_POINT + filepath);
+  const std::string path = FsHelpers::normalisePath(itemHref);
+  ZipFile::EntryStream image;
+  if (!image.open(zip, path.c_str(), 1024)) {
+    return false;
+  }
+
+  // Only JPEG has a cheap reduced decode, the others decode in full and scale down to the thumbnail size
+  bool success;
+  if (isPng) {
+    success = PngToBmpConverter::pngStreamToBmpStream(image, bmpOut, maxWidth, maxHeight);
+  } else if (isGif) {
+    success = GifToBmpConverter::gifStreamToBmpStream(image, bmpOut, maxWidth, maxHeight);
+  } else if (thumbnail) {
+    // picojpeg only has the 1/8 DC decode and the full one, covers under 8 times the box get the full decode so the
+    // thumbnail isn't undersized. The header is read from a first pass over the entry.
+    int width;
+    int height;
+    const bool reduced = JpegToBmpConverter::readJpegSize(image, &width, &height) &&
+                         JpegToBmpConverter::thumbnailDecodeFills(width, height, maxWidth, maxHeight);
+    image.close();
+    if (!image.open(zip, path.c_str(), 1024)) {
       return false;
     }
-    const bool success = JpegToBmpConverter::jpegFileToBmpStream(coverJpg, coverBmp);
-    coverJpg.close();
-    coverBmp.close();
-    SD.remove(coverJpgTempPath.c_str());
-
-    if (!success) {
-      Serial.printf("[%lu] [EBP] Failed to generate BMP from JPG cover image\n", millis());
-      SD.remove(getCoverBmpPath().c_str());
-    }
-    Serial.printf("[%lu] [EBP] Generated BMP from JPG cover image, success: %s\n", millis(), success ? "yes" : "no");
-    return success;
+    success = reduced ? JpegToBmpConverter::jpegFileToThumbnailBmpStream(image, bmpOut, maxWidth, maxHeight)
+                      : JpegToBmpConverter::jpegFileToBmpStream(image, bmpOut, maxWidth, maxHeight);
   } else {
-    Serial.printf("[%lu] [EBP] Cover image is not a JPG, skipping\n", millis());
+    success = JpegToBmpConverter::jpegFileToBmpStream(image, bmpOut, maxWidth, maxHeight);
   }
-
-  return false;
+  image.close();
+  return success;
 }
 
 uint8_t* Epub::readItemContentsToBytes(const std::string& itemHref, size_t* size, const bool trailingNullByte) const {
-  const ZipFile zip("/sd" + filepath);
+  const ZipFile zip(SD_MOUNT_POINT + filepath);
   const std::string path = FsHelpers::normalisePath(itemHref);
 
   const auto content = zip.readFileToMemory(path.c_str(), size, trailingNullByte);
@@ -334,14 +449,25 @@ uint8_t* Epub::readItemContentsToBytes(const std::string& itemHref, size_t* size
 }
 
 bool Epub::readItemContentsToStream(const std::string& itemHref, Print& out, const size_t chunkSize) const {
-  const ZipFile zip("/sd" + filepath);
+  const ZipFile zip(SD_MOUNT_POINT + filepath);
   const std::string path = FsHelpers::normalisePath(itemHref);
 
   return zip.readFileToStream(path.c_str(), out, chunkSize);
 }
 
+std::unique_ptr<Stream> Epub::openItemStream(const std::string& itemHref, const size_t chunkSize) const {
+  const ZipFile zip(SD_MOUNT_POINT + filepath);
+  std::unique_ptr<ZipFile::EntryStream> stream(new ZipFile::EntryStream());
+  // The stream keeps its own file handle, so it outlives the ZipFile
+  if (!stream->open(zip, FsHelpers::normalisePath(itemHref).c_str(), chunkSize)) {
+    Serial.printf("[%lu] [EBP] Failed to open item %s\n", millis(), itemHref.c_str());
+    return nullptr;
+  }
+  return stream;
+}
+
 bool Epub::getItemSize(const std::string& itemHref, size_t* size) const {
-  const ZipFile zip("/sd" + filepath);
+  const ZipFile zip(SD_MOUNT_POINT + filepath);
   return getItemSize(zip, itemHref, size);
 }
 
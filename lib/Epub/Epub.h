@@ -7,11 +7,16 @@
 
 #include "Epub/BookMetadataCache.h"
 
+class Stream;
 class ZipFile;
 
 class Epub {
   // the ncx file
   std::string tocNcxItem;
+  // the EPUB 3 navigation document, only used when there is no ncx file
+  std::string tocNavItem;
+  // stylesheets from the manifest, in manifest order
+  std::vector<std::string> stylesheetItems;
   // where is the EPUBfile?
   std::string filepath;
   // the base path for items in the EPUB file
@@ -24,7 +29,10 @@ class Epub {
   bool findContentOpfFile(std::string* contentOpfFile) const;
   bool parseContentOpf(BookMetadataCache::BookMetadata& bookMetadata);
   bool parseTocNcxFile() const;
+  bool parseTocNavFile() const;
+  bool buildCssRuleTable() const;
   static bool getItemSize(const ZipFile& zip, const std::string& itemHref, size_t* size);
+  bool generateBmpFromCover(const std::string& bmpPath, bool thumbnail) const;
 
  public:
   explicit Epub(std::string filepath, const std::string& cacheDir) : filepath(std::move(filepath)) {
@@ -37,13 +45,23 @@ class Epub {
   bool clearCache() const;
   void setupCacheDir() const;
   const std::string& getCachePath() const;
+  std::string getCssRuleTablePath() const;
   const std::string& getPath() const;
   const std::string& getTitle() const;
   std::string getCoverBmpPath() const;
   bool generateCoverBmp() const;
+  std::string getThumbBmpPath() const;
+  // False if the thumbnail is missing, empty or older than the metadata its cover was picked from
+  bool isThumbBmpCurrent() const;
+  bool generateThumbBmp() const;
+  // Decodes a JPG, PNG or GIF item into a dithered 2-bit BMP that fits within maxWidth x maxHeight
+  bool convertImageToBmp(const std::string& itemHref, Print& bmpOut, int maxWidth, int maxHeight,
+                         bool thumbnail = false) const;
   uint8_t* readItemContentsToBytes(const std::string& itemHref, size_t* size = nullptr,
                                    bool trailingNullByte = false) const;
   bool readItemContentsToStream(const std::string& itemHref, Print& out, size_t chunkSize) const;
+  // Inflates the item as it's read instead of extracting it first, null if it can't be opened
+  std::unique_ptr<Stream> openItemStream(const std::string& itemHref, size_t chunkSize) const;
   bool getItemSize(const std::string& itemHref, size_t* size) const;
   BookMetadataCache::SpineEntry getSpineItem(int spineIndex) const;
   BookMetadataCache::TocEntry getTocItem(int tocIndex) const;
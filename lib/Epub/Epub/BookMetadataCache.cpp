@@ -10,7 +10,7 @@
 #include "FsHelpers.h"
 
 namespace {
-constexpr uint8_t BOOK_CACHE_VERSION = 1;
+constexpr uint8_t BOOK_CACHE_VERSION = 3;
 constexpr char bookBinFile[] = "/book.bin";
 constexpr char tmpSpineBinFile[] = "/spine.bin.tmp";
 constexpr char tmpTocBinFile[] = "/toc.bin.tmp";
@@ -52,6 +52,12 @@ bool BookMetadataCache::beginTocPass() {
   return true;
 }
 
+void BookMetadataCache::discardTocEntries() {
+  // Entries past tocCount are never read back
+  tocFile.seek(0);
+  tocCount = 0;
+}
+
 bool BookMetadataCache::endTocPass() {
   tocFile.close();
   spineFile.close();
@@ -122,7 +128,7 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
   // LUTs complete
   // Loop through spines from spine file matching up TOC indexes, calculating cumulative size and writing to book.bin
 
-  const ZipFile zip("/sd" + epubPath);
+  const ZipFile zip(SD_MOUNT_POINT + epubPath);
   size_t cumSize = 0;
   spineFile.seek(0);
   for (int i = 0; i < spineCount; i++) {
@@ -243,6 +249,8 @@ void BookMetadataCache::createTocEntry(const std::string& title, const std::stri
 
 /* ============= READING / LOADING FUNCTIONS ================ */
 
+std::string BookMetadataCache::getBookBinPath() const { return cachePath + bookBinFile; }
+
 bool BookMetadataCache::load() {
   if (!FsHelpers::openFileForRead("BMC", cachePath + bookBinFile, bookFile)) {
     return false;
@@ -71,6 +71,8 @@ class BookMetadataCache {
   bool beginTocPass();
   void createTocEntry(const std::string& title, const std::string& href, const std::string& anchor, uint8_t level);
   bool endTocPass();
+  // Drops the entries written so far in this toc pass
+  void discardTocEntries();
   bool endWrite();
   bool cleanupTmpFiles() const;
 
@@ -79,6 +81,7 @@ class BookMetadataCache {
 
   // Reading phase (read mode)
   bool load();
+  std::string getBookBinPath() const;
   SpineEntry getSpineEntry(int index);
   TocEntry getTocEntry(int index);
   int getSpineCount() const { return spineCount; }
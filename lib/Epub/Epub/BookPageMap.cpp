@@ -0,0 +1,147 @@
+#include "BookPageMap.h"
+
+#include <FsHelpers.h>
+#include <HardwareSerial.h>
+#include <SD.h>
+#include <Serialization.h>
+
+#include <cstring>
+
+#include "../Epub.h"
+
+namespace {
+constexpr uint8_t PAGE_MAP_VERSION = 1;
+}
+
+uint32_t BookPageMap::computeLayoutHash(const int fontId, const float lineCompression, const int marginTop,
+                                        const int marginRight, const int marginBottom, const int marginLeft,
+                                        const bool extraParagraphSpacing) {
+  uint8_t bytes[sizeof(int) * 5 + sizeof(float) + 1];
+  size_t length = 0;
+  for (const int value : {fontId, marginTop, marginRight, marginBottom, marginLeft}) {
+    memcpy(bytes + length, &value, sizeof(value));
+    length += sizeof(value);
+  }
+  memcpy(bytes + length, &lineCompression, sizeof(lineCompression));
+  length += sizeof(lineCompression);
+  bytes[length++] = extraParagraphSpacing;
+
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+bool BookPageMap::load(const Epub& epub, const uint32_t newLayoutHash) {
+  layoutHash = newLayoutHash;
+  const int spineCount = epub.getSpineItemsCount();
+
+  File file;
+  if (SD.exists(path.c_str()) && FsHelpers::openFileForRead("BPM", path, file)) {
+    uint8_t version;
+    uint32_t fileLayoutHash;
+    uint16_t fileSpineCount;
+    serialization::readPod(file, version);
+    serialization::readPod(file, fileLayoutHash);
+    serialization::readPod(file, fileSpineCount);
+    if (version == PAGE_MAP_VERSION && fileSpineCount == spineCount) {
+      cumulativeSizes.resize(spineCount);
+      pageCounts.resize(spineCount);
+      for (int i = 0; i < spineCount; i++) {
+        serialization::readPod(file, cumulativeSizes[i]);
+        serialization::readPod(file, pageCounts[i]);
+      }
+      file.close();
+
+      if (fileLayoutHash != layoutHash) {
+        Serial.printf("[%lu] [BPM] Layout changed, starting a new page map\n", millis());
+        pageCounts.assign(spineCount, UNKNOWN_PAGE_COUNT);
+        save();
+      }
+      updateTotals();
+      Serial.printf("[%lu] [BPM] Loaded page map, %d of %d spine items unknown\n", millis(), unknownCount, spineCount);
+      return true;
+    }
+    file.close();
+  }
+
+  // Sizes come from the book cache one spine entry at a time, so they're only read once per book
+  cumulativeSizes.resize(spineCount);
+  for (int i = 0; i < spineCount; i++) {
+    cumulativeSizes[i] = epub.getCumulativeSpineItemSize(i);
+  }
+  pageCounts.assign(spineCount, UNKNOWN_PAGE_COUNT);
+  updateTotals();
+  return save();
+}
+
+void BookPageMap::setPageCount(const int spineIndex, const int pageCount) {
+  if (spineIndex < 0 || spineIndex >= static_cast<int>(pageCounts.size()) || pageCount < 0 ||
+      pageCount >= UNKNOWN_PAGE_COUNT || pageCounts[spineIndex] == pageCount) {
+    return;
+  }
+  pageCounts[spineIndex] = pageCount;
+  updateTotals();
+  save();
+}
+
+uint32_t BookPageMap::getItemSize(const int spineIndex) const {
+  return cumulativeSizes[spineIndex] - (spineIndex > 0 ? cumulativeSizes[spineIndex - 1] : 0);
+}
+
+int BookPageMap::getItemPages(const int spineIndex) const {
+  if (pageCounts[spineIndex] != UNKNOWN_PAGE_COUNT) {
+    return pageCounts[spineIndex];
+  }
+  if (knownBytes == 0) {
+    return 0;
+  }
+  // Every chapter is at least a page
+  const uint32_t estimate = (static_cast<uint64_t>(getItemSize(spineIndex)) * knownPages + knownBytes / 2) / knownBytes;
+  return estimate > 0 ? estimate : 1;
+}
+
+void BookPageMap::updateTotals() {
+  unknownCount = 0;
+  knownPages = 0;
+  knownBytes = 0;
+  for (size_t i = 0; i < pageCounts.size(); i++) {
+    if (pageCounts[i] == UNKNOWN_PAGE_COUNT) {
+      unknownCount++;
+    } else {
+      knownPages += pageCounts[i];
+      knownBytes += getItemSize(i);
+    }
+  }
+
+  pagesBefore.resize(pageCounts.size() + 1);
+  pagesBefore[0] = 0;
+  for (size_t i = 0; i < pageCounts.size(); i++) {
+    pagesBefore[i + 1] = pagesBefore[i] + getItemPages(i);
+  }
+}
+
+int BookPageMap::getPagesBefore(const int spineIndex) const {
+  if (spineIndex < 0 || spineIndex >= static_cast<int>(pagesBefore.size())) {
+    return 0;
+  }
+  return pagesBefore[spineIndex];
+}
+
+bool BookPageMap::save() const {
+  File file;
+  if (!FsHelpers::openFileForWrite("BPM", path, file)) {
+    return false;
+  }
+  serialization::writePod(file, PAGE_MAP_VERSION);
+  serialization::writePod(file, layoutHash);
+  serialization::writePod(file, static_cast<uint16_t>(pageCounts.size()));
+  for (size_t i = 0; i < pageCounts.size(); i++) {
+    serialization::writePod(file, cumulativeSizes[i]);
+    serialization::writePod(file, pageCounts[i]);
+  }
+  file.close();
+  return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Epub;
+
+// Page count of every spine item for one layout, filled in as sections get indexed and kept in the book cache.
+// Items that haven't been indexed yet are estimated from their size at the book's average pages per byte.
+class BookPageMap {
+  std::string path;
+  uint32_t layoutHash = 0;
+  // Inflated size of the spine up to and including each item, copied from the book cache once
+  std::vector<uint32_t> cumulativeSizes;
+  std::vector<uint16_t> pageCounts;
+  // Known or estimated pages before each spine item, one extra entry for the whole book
+  std::vector<uint32_t> pagesBefore;
+  int unknownCount = 0;
+  uint32_t knownPages = 0;
+  uint32_t knownBytes = 0;
+
+  uint32_t getItemSize(int spineIndex) const;
+  int getItemPages(int spineIndex) const;
+  void updateTotals();
+  bool save() const;
+
+ public:
+  static constexpr uint16_t UNKNOWN_PAGE_COUNT = 0xFFFF;
+
+  explicit BookPageMap(std::string path) : path(std::move(path)) {}
+  ~BookPageMap() = default;
+
+  static uint32_t computeLayoutHash(int fontId, float lineCompression, int marginTop, int marginRight,
+                                    int marginBottom, int marginLeft, bool extraParagraphSpacing);
+  // Counts stored for any other layout are dropped
+  bool load(const Epub& epub, uint32_t newLayoutHash);
+  void setPageCount(int spineIndex, int pageCount);
+  // Every spine item has been indexed, so page numbers are exact
+  bool isComplete() const { return unknownCount == 0; }
+  // Pages in all spine items before this one
+  int getPagesBefore(int spineIndex) const;
+  int getTotalPages() const { return pagesBefore.empty() ? 0 : pagesBefore.back(); }
+};
@@ -0,0 +1,318 @@
+#include "BookSearch.h"
+
+#include <FsHelpers.h>
+#include <HardwareSerial.h>
+#include <SD.h>
+#include <Serialization.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "../Epub.h"
+#include "Page.h"
+#include "parsers/ChapterHtmlSlimParser.h"
+
+namespace {
+constexpr uint8_t SEARCH_VERSION = 1;
+constexpr size_t STREAM_CHUNK_SIZE = 1024;
+// Room for the longest word the parser produces plus the unsearched tail of the text before it
+constexpr size_t WINDOW_SIZE = 1024;
+// Words between checks for a cancel
+constexpr uint32_t CANCEL_POLL_WORDS = 512;
+
+bool isQuerySpace(const char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
+
+uint16_t foldCodepoint(const uint16_t codepoint) {
+  // Latin-1 capitals, except the multiplication sign
+  if (codepoint >= 0xC0 && codepoint <= 0xDE && codepoint != 0xD7) {
+    return codepoint + 0x20;
+  }
+  // Latin Extended-A alternates capital and small letters, starting on an odd codepoint in two of its runs
+  if ((codepoint >= 0x100 && codepoint <= 0x12F) || (codepoint >= 0x132 && codepoint <= 0x137) ||
+      (codepoint >= 0x14A && codepoint <= 0x177)) {
+    return codepoint | 1;
+  }
+  if ((codepoint >= 0x139 && codepoint <= 0x148) || (codepoint >= 0x179 && codepoint <= 0x17E)) {
+    return codepoint & 1 ? codepoint + 1 : codepoint;
+  }
+  if (codepoint == 0x178) {
+    return 0xFF;
+  }
+  // Greek capitals, with and without tonos, final sigma matches sigma
+  if (codepoint >= 0x391 && codepoint <= 0x3A9 && codepoint != 0x3A2) {
+    return codepoint + 0x20;
+  }
+  if (codepoint == 0x386) {
+    return 0x3AC;
+  }
+  if (codepoint >= 0x388 && codepoint <= 0x38A) {
+    return codepoint + 0x25;
+  }
+  if (codepoint == 0x38C) {
+    return 0x3CC;
+  }
+  if (codepoint == 0x38E || codepoint == 0x38F) {
+    return codepoint + 0x3F;
+  }
+  if (codepoint == 0x3C2) {
+    return 0x3C3;
+  }
+  // Cyrillic capitals
+  if (codepoint >= 0x410 && codepoint <= 0x42F) {
+    return codepoint + 0x20;
+  }
+  if (codepoint >= 0x400 && codepoint <= 0x40F) {
+    return codepoint + 0x50;
+  }
+  return codepoint;
+}
+
+// Boyer-Moore-Horspool over a window of case folded text. Words are appended with a space after each, the same way
+// text offsets count them, so a position in the window plus the window's base is a text offset.
+class TextMatcher {
+  const std::string& pattern;
+  uint8_t shifts[256] = {};
+  char* window = nullptr;
+  size_t windowLength = 0;
+  // Text offset of window[0]
+  uint32_t windowBase = 0;
+  // First alignment of the pattern not compared yet
+  size_t scanStart = 0;
+
+ public:
+  explicit TextMatcher(const std::string& pattern) : pattern(pattern) {
+    const size_t length = pattern.size();
+    memset(shifts, static_cast<int>(length), sizeof(shifts));
+    for (size_t i = 0; i + 1 < length; i++) {
+      shifts[static_cast<uint8_t>(pattern[i])] = length - 1 - i;
+    }
+  }
+  ~TextMatcher() { free(window); }
+  TextMatcher(const TextMatcher&) = delete;
+  TextMatcher& operator=(const TextMatcher&) = delete;
+
+  bool begin() {
+    window = static_cast<char*>(malloc(WINDOW_SIZE));
+    return window != nullptr;
+  }
+
+  // Appends the text offset of every match completed by this word to matches, matches don't overlap
+  void addWord(const char* word, size_t length, const uint32_t textOffset, std::vector<uint32_t>& matches) {
+    if (windowLength + length + 1 > WINDOW_SIZE) {
+      // Everything before scanStart has been compared against every alignment it's part of
+      memmove(window, window + scanStart, windowLength - scanStart);
+      windowLength -= scanStart;
+      scanStart = 0;
+    }
+    if (windowLength + length + 1 > WINDOW_SIZE) {
+      length = WINDOW_SIZE - windowLength - 1;
+    }
+
+    windowBase = textOffset - windowLength;
+    memcpy(window + windowLength, word, length);
+    BookSearch::foldCase(window + windowLength, length);
+    windowLength += length;
+    window[windowLength++] = ' ';
+
+    const size_t patternLength = pattern.size();
+    const char* patternData = pattern.data();
+    while (scanStart + patternLength <= windowLength) {
+      const char* candidate = window + scanStart;
+      const char last = candidate[patternLength - 1];
+      if (last == patternData[patternLength - 1] && memcmp(candidate, patternData, patternLength - 1) == 0) {
+        matches.push_back(windowBase + scanStart);
+        scanStart += patternLength;
+      } else {
+        scanStart += shifts[static_cast<uint8_t>(last)];
+      }
+    }
+  }
+};
+}  // namespace
+
+BookSearch::BookSearch(const std::shared_ptr<Epub>& epub, GfxRenderer& renderer)
+    : epub(epub), renderer(renderer), path(epub->getCachePath() + "/search.bin") {
+  // Hidden elements are skipped the same way as when laying out, so offsets line up with the section caches
+  cssRules.load(epub->getCssRuleTablePath());
+}
+
+void BookSearch::foldCase(char* text, const size_t length) {
+  auto* bytes = reinterpret_cast<uint8_t*>(text);
+  for (size_t i = 0; i < length; i++) {
+    const uint8_t c = bytes[i];
+    if (c >= 'A' && c <= 'Z') {
+      bytes[i] = c + ('a' - 'A');
+      continue;
+    }
+    // Every folded letter outside ASCII is a two byte sequence on both sides
+    if ((c & 0xE0) != 0xC0 || i + 1 >= length || (bytes[i + 1] & 0xC0) != 0x80) {
+      continue;
+    }
+    const uint16_t codepoint = (c & 0x1F) << 6 | (bytes[i + 1] & 0x3F);
+    const uint16_t folded = foldCodepoint(codepoint);
+    if (folded != codepoint) {
+      bytes[i] = 0xC0 | folded >> 6;
+      bytes[i + 1] = 0x80 | (folded & 0x3F);
+    }
+    i++;
+  }
+}
+
+bool BookSearch::begin(const std::string& text) {
+  // Words reach the matcher with exactly one space between them
+  query.clear();
+  for (const char c : text) {
+    if (isQuerySpace(c)) {
+      if (!query.empty() && query.back() != ' ') {
+        query += ' ';
+      }
+    } else {
+      query += c;
+    }
+  }
+  if (query.size() > MAX_QUERY_LENGTH) {
+    // Don't cut a UTF-8 sequence in half
+    size_t length = MAX_QUERY_LENGTH;
+    while (length > 0 && (static_cast<uint8_t>(query[length]) & 0xC0) == 0x80) {
+      length--;
+    }
+    query.resize(length);
+  }
+  if (!query.empty() && query.back() == ' ') {
+    query.pop_back();
+  }
+  foldCase(&query[0], query.size());
+  if (query.empty()) {
+    return false;
+  }
+
+  if (loadProgress()) {
+    Serial.printf("[%lu] [SRC] Resuming search for \"%s\" at spine item %d with %u results\n", millis(),
+                  query.c_str(), nextSpineIndex, static_cast<unsigned>(results.size()));
+    return true;
+  }
+  nextSpineIndex = 0;
+  results.clear();
+  saveProgress();
+  return true;
+}
+
+bool BookSearch::isComplete() const { return nextSpineIndex >= epub->getSpineItemsCount(); }
+
+bool BookSearch::searchNextItem(const std::function<bool()>& shouldCancel) {
+  if (isComplete()) {
+    return true;
+  }
+
+  const auto start = millis();
+  const int spineIndex = nextSpineIndex;
+  const size_t previousResultCount = results.size();
+  bool cancelled = false;
+
+  const auto stream = epub->openItemStream(epub->getSpineItem(spineIndex).href, STREAM_CHUNK_SIZE);
+  TextMatcher matcher(query);
+  if (!stream || !matcher.begin()) {
+    Serial.printf("[%lu] [SRC] Couldn't read spine item %d, skipping it\n", millis(), spineIndex);
+  } else {
+    // Only used for its element and word handling, nothing is laid out or read from a file
+    const std::string noFile;
+    ChapterHtmlSlimParser parser(noFile, renderer, 0, 1.0f, 0, 0, 0, 0, false, nullptr);
+    if (cssRules.isLoaded()) {
+      parser.setCssRuleTable(&cssRules);
+    }
+
+    std::vector<uint32_t> matches;
+    uint32_t wordCount = 0;
+    parser.extractWords(*stream, [&](const char* word, const size_t length, const uint32_t textOffset) {
+      matcher.addWord(word, length, textOffset, matches);
+      for (const uint32_t match : matches) {
+        if (results.size() < MAX_RESULTS) {
+          results.push_back({static_cast<uint16_t>(spineIndex), match});
+        }
+      }
+      matches.clear();
+      if (results.size() >= MAX_RESULTS) {
+        return false;
+      }
+      if (++wordCount % CANCEL_POLL_WORDS == 0 && shouldCancel()) {
+        cancelled = true;
+        return false;
+      }
+      return true;
+    });
+  }
+
+  if (cancelled) {
+    results.resize(previousResultCount);
+    Serial.printf("[%lu] [SRC] Search cancelled in spine item %d\n", millis(), spineIndex);
+    return false;
+  }
+
+  if (results.size() >= MAX_RESULTS) {
+    Serial.printf("[%lu] [SRC] Found %u results, stopping\n", millis(), static_cast<unsigned>(MAX_RESULTS));
+    nextSpineIndex = epub->getSpineItemsCount();
+  } else {
+    nextSpineIndex = spineIndex + 1;
+  }
+  Serial.printf("[%lu] [SRC] Searched spine item %d in %lums, %u results so far\n", millis(), spineIndex,
+                millis() - start, static_cast<unsigned>(results.size()));
+  saveProgress();
+  return true;
+}
+
+bool BookSearch::loadProgress() {
+  if (!SD.exists(path.c_str())) {
+    return false;
+  }
+  File file;
+  if (!FsHelpers::openFileForRead("SRC", path, file)) {
+    return false;
+  }
+
+  uint8_t version;
+  std::string fileQuery;
+  uint16_t spineCount;
+  uint16_t fileNextSpineIndex;
+  uint16_t resultCount;
+  serialization::readPod(file, version);
+  if (version != SEARCH_VERSION) {
+    file.close();
+    return false;
+  }
+  serialization::readString(file, fileQuery);
+  serialization::readPod(file, spineCount);
+  serialization::readPod(file, fileNextSpineIndex);
+  serialization::readPod(file, resultCount);
+  // Anything else is a new search
+  if (fileQuery != query || spineCount != epub->getSpineItemsCount() || resultCount > MAX_RESULTS) {
+    file.close();
+    return false;
+  }
+
+  results.resize(resultCount);
+  for (auto& result : results) {
+    serialization::readPod(file, result.spineIndex);
+    serialization::readPod(file, result.textOffset);
+  }
+  file.close();
+  nextSpineIndex = fileNextSpineIndex;
+  return true;
+}
+
+bool BookSearch::saveProgress() const {
+  File file;
+  if (!FsHelpers::openFileForWrite("SRC", path, file)) {
+    return false;
+  }
+  serialization::writePod(file, SEARCH_VERSION);
+  serialization::writeString(file, query);
+  serialization::writePod(file, static_cast<uint16_t>(epub->getSpineItemsCount()));
+  serialization::writePod(file, static_cast<uint16_t>(nextSpineIndex));
+  serialization::writePod(file, static_cast<uint16_t>(results.size()));
+  for (const auto& result : results) {
+    serialization::writePod(file, result.spineIndex);
+    serialization::writePod(file, result.textOffset);
+  }
+  file.close();
+  return true;
+}
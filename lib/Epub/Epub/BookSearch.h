@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CssRuleTable.h"
+
+class Epub;
+class GfxRenderer;
+
+// Case insensitive search through a whole book, one spine item per call so the caller can keep handling input in
+// between. Items are inflated and tokenized straight from the zip without being laid out, and hits are kept as
+// (spine index, text offset) so they can be turned into a page for any layout. Progress and hits go to the book
+// cache after every item, searching for the same text again picks up where the last search stopped.
+class BookSearch {
+ public:
+  struct Result {
+    uint16_t spineIndex;
+    uint32_t textOffset;
+  };
+
+  static constexpr size_t MAX_QUERY_LENGTH = 64;
+  // The search stops once this many hits have been found
+  static constexpr size_t MAX_RESULTS = 200;
+
+ private:
+  std::shared_ptr<Epub> epub;
+  GfxRenderer& renderer;
+  std::string path;
+  // Case folded, whitespace collapsed to single spaces
+  std::string query;
+  int nextSpineIndex = 0;
+  std::vector<Result> results;
+  CssRuleTable cssRules;
+
+  bool loadProgress();
+  bool saveProgress() const;
+
+ public:
+  explicit BookSearch(const std::shared_ptr<Epub>& epub, GfxRenderer& renderer);
+  ~BookSearch() = default;
+
+  // Folds case in place without changing the length of the text, for ASCII, Latin-1, Latin Extended-A, Greek and
+  // Cyrillic. Text offsets stay byte accurate since nothing outside those ranges is touched.
+  static void foldCase(char* text, size_t length);
+
+  // Returns false if there's nothing to search for
+  bool begin(const std::string& text);
+  // Searches the next spine item, returns false if shouldCancel asked to stop. The item's hits are dropped then and
+  // it's searched again from the start next time.
+  bool searchNextItem(const std::function<bool()>& shouldCancel);
+  bool isComplete() const;
+  int getNextSpineIndex() const { return nextSpineIndex; }
+  const std::string& getQuery() const { return query; }
+  const std::vector<Result>& getResults() const { return results; }
+};
@@ -0,0 +1,258 @@
+#include "CssRuleTable.h"
+
+#include <HardwareSerial.h>
+#include <Serialization.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "FsHelpers.h"
+#include "blocks/TextBlock.h"
+
+namespace {
+constexpr uint8_t CSS_RULE_TABLE_VERSION = 2;
+constexpr size_t MAX_PROPERTY_LENGTH = 32;
+
+bool isCssSpace(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f'; }
+
+// Copies text trimmed and lower cased into out, returns false if it doesn't fit
+bool copyLower(const char* start, const char* end, char* out, const size_t outSize) {
+  while (start < end && isCssSpace(*start)) {
+    start++;
+  }
+  while (end > start && isCssSpace(end[-1])) {
+    end--;
+  }
+  if (static_cast<size_t>(end - start) >= outSize) {
+    return false;
+  }
+  size_t i = 0;
+  for (; start < end; start++) {
+    out[i++] = *start >= 'A' && *start <= 'Z' ? *start + ('a' - 'A') : *start;
+  }
+  out[i] = '\0';
+  return true;
+}
+
+void applyDeclaration(const char* name, const char* value, CssStyle& style) {
+  if (strcmp(name, "text-align") == 0) {
+    style.flags |= CssStyle::HAS_TEXT_ALIGN;
+    if (strcmp(value, "center") == 0) {
+      style.textAlign = TextBlock::CENTER_ALIGN;
+    } else if (strcmp(value, "right") == 0 || strcmp(value, "end") == 0) {
+      style.textAlign = TextBlock::RIGHT_ALIGN;
+    } else if (strcmp(value, "left") == 0 || strcmp(value, "start") == 0) {
+      style.textAlign = TextBlock::LEFT_ALIGN;
+    } else if (strcmp(value, "justify") == 0) {
+      style.textAlign = TextBlock::JUSTIFIED;
+    } else {
+      style.flags &= ~CssStyle::HAS_TEXT_ALIGN;
+    }
+  } else if (strcmp(name, "font-weight") == 0) {
+    style.flags |= CssStyle::HAS_FONT_WEIGHT;
+    const int weight = atoi(value);
+    style.bold = strcmp(value, "bold") == 0 || strcmp(value, "bolder") == 0 || weight >= 600;
+  } else if (strcmp(name, "font-style") == 0) {
+    style.flags |= CssStyle::HAS_FONT_STYLE;
+    style.italic = strcmp(value, "italic") == 0 || strcmp(value, "oblique") == 0;
+  } else if (strcmp(name, "display") == 0) {
+    style.flags |= CssStyle::HAS_DISPLAY;
+    style.hidden = strcmp(value, "none") == 0;
+  }
+}
+}  // namespace
+
+void CssStyle::merge(const CssStyle& other) {
+  if (other.flags & HAS_TEXT_ALIGN) {
+    textAlign = other.textAlign;
+  }
+  if (other.flags & HAS_FONT_WEIGHT) {
+    bold = other.bold;
+  }
+  if (other.flags & HAS_FONT_STYLE) {
+    italic = other.italic;
+  }
+  if (other.flags & HAS_DISPLAY) {
+    hidden = other.hidden;
+  }
+  flags |= other.flags;
+}
+
+CssStyle CssStyle::parseDeclarations(const char* declarations, const size_t length) {
+  CssStyle style;
+  const char* end = declarations + length;
+  const char* start = declarations;
+  while (start < end) {
+    const char* declarationEnd = start;
+    while (declarationEnd < end && *declarationEnd != ';') {
+      declarationEnd++;
+    }
+    const char* colon = start;
+    while (colon < declarationEnd && *colon != ':') {
+      colon++;
+    }
+
+    char name[MAX_PROPERTY_LENGTH];
+    char value[MAX_PROPERTY_LENGTH];
+    if (colon < declarationEnd && copyLower(start, colon, name, sizeof(name)) &&
+        copyLower(colon + 1, declarationEnd, value, sizeof(value))) {
+      // Priority is ignored, rules are applied in cascade order either way
+      char* important = strstr(value, "!important");
+      if (important) {
+        while (important > value && isCssSpace(important[-1])) {
+          important--;
+        }
+        *important = '\0';
+      }
+      applyDeclaration(name, value, style);
+    }
+    start = declarationEnd + 1;
+  }
+  return style;
+}
+
+CssRuleTable::~CssRuleTable() { free(slots); }
+
+// FNV-1a for the hash and djb2 (xor variant) for the check
+CssSelectorKey CssRuleTable::extendKey(CssSelectorKey key, const char* text, const size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    const auto c = static_cast<uint8_t>(text[i]);
+    key.hash = (key.hash ^ c) * 16777619u;
+    key.check = key.check * 33 ^ c;
+  }
+  key.length += static_cast<uint16_t>(length);
+  return key;
+}
+
+void CssRuleTable::addRule(const CssSelectorKey& selector, const CssStyle& style) {
+  if (style.isEmpty()) {
+    return;
+  }
+  pendingRules[selector].merge(style);
+}
+
+bool CssRuleTable::writeToFile(const std::string& path) const {
+  // At most half full so probe chains stay short
+  uint32_t slotCount = 16;
+  while (slotCount < pendingRules.size() * 2) {
+    slotCount *= 2;
+  }
+
+  auto* table = static_cast<Slot*>(calloc(slotCount, sizeof(Slot)));
+  if (!table) {
+    Serial.printf("[%lu] [CSS] Couldn't allocate memory for rule table\n", millis());
+    return false;
+  }
+  for (const auto& rule : pendingRules) {
+    uint32_t index = rule.first.hash & (slotCount - 1);
+    while (!table[index].style.isEmpty()) {
+      index = (index + 1) & (slotCount - 1);
+    }
+    table[index].key = rule.first;
+    table[index].style = rule.second;
+  }
+
+  File file;
+  if (!FsHelpers::openFileForWrite("CSS", path, file)) {
+    free(table);
+    return false;
+  }
+  serialization::writePod(file, CSS_RULE_TABLE_VERSION);
+  serialization::writePod(file, slotCount);
+  const size_t tableSize = slotCount * sizeof(Slot);
+  const bool success = file.write(reinterpret_cast<const uint8_t*>(table), tableSize) == tableSize;
+  file.close();
+  free(table);
+
+  Serial.printf("[%lu] [CSS] Wrote %u rules in %u slots\n", millis(), static_cast<unsigned>(pendingRules.size()),
+                slotCount);
+  return success;
+}
+
+bool CssRuleTable::load(const std::string& path) {
+  File file;
+  if (!FsHelpers::openFileForRead("CSS", path, file)) {
+    return false;
+  }
+
+  uint8_t version;
+  uint32_t slotCount;
+  serialization::readPod(file, version);
+  serialization::readPod(file, slotCount);
+  if (version != CSS_RULE_TABLE_VERSION || slotCount == 0 || (slotCount & (slotCount - 1)) != 0) {
+    Serial.printf("[%lu] [CSS] Deserialization failed: Unknown version %u\n", millis(), version);
+    file.close();
+    return false;
+  }
+
+  free(slots);
+  slots = static_cast<Slot*>(malloc(slotCount * sizeof(Slot)));
+  if (!slots) {
+    Serial.printf("[%lu] [CSS] Couldn't allocate memory for rule table\n", millis());
+    file.close();
+    return false;
+  }
+  const size_t tableSize = slotCount * sizeof(Slot);
+  if (file.read(reinterpret_cast<uint8_t*>(slots), tableSize) != tableSize) {
+    Serial.printf("[%lu] [CSS] Truncated rule table\n", millis());
+    free(slots);
+    slots = nullptr;
+    file.close();
+    return false;
+  }
+  file.close();
+  slotMask = slotCount - 1;
+  return true;
+}
+
+const CssStyle* CssRuleTable::find(const CssSelectorKey& key) const {
+  for (uint32_t index = key.hash & slotMask;; index = (index + 1) & slotMask) {
+    const Slot& slot = slots[index];
+    if (slot.style.isEmpty()) {
+      return nullptr;
+    }
+    if (slot.key == key) {
+      return &slot.style;
+    }
+  }
+}
+
+CssStyle CssRuleTable::lookup(const char* tag, const char* classAttribute) const {
+  CssStyle style;
+  if (!slots) {
+    return style;
+  }
+
+  const CssSelectorKey tagKey = extendKey(EMPTY_KEY, tag, strlen(tag));
+  if (const CssStyle* rule = find(tagKey)) {
+    style.merge(*rule);
+  }
+  if (!classAttribute) {
+    return style;
+  }
+
+  // Class rules first, tag.class rules are more specific
+  CssStyle tagClassStyle;
+  for (const char* start = classAttribute; *start;) {
+    while (isCssSpace(*start)) {
+      start++;
+    }
+    const char* end = start;
+    while (*end && !isCssSpace(*end)) {
+      end++;
+    }
+    if (end > start) {
+      const CssSelectorKey classKey = extendKey(extendKey(EMPTY_KEY, ".", 1), start, end - start);
+      if (const CssStyle* rule = find(classKey)) {
+        style.merge(*rule);
+      }
+      const CssSelectorKey tagClassKey = extendKey(extendKey(tagKey, ".", 1), start, end - start);
+      if (const CssStyle* rule = find(tagClassKey)) {
+        tagClassStyle.merge(*rule);
+      }
+    }
+    start = end;
+  }
+  style.merge(tagClassStyle);
+  return style;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// The subset of CSS the layout understands, every field is only meaningful when its flag is set
+struct CssStyle {
+  enum Flags : uint8_t {
+    HAS_TEXT_ALIGN = 1 << 0,
+    HAS_FONT_WEIGHT = 1 << 1,
+    HAS_FONT_STYLE = 1 << 2,
+    HAS_DISPLAY = 1 << 3,
+  };
+
+  uint8_t flags = 0;
+  // TextBlock::BLOCK_STYLE
+  uint8_t textAlign = 0;
+  bool bold = false;
+  bool italic = false;
+  // display: none
+  bool hidden = false;
+
+  bool isEmpty() const { return flags == 0; }
+  // Properties set in other win
+  void merge(const CssStyle& other);
+  // Parses a declaration block ("font-weight: bold; text-align: center"), ignoring anything unsupported
+  static CssStyle parseDeclarations(const char* declarations, size_t length);
+};
+
+// Identifies a selector without storing its text: two independent hashes of it plus its length, so two selectors
+// only get mixed up if all three match
+struct CssSelectorKey {
+  uint32_t hash;
+  uint32_t check;
+  uint16_t length;
+
+  bool operator==(const CssSelectorKey& other) const {
+    return hash == other.hash && check == other.check && length == other.length;
+  }
+};
+
+// Rules for simple selectors (tag, .class and tag.class) keyed by CssSelectorKey. Built from the book's stylesheets
+// once when the book is first loaded and stored in the book cache as an open addressed table, so a lookup is a couple
+// of probes with no CSS parsing.
+class CssRuleTable {
+  struct Slot {
+    CssSelectorKey key;
+    CssStyle style;
+  };
+
+  struct KeyHash {
+    size_t operator()(const CssSelectorKey& key) const { return key.hash; }
+  };
+
+  // Only used while building
+  std::unordered_map<CssSelectorKey, CssStyle, KeyHash> pendingRules;
+  Slot* slots = nullptr;
+  uint32_t slotMask = 0;
+
+  const CssStyle* find(const CssSelectorKey& key) const;
+
+ public:
+  // Key of the empty selector, extend it with the selector text
+  static constexpr CssSelectorKey EMPTY_KEY = {2166136261u, 5381u, 0};
+  // Keying "p" and then ".note" gives the same result as keying "p.note"
+  static CssSelectorKey extendKey(CssSelectorKey key, const char* text, size_t length);
+
+  CssRuleTable() = default;
+  ~CssRuleTable();
+  CssRuleTable(const CssRuleTable&) = delete;
+  CssRuleTable& operator=(const CssRuleTable&) = delete;
+
+  // Later rules for the same selector override earlier ones property by property
+  void addRule(const CssSelectorKey& selector, const CssStyle& style);
+  size_t getPendingRuleCount() const { return pendingRules.size(); }
+  bool writeToFile(const std::string& path) const;
+
+  bool load(const std::string& path);
+  bool isLoaded() const { return slots != nullptr; }
+  // Cascade for one element: tag rules, then .class, then tag.class for each class in the attribute
+  CssStyle lookup(const char* tag, const char* classAttribute) const;
+};
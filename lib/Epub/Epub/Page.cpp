@@ -1,13 +1,15 @@
 #include "Page.h"
 
+#include <GfxRenderer.h>
+#include <FsHelpers.h>
 #include <HardwareSerial.h>
 #include <Serialization.h>
 
 namespace {
-constexpr uint8_t PAGE_FILE_VERSION = 3;
+constexpr uint8_t PAGE_FILE_VERSION = 4;
 }
 
-void PageLine::render(GfxRenderer& renderer, const int fontId) { block->render(renderer, fontId, xPos, yPos); }
+void PageLine::render(GfxRenderer& renderer, const FontHandle& font) { block->render(renderer, font, xPos, yPos); }
 
 void PageLine::serialize(File& file) {
   serialization::writePod(file, xPos);
@@ -27,10 +29,79 @@ std::unique_ptr<PageLine> PageLine::deserialize(File& file) {
   return std::unique_ptr<PageLine>(new PageLine(std::move(tb), xPos, yPos));
 }
 
+File PageImage::openFile;
+std::string PageImage::openFilePath;
+
+void PageImage::closeOpenFile() {
+  if (openFile) {
+    openFile.close();
+  }
+  openFilePath.clear();
+}
+
+void PageImage::render(GfxRenderer& renderer, const FontHandle& font) {
+  (void)font;
+  // Grayscale passes have nothing to add to an image without grey levels
+  if (headerLoaded && !header.hasGrayscale && renderer.getRenderMode() != GfxRenderer::BW) {
+    return;
+  }
+
+  if (openFilePath != imagePath) {
+    closeOpenFile();
+    if (!FsHelpers::openFileForRead("PGE", imagePath, openFile)) {
+      return;
+    }
+    openFilePath = imagePath;
+  }
+  if (!headerLoaded) {
+    if (!PlaneBitmap::readHeader(openFile, header)) {
+      closeOpenFile();
+      return;
+    }
+    headerLoaded = true;
+  }
+
+  if (!PlaneBitmap::draw(renderer, openFile, header, xPos, yPos)) {
+    Serial.printf("[%lu] [PGE] Failed to draw image %s\n", millis(), imagePath.c_str());
+  }
+}
+
+void PageImage::serialize(File& file) {
+  serialization::writePod(file, xPos);
+  serialization::writePod(file, yPos);
+  serialization::writePod(file, width);
+  serialization::writePod(file, height);
+  serialization::writeString(file, imagePath);
+}
+
+std::unique_ptr<PageImage> PageImage::deserialize(File& file) {
+  int16_t xPos;
+  int16_t yPos;
+  int16_t width;
+  int16_t height;
+  std::string imagePath;
+  serialization::readPod(file, xPos);
+  serialization::readPod(file, yPos);
+  serialization::readPod(file, width);
+  serialization::readPod(file, height);
+  serialization::readString(file, imagePath);
+  return std::unique_ptr<PageImage>(new PageImage(std::move(imagePath), width, height, xPos, yPos));
+}
+
 void Page::render(GfxRenderer& renderer, const int fontId) const {
+  // Resolve the font once for the whole page rather than once per word
+  const FontHandle font = renderer.getFont(fontId);
   for (auto& element : elements) {
-    element->render(renderer, fontId);
+    element->render(renderer, font);
+  }
+}
+
+size_t Page::getMemoryUsage() const {
+  size_t bytes = sizeof(Page) + elements.capacity() * sizeof(std::shared_ptr<PageElement>);
+  for (const auto& element : elements) {
+    bytes += element->getMemoryUsage();
   }
+  return bytes;
 }
 
 void Page::serialize(File& file) const {
@@ -40,8 +111,7 @@ void Page::serialize(File& file) const {
   serialization::writePod(file, count);
 
   for (const auto& el : elements) {
-    // Only PageLine exists currently
-    serialization::writePod(file, static_cast<uint8_t>(TAG_PageLine));
+    serialization::writePod(file, static_cast<uint8_t>(el->getTag()));
     el->serialize(file);
   }
 }
@@ -66,6 +136,8 @@ std::unique_ptr<Page> Page::deserialize(File& file) {
     if (tag == TAG_PageLine) {
       auto pl = PageLine::deserialize(file);
       page->elements.push_back(std::move(pl));
+    } else if (tag == TAG_PageImage) {
+      page->elements.push_back(PageImage::deserialize(file));
     } else {
       Serial.printf("[%lu] [PGE] Deserialization failed: Unknown tag %u\n", millis(), tag);
       return nullptr;
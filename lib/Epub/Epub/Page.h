@@ -1,6 +1,8 @@
 #pragma once
 #include <FS.h>
+#include <PlaneBitmap.h>
 
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -8,6 +10,7 @@
 
 enum PageElementTag : uint8_t {
   TAG_PageLine = 1,
+  TAG_PageImage = 2,
 };
 
 // represents something that has been added to a page
@@ -17,8 +20,10 @@ class PageElement {
   int16_t yPos;
   explicit PageElement(const int16_t xPos, const int16_t yPos) : xPos(xPos), yPos(yPos) {}
   virtual ~PageElement() = default;
-  virtual void render(GfxRenderer& renderer, int fontId) = 0;
+  virtual void render(GfxRenderer& renderer, const FontHandle& font) = 0;
+  virtual PageElementTag getTag() const = 0;
   virtual void serialize(File& file) = 0;
+  virtual size_t getMemoryUsage() const = 0;
 };
 
 // a line from a block element
@@ -28,16 +33,44 @@ class PageLine final : public PageElement {
  public:
   PageLine(std::shared_ptr<TextBlock> block, const int16_t xPos, const int16_t yPos)
       : PageElement(xPos, yPos), block(std::move(block)) {}
-  void render(GfxRenderer& renderer, int fontId) override;
+  void render(GfxRenderer& renderer, const FontHandle& font) override;
+  PageElementTag getTag() const override { return TAG_PageLine; }
   void serialize(File& file) override;
+  size_t getMemoryUsage() const override { return sizeof(PageLine) + block->getMemoryUsage(); }
   static std::unique_ptr<PageLine> deserialize(File& file);
 };
 
+// a pre-rendered image from the book's image cache
+class PageImage final : public PageElement {
+  std::string imagePath;
+  int16_t width;
+  int16_t height;
+  PlaneBitmap::Header header;
+  bool headerLoaded = false;
+
+  // The last image drawn stays open, so the grayscale passes after a page's BW pass only seek to their plane
+  static File openFile;
+  static std::string openFilePath;
+
+ public:
+  // Closes the image kept open between passes, before image files are removed and when the reader closes
+  static void closeOpenFile();
+
+  PageImage(std::string imagePath, const int16_t width, const int16_t height, const int16_t xPos, const int16_t yPos)
+      : PageElement(xPos, yPos), imagePath(std::move(imagePath)), width(width), height(height) {}
+  void render(GfxRenderer& renderer, const FontHandle& font) override;
+  PageElementTag getTag() const override { return TAG_PageImage; }
+  void serialize(File& file) override;
+  size_t getMemoryUsage() const override { return sizeof(PageImage) + imagePath.capacity(); }
+  static std::unique_ptr<PageImage> deserialize(File& file);
+};
+
 class Page {
  public:
   // the list of block index and line numbers on this page
   std::vector<std::shared_ptr<PageElement>> elements;
   void render(GfxRenderer& renderer, int fontId) const;
   void serialize(File& file) const;
+  size_t getMemoryUsage() const;
   static std::unique_ptr<Page> deserialize(File& file);
 };
@@ -1,14 +1,80 @@
 #include "Section.h"
 
 #include <FsHelpers.h>
+#include <PlaneBitmap.h>
 #include <SD.h>
 #include <Serialization.h>
 
+#include <algorithm>
+#include <set>
+
+#include "CssRuleTable.h"
 #include "Page.h"
 #include "parsers/ChapterHtmlSlimParser.h"
 
 namespace {
-constexpr uint8_t SECTION_FILE_VERSION = 5;
+constexpr uint8_t SECTION_FILE_VERSION = 12;
+// Upper bound on heap held by deserialized pages kept for instant back and forth turns
+constexpr size_t PAGE_CACHE_BUDGET = 48 * 1024;
+
+// 8 hex digits of the href hash and an underscore
+constexpr size_t IMAGE_PREFIX_LENGTH = 9;
+
+// FNV-1a, image file names have to stay the same across builds for section caches to find them
+uint32_t hashHref(const std::string& href) {
+  uint32_t hash = 2166136261u;
+  for (const char c : href) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+// Names from before the hash was fixed don't start with 8 hex digits and an underscore
+bool isHashedImageName(const std::string& name) {
+  if (name.size() < IMAGE_PREFIX_LENGTH || name[IMAGE_PREFIX_LENGTH - 1] != '_') {
+    return false;
+  }
+  return std::all_of(name.begin(), name.begin() + IMAGE_PREFIX_LENGTH - 1,
+                     [](const char c) { return isxdigit(static_cast<uint8_t>(c)); });
+}
+
+// Drops the files cached for the kept images at other sizes, they belong to a layout that's being replaced, along
+// with files named the old way, which no section of the current version points at
+void removeOtherImageSizes(const std::string& imageDir, const std::set<std::string>& keepNames) {
+  std::set<std::string> keepPrefixes;
+  for (const auto& name : keepNames) {
+    keepPrefixes.insert(name.substr(0, IMAGE_PREFIX_LENGTH));
+  }
+
+  File dir = SD.open(imageDir.c_str());
+  if (!dir || !dir.isDirectory()) {
+    return;
+  }
+  std::vector<std::string> staleNames;
+  for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    const std::string name = file.name();
+    file.close();
+    if (name.empty() || name[0] == '.' || keepNames.count(name) > 0) {
+      continue;
+    }
+    if (!isHashedImageName(name) || keepPrefixes.count(name.substr(0, IMAGE_PREFIX_LENGTH)) > 0) {
+      staleNames.push_back(name);
+    }
+  }
+  dir.close();
+
+  for (const auto& name : staleNames) {
+    Serial.printf("[%lu] [SCT] Removing stale image %s\n", millis(), name.c_str());
+    SD.remove((imageDir + "/" + name).c_str());
+  }
+}
+}  // namespace
+
+Section::~Section() {
+  if (pageCacheHits + pageCacheMisses > 0) {
+    Serial.printf("[%lu] [SCT] Page cache for section %d: %u hits, %u misses\n", millis(), spineIndex, pageCacheHits,
+                  pageCacheMisses);
+  }
 }
 
 void Section::onPageComplete(std::unique_ptr<Page> page) {
@@ -26,6 +92,60 @@ void Section::onPageComplete(std::unique_ptr<Page> page) {
   pageCount++;
 }
 
+// Images are shared by every section of the book, keyed on the item and the box they were scaled to fit
+bool Section::resolveImage(const std::string& itemHref, const int maxWidth, const int maxHeight, std::string* imagePath,
+                           int* width, int* height) {
+  const auto imageDir = epub->getCachePath() + "/images";
+  char prefix[IMAGE_PREFIX_LENGTH + 1];
+  snprintf(prefix, sizeof(prefix), "%08x_", static_cast<unsigned>(hashHref(itemHref)));
+  const std::string imageName = prefix + std::to_string(maxWidth) + "x" + std::to_string(maxHeight) + ".plb";
+  *imagePath = imageDir + "/" + imageName;
+  resolvedImageNames.insert(imageName);
+
+  PlaneBitmap::Header header;
+  File imageFile;
+  if (SD.exists(imagePath->c_str()) && FsHelpers::openFileForRead("SCT", *imagePath, imageFile)) {
+    const bool valid = PlaneBitmap::readHeader(imageFile, header);
+    imageFile.close();
+    if (valid) {
+      *width = header.width;
+      *height = header.height;
+      return true;
+    }
+  }
+
+  SD.mkdir(imageDir.c_str());
+  imagesConverted = true;
+  const auto tmpBmpPath = imageDir + "/.tmp.bmp";
+  File tmpBmp;
+  if (!FsHelpers::openFileForWrite("SCT", tmpBmpPath, tmpBmp)) {
+    return false;
+  }
+  bool success = epub->convertImageToBmp(itemHref, tmpBmp, maxWidth, maxHeight);
+  tmpBmp.close();
+
+  if (success && FsHelpers::openFileForRead("SCT", tmpBmpPath, tmpBmp)) {
+    success = FsHelpers::openFileForWrite("SCT", *imagePath, imageFile) &&
+              PlaneBitmap::writeFromBmp(tmpBmp, imageFile, &header);
+    imageFile.close();
+    tmpBmp.close();
+  } else {
+    success = false;
+  }
+  SD.remove(tmpBmpPath.c_str());
+
+  if (!success) {
+    Serial.printf("[%lu] [SCT] Failed to cache image %s\n", millis(), itemHref.c_str());
+    SD.remove(imagePath->c_str());
+    return false;
+  }
+
+  Serial.printf("[%lu] [SCT] Cached image %s as %dx%d\n", millis(), itemHref.c_str(), header.width, header.height);
+  *width = header.width;
+  *height = header.height;
+  return true;
+}
+
 void Section::writeCacheMetadata(const int fontId, const float lineCompression, const int marginTop,
                                  const int marginRight, const int marginBottom, const int marginLeft,
                                  const bool extraParagraphSpacing) const {
@@ -42,6 +162,14 @@ void Section::writeCacheMetadata(const int fontId, const float lineCompression,
   serialization::writePod(outputFile, marginLeft);
   serialization::writePod(outputFile, extraParagraphSpacing);
   serialization::writePod(outputFile, pageCount);
+  serialization::writePod(outputFile, static_cast<uint16_t>(tocAnchorPages.size()));
+  for (const auto& anchorPage : tocAnchorPages) {
+    serialization::writeString(outputFile, anchorPage.first);
+    serialization::writePod(outputFile, anchorPage.second);
+  }
+  for (const uint32_t textOffset : pageTextOffsets) {
+    serialization::writePod(outputFile, textOffset);
+  }
   outputFile.close();
 }
 
@@ -87,6 +215,17 @@ bool Section::loadCacheMetadata(const int fontId, const float lineCompression, c
   }
 
   serialization::readPod(inputFile, pageCount);
+  uint16_t anchorCount;
+  serialization::readPod(inputFile, anchorCount);
+  tocAnchorPages.resize(anchorCount);
+  for (auto& anchorPage : tocAnchorPages) {
+    serialization::readString(inputFile, anchorPage.first);
+    serialization::readPod(inputFile, anchorPage.second);
+  }
+  pageTextOffsets.resize(pageCount);
+  for (auto& textOffset : pageTextOffsets) {
+    serialization::readPod(inputFile, textOffset);
+  }
   inputFile.close();
   Serial.printf("[%lu] [SCT] Deserialization succeeded: %d pages\n", millis(), pageCount);
   return true;
@@ -98,7 +237,9 @@ void Section::setupCacheDir() const {
 }
 
 // Your updated class method (assuming you are using the 'SD' object, which is a wrapper for a specific filesystem)
-bool Section::clearCache() const {
+bool Section::clearCache() {
+  clearPageCache();
+
   if (!SD.exists(cachePath.c_str())) {
     Serial.printf("[%lu] [SCT] Cache does not exist, no action needed\n", millis());
     return true;
@@ -132,30 +273,134 @@ bool Section::persistPageDataToSD(const int fontId, const float lineCompression,
 
   Serial.printf("[%lu] [SCT] Streamed temp HTML to %s\n", millis(), tmpHtmlPath.c_str());
 
-  ChapterHtmlSlimParser visitor(tmpHtmlPath, renderer, fontId, lineCompression, marginTop, marginRight, marginBottom,
-                                marginLeft, extraParagraphSpacing,
-                                [this](std::unique_ptr<Page> page) { this->onPageComplete(std::move(page)); });
+  // Image sources are relative to the chapter's own location in the archive
+  const auto chapterDir = localPath.substr(0, localPath.find_last_of('/') + 1);
+  ChapterHtmlSlimParser visitor(
+      tmpHtmlPath, renderer, fontId, lineCompression, marginTop, marginRight, marginBottom, marginLeft,
+      extraParagraphSpacing, [this](std::unique_ptr<Page> page) { this->onPageComplete(std::move(page)); },
+      [this, &chapterDir](const char* src, const int maxWidth, const int maxHeight, std::string* imagePath,
+                          int* width, int* height) {
+        std::string href = src;
+        const auto fragment = href.find('#');
+        if (fragment != std::string::npos) {
+          href.erase(fragment);
+        }
+        if (href.empty() || href.find(':') != std::string::npos) {
+          // Remote or data URIs
+          return false;
+        }
+        return resolveImage(FsHelpers::normalisePath(chapterDir + href), maxWidth, maxHeight, imagePath, width,
+                            height);
+      });
+  // Chapters are often not well formed XML, the tokenizer lays out what it can instead of failing the whole chapter
+  visitor.setBackend(ChapterHtmlSlimParser::PULL_TOKENIZER);
+  // TOC entries pointing into the middle of this chapter get their page recorded while laying out
+  std::vector<std::string> tocAnchors;
+  for (int i = 0; i < epub->getTocItemsCount(); i++) {
+    const auto tocItem = epub->getTocItem(i);
+    if (tocItem.spineIndex == spineIndex && !tocItem.anchor.empty()) {
+      tocAnchors.push_back(tocItem.anchor);
+    }
+  }
+  visitor.setTocAnchors(std::move(tocAnchors));
+  // Books without stylesheets (or an old cache) just get the default styling
+  CssRuleTable cssRules;
+  if (cssRules.load(epub->getCssRuleTablePath())) {
+    visitor.setCssRuleTable(&cssRules);
+  }
+  resolvedImageNames.clear();
+  imagesConverted = false;
   success = visitor.parseAndBuildPages();
 
+  // One listing of the image directory per build, and only when this layout needed new image sizes
+  if (imagesConverted) {
+    // The image being replaced may still be open from drawing the last page
+    PageImage::closeOpenFile();
+    removeOtherImageSizes(epub->getCachePath() + "/images", resolvedImageNames);
+  }
+  resolvedImageNames.clear();
+
   SD.remove(tmpHtmlPath.c_str());
   if (!success) {
     Serial.printf("[%lu] [SCT] Failed to parse XML and build pages\n", millis());
     return false;
   }
 
+  tocAnchorPages = visitor.getTocAnchorPages();
+  pageTextOffsets = visitor.getPageTextOffsets();
   writeCacheMetadata(fontId, lineCompression, marginTop, marginRight, marginBottom, marginLeft, extraParagraphSpacing);
 
   return true;
 }
 
-std::unique_ptr<Page> Section::loadPageFromSD() const {
-  const auto filePath = cachePath + "/page_" + std::to_string(currentPage) + ".bin";
+std::shared_ptr<Page> Section::loadPageFromSD() { return loadPageFromSD(currentPage); }
+
+std::shared_ptr<Page> Section::loadPageFromSD(const int pageIndex) {
+  for (auto it = pageCache.begin(); it != pageCache.end(); ++it) {
+    if (it->pageIndex == pageIndex) {
+      pageCacheHits++;
+      pageCache.splice(pageCache.begin(), pageCache, it);
+      return pageCache.front().page;
+    }
+  }
+
+  pageCacheMisses++;
+  const auto filePath = cachePath + "/page_" + std::to_string(pageIndex) + ".bin";
 
   File inputFile;
   if (!FsHelpers::openFileForRead("SCT", filePath, inputFile)) {
     return nullptr;
   }
-  auto page = Page::deserialize(inputFile);
+  std::shared_ptr<Page> page = Page::deserialize(inputFile);
   inputFile.close();
+  if (!page) {
+    return nullptr;
+  }
+
+  const size_t pageBytes = page->getMemoryUsage();
+  if (pageBytes > PAGE_CACHE_BUDGET) {
+    return page;
+  }
+
+  // Evict least recently used pages until the new one fits, and while the heap is below the shared reserve. Evicted
+  // pages still on screen or pre-rendered are only freed once the reader lets go of them.
+  while (!pageCache.empty() &&
+         (pageCacheBytes + pageBytes > PAGE_CACHE_BUDGET || ESP.getFreeHeap() < RESERVED_HEAP)) {
+    pageCacheBytes -= pageCache.back().bytes;
+    pageCache.pop_back();
+  }
+  if (ESP.getFreeHeap() < RESERVED_HEAP) {
+    Serial.printf("[%lu] [SCT] Not caching page %d, free heap %d bytes\n", millis(), pageIndex, ESP.getFreeHeap());
+    return page;
+  }
+  pageCache.push_front({pageIndex, pageBytes, page});
+  pageCacheBytes += pageBytes;
+
   return page;
 }
+
+void Section::clearPageCache() {
+  pageCache.clear();
+  pageCacheBytes = 0;
+}
+
+int Section::getPageForAnchor(const std::string& anchor) const {
+  for (const auto& anchorPage : tocAnchorPages) {
+    if (anchorPage.first == anchor) {
+      return anchorPage.second;
+    }
+  }
+  return -1;
+}
+
+uint32_t Section::getTextOffsetForPage(const int pageIndex) const {
+  if (pageIndex < 0 || pageIndex >= static_cast<int>(pageTextOffsets.size())) {
+    return 0;
+  }
+  return pageTextOffsets[pageIndex];
+}
+
+int Section::getPageForTextOffset(const uint32_t textOffset) const {
+  const auto it = std::upper_bound(pageTextOffsets.begin(), pageTextOffsets.end(), textOffset);
+  return it == pageTextOffsets.begin() ? 0 : static_cast<int>(it - pageTextOffsets.begin()) - 1;
+}
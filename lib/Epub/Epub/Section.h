@@ -1,5 +1,10 @@
 #pragma once
+#include <list>
 #include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "Epub.h"
 
@@ -11,12 +16,37 @@ class Section {
   const int spineIndex;
   GfxRenderer& renderer;
   std::string cachePath;
+  // Page each TOC anchor in this chapter starts on
+  std::vector<std::pair<std::string, int>> tocAnchorPages;
+  // Text offset of the first word on each page, never decreasing
+  std::vector<uint32_t> pageTextOffsets;
 
   void writeCacheMetadata(int fontId, float lineCompression, int marginTop, int marginRight, int marginBottom,
                           int marginLeft, bool extraParagraphSpacing) const;
   void onPageComplete(std::unique_ptr<Page> page);
+  bool resolveImage(const std::string& itemHref, int maxWidth, int maxHeight, std::string* imagePath, int* width,
+                    int* height);
+  // Image files the current build points at, other sizes of them are pruned once it's done
+  std::set<std::string> resolvedImageNames;
+  bool imagesConverted = false;
+
+  struct CachedPage {
+    int pageIndex;
+    size_t bytes;
+    std::shared_ptr<Page> page;
+  };
+  // Most recently used deserialized pages first
+  std::list<CachedPage> pageCache;
+  size_t pageCacheBytes = 0;
+  uint32_t pageCacheHits = 0;
+  uint32_t pageCacheMisses = 0;
+  void clearPageCache();
 
  public:
+  // Free heap the page cache never eats into. The reader's look-ahead frame keeps the same reserve, so between them
+  // they leave room for indexing a chapter and decoding its images.
+  static constexpr size_t RESERVED_HEAP = 64 * 1024;
+
   int pageCount = 0;
   int currentPage = 0;
 
@@ -25,12 +55,19 @@ class Section {
         spineIndex(spineIndex),
         renderer(renderer),
         cachePath(epub->getCachePath() + "/" + std::to_string(spineIndex)) {}
-  ~Section() = default;
+  ~Section();
   bool loadCacheMetadata(int fontId, float lineCompression, int marginTop, int marginRight, int marginBottom,
                          int marginLeft, bool extraParagraphSpacing);
   void setupCacheDir() const;
-  bool clearCache() const;
+  bool clearCache();
   bool persistPageDataToSD(int fontId, float lineCompression, int marginTop, int marginRight, int marginBottom,
                            int marginLeft, bool extraParagraphSpacing);
-  std::unique_ptr<Page> loadPageFromSD() const;
+  std::shared_ptr<Page> loadPageFromSD();
+  std::shared_ptr<Page> loadPageFromSD(int pageIndex);
+  // -1 if the anchor isn't a TOC target in this chapter
+  int getPageForAnchor(const std::string& anchor) const;
+  // Text offsets count the chapter's words with one separator each, so they survive any change of layout
+  uint32_t getTextOffsetForPage(int pageIndex) const;
+  // Last page starting at or before the text offset
+  int getPageForTextOffset(uint32_t textOffset) const;
 };
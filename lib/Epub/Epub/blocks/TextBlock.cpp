@@ -3,13 +3,13 @@
 #include <GfxRenderer.h>
 #include <Serialization.h>
 
-void TextBlock::render(const GfxRenderer& renderer, const int fontId, const int x, const int y) const {
+void TextBlock::render(const GfxRenderer& renderer, const FontHandle& font, const int x, const int y) const {
   auto wordIt = words.begin();
   auto wordStylesIt = wordStyles.begin();
   auto wordXposIt = wordXpos.begin();
 
   for (int i = 0; i < words.size(); i++) {
-    renderer.drawText(fontId, *wordXposIt + x, y, wordIt->c_str(), true, *wordStylesIt);
+    renderer.drawText(font, *wordXposIt + x, y, wordIt->c_str(), true, *wordStylesIt);
 
     std::advance(wordIt, 1);
     std::advance(wordStylesIt, 1);
@@ -17,6 +17,22 @@ void TextBlock::render(const GfxRenderer& renderer, const int fontId, const int
   }
 }
 
+size_t TextBlock::getMemoryUsage() const {
+  // Each list node carries two pointers next to its value
+  constexpr size_t listNodeOverhead = 2 * sizeof(void*);
+  size_t bytes = sizeof(TextBlock);
+  for (const auto& word : words) {
+    bytes += listNodeOverhead + sizeof(std::string);
+    // Short strings live inside the string object itself
+    if (word.capacity() >= sizeof(std::string)) {
+      bytes += word.capacity() + 1;
+    }
+  }
+  bytes += wordXpos.size() * (listNodeOverhead + sizeof(uint16_t));
+  bytes += wordStyles.size() * (listNodeOverhead + sizeof(EpdFontStyle));
+  return bytes;
+}
+
 void TextBlock::serialize(File& file) const {
   // words
   const uint32_t wc = words.size();
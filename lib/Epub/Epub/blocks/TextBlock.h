@@ -8,6 +8,8 @@
 
 #include "Block.h"
 
+class FontHandle;
+
 // represents a block of words in the html document
 class TextBlock final : public Block {
  public:
@@ -32,10 +34,13 @@ class TextBlock final : public Block {
   void setStyle(const BLOCK_STYLE style) { this->style = style; }
   BLOCK_STYLE getStyle() const { return style; }
   bool isEmpty() override { return words.empty(); }
+  size_t getWordCount() const { return words.size(); }
   void layout(GfxRenderer& renderer) override {};
   // given a renderer works out where to break the words into lines
-  void render(const GfxRenderer& renderer, int fontId, int x, int y) const;
+  void render(const GfxRenderer& renderer, const FontHandle& font, int x, int y) const;
   BlockType getType() override { return TEXT_BLOCK; }
   void serialize(File& file) const;
   static std::unique_ptr<TextBlock> deserialize(File& file);
+  // Approximate heap bytes held by this block, including list nodes and string storage
+  size_t getMemoryUsage() const;
 };
@@ -1,163 +1,293 @@
-// from
+// Entity table from
 // https://github.com/atomic14/diy-esp32-epub-reader/blob/2c2f57fdd7e2a788d14a0bcb26b9e845a47aac42/lib/Epub/RubbishHtmlParser/htmlEntities.cpp
 
 #include "htmlEntities.h"
 
+#include <array>
+#include <cstdint>
 #include <cstring>
-#include <unordered_map>
 
-const int MAX_ENTITY_LENGTH = 10;
+namespace {
+struct HtmlEntity {
+  const char* name;
+  const char* utf8;
+};
 
 // Use book: entities_ww2.epub to test this (Page 7: Entities parser test)
-// Note the supported keys are only in lowercase
-// Store the mappings in a unordered hash map
-static std::unordered_map<std::string, std::string> entity_lookup(
-    {{"&quot;", "\""},  {"&frasl;", "⁄"},   {"&amp;", "&"},      {"&lt;", "<"},     {"&gt;", ">"},
-     {"&Agrave;", "À"}, {"&Aacute;", "Á"},  {"&Acirc;", "Â"},    {"&Atilde;", "Ã"}, {"&Auml;", "Ä"},
-     {"&Aring;", "Å"},  {"&AElig;", "Æ"},   {"&Ccedil;", "Ç"},   {"&Egrave;", "È"}, {"&Eacute;", "É"},
-     {"&Ecirc;", "Ê"},  {"&Euml;", "Ë"},    {"&Igrave;", "Ì"},   {"&Iacute;", "Í"}, {"&Icirc;", "Î"},
-     {"&Iuml;", "Ï"},   {"&ETH;", "Ð"},     {"&Ntilde;", "Ñ"},   {"&Ograve;", "Ò"}, {"&Oacute;", "Ó"},
-     {"&Ocirc;", "Ô"},  {"&Otilde;", "Õ"},  {"&Ouml;", "Ö"},     {"&Oslash;", "Ø"}, {"&Ugrave;", "Ù"},
-     {"&Uacute;", "Ú"}, {"&Ucirc;", "Û"},   {"&Uuml;", "Ü"},     {"&Yacute;", "Ý"}, {"&THORN;", "Þ"},
-     {"&szlig;", "ß"},  {"&agrave;", "à"},  {"&aacute;", "á"},   {"&acirc;", "â"},  {"&atilde;", "ã"},
-     {"&auml;", "ä"},   {"&aring;", "å"},   {"&aelig;", "æ"},    {"&ccedil;", "ç"}, {"&egrave;", "è"},
-     {"&eacute;", "é"}, {"&ecirc;", "ê"},   {"&euml;", "ë"},     {"&igrave;", "ì"}, {"&iacute;", "í"},
-     {"&icirc;", "î"},  {"&iuml;", "ï"},    {"&eth;", "ð"},      {"&ntilde;", "ñ"}, {"&ograve;", "ò"},
-     {"&oacute;", "ó"}, {"&ocirc;", "ô"},   {"&otilde;", "õ"},   {"&ouml;", "ö"},   {"&oslash;", "ø"},
-     {"&ugrave;", "ù"}, {"&uacute;", "ú"},  {"&ucirc;", "û"},    {"&uuml;", "ü"},   {"&yacute;", "ý"},
-     {"&thorn;", "þ"},  {"&yuml;", "ÿ"},    {"&nbsp;", " "},     {"&iexcl;", "¡"},  {"&cent;", "¢"},
-     {"&pound;", "£"},  {"&curren;", "¤"},  {"&yen;", "¥"},      {"&brvbar;", "¦"}, {"&sect;", "§"},
-     {"&uml;", "¨"},    {"&copy;", "©"},    {"&ordf;", "ª"},     {"&laquo;", "«"},  {"&not;", "¬"},
-     {"&shy;", "­"},    {"&reg;", "®"},     {"&macr;", "¯"},     {"&deg;", "°"},    {"&plusmn;", "±"},
-     {"&sup2;", "²"},   {"&sup3;", "³"},    {"&acute;", "´"},    {"&micro;", "µ"},  {"&para;", "¶"},
-     {"&cedil;", "¸"},  {"&sup1;", "¹"},    {"&ordm;", "º"},     {"&raquo;", "»"},  {"&frac14;", "¼"},
-     {"&frac12;", "½"}, {"&frac34;", "¾"},  {"&iquest;", "¿"},   {"&times;", "×"},  {"&divide;", "÷"},
-     {"&forall;", "∀"}, {"&part;", "∂"},    {"&exist;", "∃"},    {"&empty;", "∅"},  {"&nabla;", "∇"},
-     {"&isin;", "∈"},   {"&notin;", "∉"},   {"&ni;", "∋"},       {"&prod;", "∏"},   {"&sum;", "∑"},
-     {"&minus;", "−"},  {"&lowast;", "∗"},  {"&radic;", "√"},    {"&prop;", "∝"},   {"&infin;", "∞"},
-     {"&ang;", "∠"},    {"&and;", "∧"},     {"&or;", "∨"},       {"&cap;", "∩"},    {"&cup;", "∪"},
-     {"&int;", "∫"},    {"&there4;", "∴"},  {"&sim;", "∼"},      {"&cong;", "≅"},   {"&asymp;", "≈"},
-     {"&ne;", "≠"},     {"&equiv;", "≡"},   {"&le;", "≤"},       {"&ge;", "≥"},     {"&sub;", "⊂"},
-     {"&sup;", "⊃"},    {"&nsub;", "⊄"},    {"&sube;", "⊆"},     {"&supe;", "⊇"},   {"&oplus;", "⊕"},
-     {"&otimes;", "⊗"}, {"&perp;", "⊥"},    {"&sdot;", "⋅"},     {"&Alpha;", "Α"},  {"&Beta;", "Β"},
-     {"&Gamma;", "Γ"},  {"&Delta;", "Δ"},   {"&Epsilon;", "Ε"},  {"&Zeta;", "Ζ"},   {"&Eta;", "Η"},
-     {"&Theta;", "Θ"},  {"&Iota;", "Ι"},    {"&Kappa;", "Κ"},    {"&Lambda;", "Λ"}, {"&Mu;", "Μ"},
-     {"&Nu;", "Ν"},     {"&Xi;", "Ξ"},      {"&Omicron;", "Ο"},  {"&Pi;", "Π"},     {"&Rho;", "Ρ"},
-     {"&Sigma;", "Σ"},  {"&Tau;", "Τ"},     {"&Upsilon;", "Υ"},  {"&Phi;", "Φ"},    {"&Chi;", "Χ"},
-     {"&Psi;", "Ψ"},    {"&Omega;", "Ω"},   {"&alpha;", "α"},    {"&beta;", "β"},   {"&gamma;", "γ"},
-     {"&delta;", "δ"},  {"&epsilon;", "ε"}, {"&zeta;", "ζ"},     {"&eta;", "η"},    {"&theta;", "θ"},
-     {"&iota;", "ι"},   {"&kappa;", "κ"},   {"&lambda;", "λ"},   {"&mu;", "μ"},     {"&nu;", "ν"},
-     {"&xi;", "ξ"},     {"&omicron;", "ο"}, {"&pi;", "π"},       {"&rho;", "ρ"},    {"&sigmaf;", "ς"},
-     {"&sigma;", "σ"},  {"&tau;", "τ"},     {"&upsilon;", "υ"},  {"&phi;", "φ"},    {"&chi;", "χ"},
-     {"&psi;", "ψ"},    {"&omega;", "ω"},   {"&thetasym;", "ϑ"}, {"&upsih;", "ϒ"},  {"&piv;", "ϖ"},
-     {"&OElig;", "Œ"},  {"&oelig;", "œ"},   {"&Scaron;", "Š"},   {"&scaron;", "š"}, {"&Yuml;", "Ÿ"},
-     {"&fnof;", "ƒ"},   {"&circ;", "ˆ"},    {"&tilde;", "˜"},    {"&ensp;", ""},    {"&emsp;", ""},
-     {"&thinsp;", ""},  {"&zwnj;", "‌"},  {"&zwj;", "‍"},    {"&lrm;", "‎"},  {"&rlm;", "‏"},
-     {"&ndash;", "–"},  {"&mdash;", "—"},   {"&lsquo;", "‘"},    {"&rsquo;", "’"},  {"&sbquo;", "‚"},
-     {"&ldquo;", "“"},  {"&rdquo;", "”"},   {"&bdquo;", "„"},    {"&dagger;", "†"}, {"&Dagger;", "‡"},
-     {"&bull;", "•"},   {"&hellip;", "…"},  {"&permil;", "‰"},   {"&prime;", "′"},  {"&Prime;", "″"},
-     {"&lsaquo;", "‹"}, {"&rsaquo;", "›"},  {"&oline;", "‾"},    {"&euro;", "€"},   {"&trade;", "™"},
-     {"&larr;", "←"},   {"&uarr;", "↑"},    {"&rarr;", "→"},     {"&darr;", "↓"},   {"&harr;", "↔"},
-     {"&crarr;", "↵"},  {"&lceil;", "⌈"},   {"&rceil;", "⌉"},    {"&lfloor;", "⌊"}, {"&rfloor;", "⌋"},
-     {"&loz;", "◊"},    {"&spades;", "♠"},  {"&clubs;", "♣"},    {"&hearts;", "♥"}, {"&diams;", "♦"}});
-
-// converts from a unicode code point to the utf8 equivalent
-void convert_to_utf8(const int code, std::string& res) {
-  // convert to a utf8 sequence
-  if (code < 0x80) {
-    res += static_cast<char>(code);
-  } else if (code < 0x800) {
-    res += static_cast<char>(0xc0 | (code >> 6));
-    res += static_cast<char>(0x80 | (code & 0x3f));
-  } else if (code < 0x10000) {
-    res += static_cast<char>(0xe0 | (code >> 12));
-    res += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
-    res += static_cast<char>(0x80 | (code & 0x3f));
-  } else if (code < 0x200000) {
-    res += static_cast<char>(0xf0 | (code >> 18));
-    res += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
-    res += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
-    res += static_cast<char>(0x80 | (code & 0x3f));
-  } else if (code < 0x4000000) {
-    res += static_cast<char>(0xf8 | (code >> 24));
-    res += static_cast<char>(0x80 | ((code >> 18) & 0x3f));
-    res += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
-    res += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
-    res += static_cast<char>(0x80 | (code & 0x3f));
-  } else if (code < 0x80000000) {
-    res += static_cast<char>(0xfc | (code >> 30));
-    res += static_cast<char>(0x80 | ((code >> 24) & 0x3f));
-    res += static_cast<char>(0x80 | ((code >> 18) & 0x3f));
-    res += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
-    res += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+// Names are case sensitive
+constexpr HtmlEntity ENTITIES[] = {
+    {"quot", "\""},  {"frasl", "⁄"},   {"amp", "&"},      {"lt", "<"},     {"gt", ">"},
+    {"Agrave", "À"}, {"Aacute", "Á"},  {"Acirc", "Â"},    {"Atilde", "Ã"}, {"Auml", "Ä"},
+    {"Aring", "Å"},  {"AElig", "Æ"},   {"Ccedil", "Ç"},   {"Egrave", "È"}, {"Eacute", "É"},
+    {"Ecirc", "Ê"},  {"Euml", "Ë"},    {"Igrave", "Ì"},   {"Iacute", "Í"}, {"Icirc", "Î"},
+    {"Iuml", "Ï"},   {"ETH", "Ð"},     {"Ntilde", "Ñ"},   {"Ograve", "Ò"}, {"Oacute", "Ó"},
+    {"Ocirc", "Ô"},  {"Otilde", "Õ"},  {"Ouml", "Ö"},     {"Oslash", "Ø"}, {"Ugrave", "Ù"},
+    {"Uacute", "Ú"}, {"Ucirc", "Û"},   {"Uuml", "Ü"},     {"Yacute", "Ý"}, {"THORN", "Þ"},
+    {"szlig", "ß"},  {"agrave", "à"},  {"aacute", "á"},   {"acirc", "â"},  {"atilde", "ã"},
+    {"auml", "ä"},   {"aring", "å"},   {"aelig", "æ"},    {"ccedil", "ç"}, {"egrave", "è"},
+    {"eacute", "é"}, {"ecirc", "ê"},   {"euml", "ë"},     {"igrave", "ì"}, {"iacute", "í"},
+    {"icirc", "î"},  {"iuml", "ï"},    {"eth", "ð"},      {"ntilde", "ñ"}, {"ograve", "ò"},
+    {"oacute", "ó"}, {"ocirc", "ô"},   {"otilde", "õ"},   {"ouml", "ö"},   {"oslash", "ø"},
+    {"ugrave", "ù"}, {"uacute", "ú"},  {"ucirc", "û"},    {"uuml", "ü"},   {"yacute", "ý"},
+    {"thorn", "þ"},  {"yuml", "ÿ"},    {"nbsp", " "},     {"iexcl", "¡"},  {"cent", "¢"},
+    {"pound", "£"},  {"curren", "¤"},  {"yen", "¥"},      {"brvbar", "¦"}, {"sect", "§"},
+    {"uml", "¨"},    {"copy", "©"},    {"ordf", "ª"},     {"laquo", "«"},  {"not", "¬"},
+    {"shy", "­"},    {"reg", "®"},     {"macr", "¯"},     {"deg", "°"},    {"plusmn", "±"},
+    {"sup2", "²"},   {"sup3", "³"},    {"acute", "´"},    {"micro", "µ"},  {"para", "¶"},
+    {"cedil", "¸"},  {"sup1", "¹"},    {"ordm", "º"},     {"raquo", "»"},  {"frac14", "¼"},
+    {"frac12", "½"}, {"frac34", "¾"},  {"iquest", "¿"},   {"times", "×"},  {"divide", "÷"},
+    {"forall", "∀"}, {"part", "∂"},    {"exist", "∃"},    {"empty", "∅"},  {"nabla", "∇"},
+    {"isin", "∈"},   {"notin", "∉"},   {"ni", "∋"},       {"prod", "∏"},   {"sum", "∑"},
+    {"minus", "−"},  {"lowast", "∗"},  {"radic", "√"},    {"prop", "∝"},   {"infin", "∞"},
+    {"ang", "∠"},    {"and", "∧"},     {"or", "∨"},       {"cap", "∩"},    {"cup", "∪"},
+    {"int", "∫"},    {"there4", "∴"},  {"sim", "∼"},      {"cong", "≅"},   {"asymp", "≈"},
+    {"ne", "≠"},     {"equiv", "≡"},   {"le", "≤"},       {"ge", "≥"},     {"sub", "⊂"},
+    {"sup", "⊃"},    {"nsub", "⊄"},    {"sube", "⊆"},     {"supe", "⊇"},   {"oplus", "⊕"},
+    {"otimes", "⊗"}, {"perp", "⊥"},    {"sdot", "⋅"},     {"Alpha", "Α"},  {"Beta", "Β"},
+    {"Gamma", "Γ"},  {"Delta", "Δ"},   {"Epsilon", "Ε"},  {"Zeta", "Ζ"},   {"Eta", "Η"},
+    {"Theta", "Θ"},  {"Iota", "Ι"},    {"Kappa", "Κ"},    {"Lambda", "Λ"}, {"Mu", "Μ"},
+    {"Nu", "Ν"},     {"Xi", "Ξ"},      {"Omicron", "Ο"},  {"Pi", "Π"},     {"Rho", "Ρ"},
+    {"Sigma", "Σ"},  {"Tau", "Τ"},     {"Upsilon", "Υ"},  {"Phi", "Φ"},    {"Chi", "Χ"},
+    {"Psi", "Ψ"},    {"Omega", "Ω"},   {"alpha", "α"},    {"beta", "β"},   {"gamma", "γ"},
+    {"delta", "δ"},  {"epsilon", "ε"}, {"zeta", "ζ"},     {"eta", "η"},    {"theta", "θ"},
+    {"iota", "ι"},   {"kappa", "κ"},   {"lambda", "λ"},   {"mu", "μ"},     {"nu", "ν"},
+    {"xi", "ξ"},     {"omicron", "ο"}, {"pi", "π"},       {"rho", "ρ"},    {"sigmaf", "ς"},
+    {"sigma", "σ"},  {"tau", "τ"},     {"upsilon", "υ"},  {"phi", "φ"},    {"chi", "χ"},
+    {"psi", "ψ"},    {"omega", "ω"},   {"thetasym", "ϑ"}, {"upsih", "ϒ"},  {"piv", "ϖ"},
+    {"OElig", "Œ"},  {"oelig", "œ"},   {"Scaron", "Š"},   {"scaron", "š"}, {"Yuml", "Ÿ"},
+    {"fnof", "ƒ"},   {"circ", "ˆ"},    {"tilde", "˜"},    {"ensp", " "},   {"emsp", " "},
+    {"thinsp", " "}, {"zwnj", "‌"},    {"zwj", "‍"},      {"lrm", "‎"},    {"rlm", "‏"},
+    {"ndash", "–"},  {"mdash", "—"},   {"lsquo", "‘"},    {"rsquo", "’"},  {"sbquo", "‚"},
+    {"ldquo", "“"},  {"rdquo", "”"},   {"bdquo", "„"},    {"dagger", "†"}, {"Dagger", "‡"},
+    {"bull", "•"},   {"hellip", "…"},  {"permil", "‰"},   {"prime", "′"},  {"Prime", "″"},
+    {"lsaquo", "‹"}, {"rsaquo", "›"},  {"oline", "‾"},    {"euro", "€"},   {"trade", "™"},
+    {"larr", "←"},   {"uarr", "↑"},    {"rarr", "→"},     {"darr", "↓"},   {"harr", "↔"},
+    {"crarr", "↵"},  {"lceil", "⌈"},   {"rceil", "⌉"},    {"lfloor", "⌊"}, {"rfloor", "⌋"},
+    {"loz", "◊"},    {"spades", "♠"},  {"clubs", "♣"},    {"hearts", "♥"}, {"diams", "♦"},
+    {"apos", "'"}
+};
+constexpr size_t NUM_ENTITIES = sizeof(ENTITIES) / sizeof(ENTITIES[0]);
+
+// Two level perfect hash (hash and displace): the first hash picks a bucket, the bucket's displacement is mixed
+// into the hash to pick the slot. Displacements are searched for at compile time so every name lands in its own slot.
+constexpr int NUM_BUCKETS = 64;
+constexpr int NUM_SLOTS = 512;
+constexpr uint16_t EMPTY_SLOT = 0xFFFF;
+static_assert(NUM_ENTITIES < NUM_SLOTS / 2, "Entity hash table is too full");
+
+constexpr size_t constLength(const char* text) {
+  size_t length = 0;
+  while (text[length]) {
+    length++;
+  }
+  return length;
+}
+
+// FNV-1a
+constexpr uint32_t hashName(const char* name, const size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ static_cast<uint8_t>(name[i])) * 16777619u;
+  }
+  return hash;
+}
+
+constexpr int slotFor(const uint32_t hash, const uint16_t displacement) {
+  uint32_t mixed = hash ^ (displacement * 0x9E3779B1u);
+  mixed ^= mixed >> 16;
+  mixed *= 0x85EBCA6Bu;
+  mixed ^= mixed >> 13;
+  return mixed & (NUM_SLOTS - 1);
+}
+
+struct EntityHashTable {
+  std::array<uint16_t, NUM_BUCKETS> displacements{};
+  std::array<uint16_t, NUM_SLOTS> slots{};
+  size_t maxNameLength = 0;
+  bool valid = false;
+};
+
+constexpr EntityHashTable buildEntityHashTable() {
+  EntityHashTable table;
+  std::array<uint32_t, NUM_ENTITIES> hashes{};
+  std::array<int, NUM_BUCKETS> bucketSizes{};
+  for (size_t i = 0; i < NUM_ENTITIES; i++) {
+    const size_t length = constLength(ENTITIES[i].name);
+    hashes[i] = hashName(ENTITIES[i].name, length);
+    bucketSizes[hashes[i] % NUM_BUCKETS]++;
+    if (length > table.maxNameLength) {
+      table.maxNameLength = length;
+    }
+  }
+  for (auto& slot : table.slots) {
+    slot = EMPTY_SLOT;
+  }
+
+  // Place the fullest buckets first while the table is still mostly empty
+  std::array<int, NUM_BUCKETS> order{};
+  for (int i = 0; i < NUM_BUCKETS; i++) {
+    int j = i;
+    while (j > 0 && bucketSizes[order[j - 1]] < bucketSizes[i]) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  for (const int bucket : order) {
+    bool placed = false;
+    for (uint32_t displacement = 0; displacement < EMPTY_SLOT && !placed; displacement++) {
+      placed = true;
+      std::array<bool, NUM_SLOTS> taken{};
+      for (size_t i = 0; i < NUM_ENTITIES && placed; i++) {
+        if (hashes[i] % NUM_BUCKETS != static_cast<uint32_t>(bucket)) {
+          continue;
+        }
+        const int slot = slotFor(hashes[i], displacement);
+        placed = table.slots[slot] == EMPTY_SLOT && !taken[slot];
+        taken[slot] = true;
+      }
+      if (placed) {
+        table.displacements[bucket] = displacement;
+        for (size_t i = 0; i < NUM_ENTITIES; i++) {
+          if (hashes[i] % NUM_BUCKETS == static_cast<uint32_t>(bucket)) {
+            table.slots[slotFor(hashes[i], displacement)] = i;
+          }
+        }
+      }
+    }
+    if (!placed) {
+      return table;
+    }
   }
+
+  table.valid = true;
+  return table;
+}
+
+constexpr EntityHashTable ENTITY_HASH_TABLE = buildEntityHashTable();
+static_assert(ENTITY_HASH_TABLE.valid, "No perfect hash found for the entity table");
+
+// Longest possible reference between '&' and ';', either a name or "#x10FFFF"
+constexpr size_t MAX_REFERENCE_LENGTH = ENTITY_HASH_TABLE.maxNameLength > 8 ? ENTITY_HASH_TABLE.maxNameLength : 8;
+
+const HtmlEntity* findEntity(const char* name, const size_t length) {
+  const uint32_t hash = hashName(name, length);
+  const uint16_t index = ENTITY_HASH_TABLE.slots[slotFor(hash, ENTITY_HASH_TABLE.displacements[hash % NUM_BUCKETS])];
+  if (index == EMPTY_SLOT) {
+    return nullptr;
+  }
+  const HtmlEntity& entity = ENTITIES[index];
+  if (strncmp(entity.name, name, length) != 0 || entity.name[length] != '\0') {
+    return nullptr;
+  }
+  return &entity;
 }
 
-// handles numeric entities - e.g. &#1234; or &#x1234;
-bool process_numeric_entity(const std::string& entity, std::string& res) {
-  int code = 0;
-  // is it hex?
-  if (entity[2] == 'x' || entity[2] == 'X') {
-    // parse the hex code
-    code = strtol(entity.substr(3, entity.size() - 3).c_str(), nullptr, 16);
-  } else {
-    code = strtol(entity.substr(2, entity.size() - 3).c_str(), nullptr, 10);
-  }
-  if (code != 0) {
-    // special handling for nbsp
-    if (code == 0xA0) {
-      res += " ";
+// Parses the digits of a numeric reference (after "&#"), returns 0 if they aren't a valid code point
+uint32_t parseCodePoint(const char* digits, const size_t length) {
+  const bool hex = length > 0 && (digits[0] == 'x' || digits[0] == 'X');
+  size_t i = hex ? 1 : 0;
+  if (i == length) {
+    return 0;
+  }
+
+  uint32_t code = 0;
+  for (; i < length; i++) {
+    const char c = digits[i];
+    uint32_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (hex && c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (hex && c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
     } else {
-      convert_to_utf8(code, res);
+      return 0;
+    }
+    code = code * (hex ? 16 : 10) + digit;
+    if (code > 0x10FFFF) {
+      return 0;
     }
-    return true;
   }
-  return false;
+
+  if (code >= 0xD800 && code <= 0xDFFF) {
+    return 0;
+  }
+  return code;
 }
 
-// handles named entities - e.g. &amp;
-bool process_string_entity(const std::string& entity, std::string& res) {
-  // it's a named entity - find it in the lookup table
-  // find it in the map
-  const auto it = entity_lookup.find(entity);
-  if (it != entity_lookup.end()) {
-    res += it->second;
-    return true;
+size_t writeUtf8(const uint32_t code, char* out) {
+  if (code < 0x80) {
+    out[0] = static_cast<char>(code);
+    return 1;
   }
-  return false;
+  if (code < 0x800) {
+    out[0] = static_cast<char>(0xC0 | (code >> 6));
+    out[1] = static_cast<char>(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000) {
+    out[0] = static_cast<char>(0xE0 | (code >> 12));
+    out[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (code & 0x3F));
+    return 3;
+  }
+  out[0] = static_cast<char>(0xF0 | (code >> 18));
+  out[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+  out[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+  out[3] = static_cast<char>(0x80 | (code & 0x3F));
+  return 4;
+}
+
+// Decodes the reference between '&' and ';' into out, returns the number of bytes written or 0 if it isn't one
+size_t decodeReference(const char* reference, const size_t length, char* out) {
+  if (reference[0] == '#') {
+    const uint32_t code = parseCodePoint(reference + 1, length - 1);
+    if (code == 0) {
+      return 0;
+    }
+    // Non-breaking spaces are laid out as regular spaces
+    return writeUtf8(code == 0xA0 ? ' ' : code, out);
+  }
+
+  const HtmlEntity* entity = findEntity(reference, length);
+  if (!entity) {
+    return 0;
+  }
+  const size_t utf8Length = strlen(entity->utf8);
+  memcpy(out, entity->utf8, utf8Length);
+  return utf8Length;
 }
+}  // namespace
+
+size_t decodeHtmlEntities(char* text, const size_t length) {
+  const char* ampersand = static_cast<const char*>(memchr(text, '&', length));
+  if (!ampersand) {
+    return length;
+  }
 
-// replace all the entities in the string
-std::string replaceHtmlEntities(const char* text) {
-  std::string res;
-  res.reserve(strlen(text));
-  for (int i = 0; i < strlen(text); ++i) {
-    bool flag = false;
-    // do we have a potential entity?
-    if (text[i] == '&') {
-      // find the end of the entity
-      int j = i + 1;
-      while (j < strlen(text) && text[j] != ';' && j - i < MAX_ENTITY_LENGTH) {
-        j++;
+  // Every decoded entity is no longer than its reference, so the write position never passes the read position
+  size_t write = ampersand - text;
+  size_t read = write;
+  while (read < length) {
+    if (text[read] == '&') {
+      size_t end = read + 1;
+      while (end < length && end - read <= MAX_REFERENCE_LENGTH && text[end] != ';' && text[end] != '&') {
+        end++;
       }
-      if (j - i > 2) {
-        char entity[j - i + 1];
-        strncpy(entity, text + i, j - i);
-        // is it a numeric code?
-        if (entity[1] == '#') {
-          flag = process_numeric_entity(entity, res);
-        } else {
-          flag = process_string_entity(entity, res);
-        }
-        // skip past the entity if we successfully decoded it
-        if (flag) {
-          i = j;
+      if (end < length && text[end] == ';' && end > read + 1) {
+        char decoded[4];
+        const size_t decodedLength = decodeReference(text + read + 1, end - read - 1, decoded);
+        if (decodedLength > 0) {
+          memcpy(text + write, decoded, decodedLength);
+          write += decodedLength;
+          read = end + 1;
+          continue;
         }
       }
     }
-    if (!flag) {
-      res += text[i];
-    }
+    text[write++] = text[read++];
   }
-  return res;
+  return write;
 }
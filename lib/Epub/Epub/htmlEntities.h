@@ -1,7 +1,9 @@
-// from
+// Entity table from
 // https://github.com/atomic14/diy-esp32-epub-reader/blob/2c2f57fdd7e2a788d14a0bcb26b9e845a47aac42/lib/Epub/RubbishHtmlParser/htmlEntities.cpp
 
 #pragma once
-#include <string>
+#include <cstddef>
 
-std::string replaceHtmlEntities(const char* text);
+// Decodes named (&amp;), decimal (&#8217;) and hex (&#x2019;) entities in place and returns the new length.
+// Decoded text is never longer than the entity it replaces, text does not need to be null terminated.
+size_t decodeHtmlEntities(char* text, size_t length);
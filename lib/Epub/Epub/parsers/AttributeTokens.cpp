@@ -0,0 +1,21 @@
+#include "AttributeTokens.h"
+
+#include <cstring>
+
+bool hasAttributeToken(const char* tokens, const char* token) {
+  const size_t length = strlen(token);
+  for (const char* start = tokens; *start;) {
+    while (*start == ' ') {
+      start++;
+    }
+    const char* end = start;
+    while (*end && *end != ' ') {
+      end++;
+    }
+    if (static_cast<size_t>(end - start) == length && strncmp(start, token, length) == 0) {
+      return true;
+    }
+    start = end;
+  }
+  return false;
+}
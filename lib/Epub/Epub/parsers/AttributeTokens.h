@@ -0,0 +1,4 @@
+#pragma once
+
+// Whether a space separated attribute value such as epub:type="toc landmarks" or properties="nav" holds token
+bool hasAttributeToken(const char* tokens, const char* token);
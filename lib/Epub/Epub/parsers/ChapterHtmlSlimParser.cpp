@@ -5,39 +5,15 @@
 #include <HardwareSerial.h>
 #include <expat.h>
 
+#include <algorithm>
+
 #include "../Page.h"
 #include "../htmlEntities.h"
-
-const char* HEADER_TAGS[] = {"h1", "h2", "h3", "h4", "h5", "h6"};
-constexpr int NUM_HEADER_TAGS = sizeof(HEADER_TAGS) / sizeof(HEADER_TAGS[0]);
-
-const char* BLOCK_TAGS[] = {"p", "li", "div", "br", "blockquote"};
-constexpr int NUM_BLOCK_TAGS = sizeof(BLOCK_TAGS) / sizeof(BLOCK_TAGS[0]);
-
-const char* BOLD_TAGS[] = {"b", "strong"};
-constexpr int NUM_BOLD_TAGS = sizeof(BOLD_TAGS) / sizeof(BOLD_TAGS[0]);
-
-const char* ITALIC_TAGS[] = {"i", "em"};
-constexpr int NUM_ITALIC_TAGS = sizeof(ITALIC_TAGS) / sizeof(ITALIC_TAGS[0]);
-
-const char* IMAGE_TAGS[] = {"img"};
-constexpr int NUM_IMAGE_TAGS = sizeof(IMAGE_TAGS) / sizeof(IMAGE_TAGS[0]);
-
-const char* SKIP_TAGS[] = {"head", "table"};
-constexpr int NUM_SKIP_TAGS = sizeof(SKIP_TAGS) / sizeof(SKIP_TAGS[0]);
+#include "HtmlTagClassifier.h"
+#include "XhtmlTokenizer.h"
 
 bool isWhitespace(const char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
 
-// given the start and end of a tag, check to see if it matches a known tag
-bool matches(const char* tag_name, const char* possible_tags[], const int possible_tag_count) {
-  for (int i = 0; i < possible_tag_count; i++) {
-    if (strcmp(tag_name, possible_tags[i]) == 0) {
-      return true;
-    }
-  }
-  return false;
-}
-
 // start a new text block if needed
 void ChapterHtmlSlimParser::startNewTextBlock(const TextBlock::BLOCK_STYLE style) {
   if (currentTextBlock) {
@@ -52,6 +28,145 @@ void ChapterHtmlSlimParser::startNewTextBlock(const TextBlock::BLOCK_STYLE style
   currentTextBlock.reset(new ParsedText(style, extraParagraphSpacing));
 }
 
+// Stylesheet rules for the element's tag and classes, overridden by its style attribute
+CssStyle ChapterHtmlSlimParser::elementStyle(const char* name, const XML_Char** atts) const {
+  const char* classAttribute = nullptr;
+  const char* styleAttribute = nullptr;
+  for (int i = 0; atts != nullptr && atts[i]; i += 2) {
+    if (strcmp(atts[i], "class") == 0) {
+      classAttribute = atts[i + 1];
+    } else if (strcmp(atts[i], "style") == 0) {
+      styleAttribute = atts[i + 1];
+    }
+  }
+
+  CssStyle style;
+  if (cssRules) {
+    style = cssRules->lookup(name, classAttribute);
+  }
+  if (styleAttribute) {
+    style.merge(CssStyle::parseDeclarations(styleAttribute, strlen(styleAttribute)));
+  }
+  return style;
+}
+
+EpdFontStyle ChapterHtmlSlimParser::currentFontStyle() const {
+  if (boldUntilDepth < depth && italicUntilDepth < depth) {
+    return BOLD_ITALIC;
+  }
+  if (boldUntilDepth < depth) {
+    return BOLD;
+  }
+  if (italicUntilDepth < depth) {
+    return ITALIC;
+  }
+  return REGULAR;
+}
+
+// hand the buffered word to the current text block, or to wordFn when extracting. Expat has already decoded entities,
+// the tokenizer leaves them in the text so they're decoded here in place.
+void ChapterHtmlSlimParser::flushPartWord(const EpdFontStyle fontStyle) {
+  const size_t length =
+      backend == PULL_TOKENIZER ? decodeHtmlEntities(partWordBuffer, partWordBufferIndex) : partWordBufferIndex;
+  partWordBufferIndex = 0;
+  if (wordFn) {
+    if (!wordFn(partWordBuffer, length, textOffset)) {
+      stopped = true;
+    }
+    textOffset += length + 1;
+    return;
+  }
+  currentTextBlock->addWord(std::string(partWordBuffer, length), fontStyle);
+  // Words are counted with one separator each, so offsets don't depend on the source's whitespace
+  pendingWordOffsets.push_back(textOffset);
+  textOffset += length + 1;
+}
+
+void ChapterHtmlSlimParser::setTocAnchors(std::vector<std::string> anchors) {
+  std::sort(anchors.begin(), anchors.end());
+  anchors.erase(std::unique(anchors.begin(), anchors.end()), anchors.end());
+  tocAnchors = std::move(anchors);
+  tocAnchorSeen.assign(tocAnchors.size(), false);
+}
+
+void ChapterHtmlSlimParser::checkTocAnchor(const XML_Char** atts) {
+  for (int i = 0; atts != nullptr && atts[i]; i += 2) {
+    if (strcmp(atts[i], "id") != 0) {
+      continue;
+    }
+    const auto it = std::lower_bound(tocAnchors.begin(), tocAnchors.end(), atts[i + 1],
+                                     [](const std::string& anchor, const char* id) { return anchor < id; });
+    if (it != tocAnchors.end() && *it == atts[i + 1]) {
+      const int index = it - tocAnchors.begin();
+      // Only the first element with an id counts, like a browser
+      if (!tocAnchorSeen[index]) {
+        tocAnchorSeen[index] = true;
+        pendingTocAnchors.push_back(index);
+      }
+    }
+    return;
+  }
+}
+
+void ChapterHtmlSlimParser::placePendingTocAnchors() {
+  for (const int index : pendingTocAnchors) {
+    tocAnchorPages.emplace_back(tocAnchors[index], completedPageCount);
+  }
+  pendingTocAnchors.clear();
+}
+
+void ChapterHtmlSlimParser::notePageTextOffset(const uint32_t offset) {
+  // The first thing placed on a page fixes where it starts in the text
+  if (static_cast<int>(pageTextOffsets.size()) == completedPageCount) {
+    pageTextOffsets.push_back(offset);
+  }
+}
+
+void ChapterHtmlSlimParser::completePage() {
+  notePageTextOffset(textOffset);
+  completePageFn(std::move(currentPage));
+  completedPageCount++;
+}
+
+// lay out the text so far, then place the image on its own rows below it
+void ChapterHtmlSlimParser::addImage(const char* src) {
+  const int pageHeight = GfxRenderer::getScreenHeight() - marginTop - marginBottom;
+  const int maxWidth = GfxRenderer::getScreenWidth() - marginLeft - marginRight;
+  // Leave room for the top edge being pushed down onto a multiple of 8 rows
+  const int maxHeight = pageHeight - marginTop - 8;
+
+  std::string imagePath;
+  int width;
+  int height;
+  if (maxWidth <= 0 || maxHeight <= 0 || !imageResolverFn(src, maxWidth, maxHeight, &imagePath, &width, &height)) {
+    return;
+  }
+
+  startNewTextBlock(currentTextBlock->getStyle());
+
+  if (!currentPage) {
+    currentPage.reset(new Page());
+    currentPageNextY = marginTop;
+  }
+
+  // Images are stored as framebuffer byte strips, so the top edge has to sit on a multiple of 8 rows
+  int y = (currentPageNextY + 7) & ~7;
+  if (y + height > pageHeight) {
+    // Nothing placed yet means the page only has spacing on it, the image takes it over instead of leaving it blank
+    if (!currentPage->elements.empty()) {
+      completePage();
+      currentPage.reset(new Page());
+    }
+    y = (marginTop + 7) & ~7;
+  }
+  placePendingTocAnchors();
+  notePageTextOffset(pendingWordOffsets.empty() ? textOffset : pendingWordOffsets.front());
+
+  const int x = marginLeft + (maxWidth - width) / 2;
+  currentPage->elements.push_back(std::make_shared<PageImage>(imagePath, width, height, x, y));
+  currentPageNextY = y + height + renderer.getLineHeight(font) * lineCompression / 2;
+}
+
 void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
   (void)atts;
@@ -62,14 +177,37 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     return;
   }
 
-  if (matches(name, IMAGE_TAGS, NUM_IMAGE_TAGS)) {
-    // TODO: Start processing image tags
+  const uint8_t tagCategories = classifyHtmlTag(name);
+  const CssStyle style = self->elementStyle(name, atts);
+
+  if (style.flags & CssStyle::HAS_DISPLAY && style.hidden) {
     self->skipUntilDepth = self->depth;
     self->depth += 1;
     return;
   }
 
-  if (matches(name, SKIP_TAGS, NUM_SKIP_TAGS)) {
+  if (tagCategories & TAG_IMAGE) {
+    // <img src> in XHTML, <image xlink:href> inside SVG wrappers
+    const char* src = nullptr;
+    for (int i = 0; atts != nullptr && atts[i]; i += 2) {
+      if (strcmp(atts[i], "src") == 0 || strcmp(atts[i], "xlink:href") == 0 || strcmp(atts[i], "href") == 0) {
+        src = atts[i + 1];
+      }
+    }
+    // Ends the word whether or not the image can be shown, so extractWords, which never resolves images, counts the
+    // same text offsets as the layout
+    if (src && self->partWordBufferIndex > 0) {
+      self->flushPartWord(self->currentFontStyle());
+    }
+    if (src && self->imageResolverFn) {
+      self->addImage(src);
+    }
+    self->skipUntilDepth = self->depth;
+    self->depth += 1;
+    return;
+  }
+
+  if (tagCategories & TAG_SKIP) {
     // start skip
     self->skipUntilDepth = self->depth;
     self->depth += 1;
@@ -88,21 +226,46 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     }
   }
 
-  if (matches(name, HEADER_TAGS, NUM_HEADER_TAGS)) {
-    self->startNewTextBlock(TextBlock::CENTER_ALIGN);
-    self->boldUntilDepth = min(self->boldUntilDepth, self->depth);
-  } else if (matches(name, BLOCK_TAGS, NUM_BLOCK_TAGS)) {
-    if (strcmp(name, "br") == 0) {
+  // The element's own text-align wins, then the nearest ancestor's
+  const bool hasAlign = style.flags & CssStyle::HAS_TEXT_ALIGN;
+  auto blockAlign = TextBlock::JUSTIFIED;
+  if (hasAlign) {
+    blockAlign = static_cast<TextBlock::BLOCK_STYLE>(style.textAlign);
+    self->textAlignStack.emplace_back(self->depth, style.textAlign);
+  } else if (!self->textAlignStack.empty()) {
+    blockAlign = static_cast<TextBlock::BLOCK_STYLE>(self->textAlignStack.back().second);
+  }
+
+  // Stylesheets can only turn bold and italic on, but can keep tags like <h1> or <em> from doing it
+  if (tagCategories & TAG_HEADER) {
+    self->startNewTextBlock(hasAlign ? blockAlign : TextBlock::CENTER_ALIGN);
+    if (!(style.flags & CssStyle::HAS_FONT_WEIGHT)) {
+      self->boldUntilDepth = min(self->boldUntilDepth, self->depth);
+    }
+  } else if (tagCategories & TAG_BLOCK) {
+    if (tagCategories & TAG_LINE_BREAK) {
       self->startNewTextBlock(self->currentTextBlock->getStyle());
     } else {
-      self->startNewTextBlock(TextBlock::JUSTIFIED);
+      self->startNewTextBlock(blockAlign);
     }
-  } else if (matches(name, BOLD_TAGS, NUM_BOLD_TAGS)) {
+  } else if (tagCategories & TAG_BOLD && !(style.flags & CssStyle::HAS_FONT_WEIGHT)) {
+    self->boldUntilDepth = min(self->boldUntilDepth, self->depth);
+  } else if (tagCategories & TAG_ITALIC && !(style.flags & CssStyle::HAS_FONT_STYLE)) {
+    self->italicUntilDepth = min(self->italicUntilDepth, self->depth);
+  }
+
+  if (style.flags & CssStyle::HAS_FONT_WEIGHT && style.bold) {
     self->boldUntilDepth = min(self->boldUntilDepth, self->depth);
-  } else if (matches(name, ITALIC_TAGS, NUM_ITALIC_TAGS)) {
+  }
+  if (style.flags & CssStyle::HAS_FONT_STYLE && style.italic) {
     self->italicUntilDepth = min(self->italicUntilDepth, self->depth);
   }
 
+  // After any new block is started, so the anchor isn't placed with the previous block's lines
+  if (!self->tocAnchors.empty()) {
+    self->checkTocAnchor(atts);
+  }
+
   self->depth += 1;
 }
 
@@ -114,22 +277,13 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
     return;
   }
 
-  EpdFontStyle fontStyle = REGULAR;
-  if (self->boldUntilDepth < self->depth && self->italicUntilDepth < self->depth) {
-    fontStyle = BOLD_ITALIC;
-  } else if (self->boldUntilDepth < self->depth) {
-    fontStyle = BOLD;
-  } else if (self->italicUntilDepth < self->depth) {
-    fontStyle = ITALIC;
-  }
+  const EpdFontStyle fontStyle = self->currentFontStyle();
 
   for (int i = 0; i < len; i++) {
     if (isWhitespace(s[i])) {
       // Currently looking at whitespace, if there's anything in the partWordBuffer, flush it
       if (self->partWordBufferIndex > 0) {
-        self->partWordBuffer[self->partWordBufferIndex] = '\0';
-        self->currentTextBlock->addWord(std::move(replaceHtmlEntities(self->partWordBuffer)), fontStyle);
-        self->partWordBufferIndex = 0;
+        self->flushPartWord(fontStyle);
       }
       // Skip the whitespace char
       continue;
@@ -137,9 +291,7 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
 
     // If we're about to run out of space, then cut the word off and start a new one
     if (self->partWordBufferIndex >= MAX_WORD_SIZE) {
-      self->partWordBuffer[self->partWordBufferIndex] = '\0';
-      self->currentTextBlock->addWord(std::move(replaceHtmlEntities(self->partWordBuffer)), fontStyle);
-      self->partWordBufferIndex = 0;
+      self->flushPartWord(fontStyle);
     }
 
     self->partWordBuffer[self->partWordBufferIndex++] = s[i];
@@ -152,7 +304,7 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
   if (self->currentTextBlock->size() > 750) {
     Serial.printf("[%lu] [EHP] Text block too long, splitting into multiple pages\n", millis());
     self->currentTextBlock->layoutAndExtractLines(
-        self->renderer, self->fontId, self->marginLeft + self->marginRight,
+        self->renderer, self->font, self->marginLeft + self->marginRight,
         [self](const std::shared_ptr<TextBlock>& textBlock) { self->addLineToPage(textBlock); }, false);
   }
 }
@@ -166,23 +318,12 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
     // We don't want to flush out content when closing inline tags like <span>.
     // Currently this also flushes out on closing <b> and <i> tags, but they are line tags so that shouldn't happen,
     // text styling needs to be overhauled to fix it.
-    const bool shouldBreakText =
-        matches(name, BLOCK_TAGS, NUM_BLOCK_TAGS) || matches(name, HEADER_TAGS, NUM_HEADER_TAGS) ||
-        matches(name, BOLD_TAGS, NUM_BOLD_TAGS) || matches(name, ITALIC_TAGS, NUM_ITALIC_TAGS) || self->depth == 1;
+    const bool shouldBreakText = (classifyHtmlTag(name) & (TAG_BLOCK | TAG_HEADER | TAG_BOLD | TAG_ITALIC)) != 0 ||
+                                 self->depth == 1 || self->boldUntilDepth == self->depth - 1 ||
+                                 self->italicUntilDepth == self->depth - 1;
 
     if (shouldBreakText) {
-      EpdFontStyle fontStyle = REGULAR;
-      if (self->boldUntilDepth < self->depth && self->italicUntilDepth < self->depth) {
-        fontStyle = BOLD_ITALIC;
-      } else if (self->boldUntilDepth < self->depth) {
-        fontStyle = BOLD;
-      } else if (self->italicUntilDepth < self->depth) {
-        fontStyle = ITALIC;
-      }
-
-      self->partWordBuffer[self->partWordBufferIndex] = '\0';
-      self->currentTextBlock->addWord(std::move(replaceHtmlEntities(self->partWordBuffer)), fontStyle);
-      self->partWordBufferIndex = 0;
+      self->flushPartWord(self->currentFontStyle());
     }
   }
 
@@ -202,11 +343,54 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
   if (self->italicUntilDepth == self->depth) {
     self->italicUntilDepth = INT_MAX;
   }
+
+  // Leaving text-align
+  if (!self->textAlignStack.empty() && self->textAlignStack.back().first == self->depth) {
+    self->textAlignStack.pop_back();
+  }
 }
 
 bool ChapterHtmlSlimParser::parseAndBuildPages() {
+  font = renderer.getFont(fontId);
+  if (!font.isValid()) {
+    return false;
+  }
+
   startNewTextBlock(TextBlock::JUSTIFIED);
 
+  File file;
+  if (!FsHelpers::openFileForRead("EHP", filepath, file)) {
+    return false;
+  }
+
+  const bool success = backend == PULL_TOKENIZER ? parseWithTokenizer(file) : parseWithExpat(file);
+  file.close();
+  if (!success) {
+    return false;
+  }
+
+  // Process last page if there is still text
+  if (currentTextBlock) {
+    makePages();
+    // Anchors on trailing empty elements point at the last page
+    placePendingTocAnchors();
+    completePage();
+    currentPage.reset();
+    currentTextBlock.reset();
+  }
+
+  return true;
+}
+
+bool ChapterHtmlSlimParser::extractWords(Stream& input, const WordFn& fn) {
+  wordFn = fn;
+  backend = PULL_TOKENIZER;
+  // Never laid out, words go to wordFn so this block stays empty
+  startNewTextBlock(TextBlock::JUSTIFIED);
+  return parseWithTokenizer(input);
+}
+
+bool ChapterHtmlSlimParser::parseWithExpat(File& file) {
   const XML_Parser parser = XML_ParserCreate(nullptr);
   int done;
 
@@ -215,12 +399,6 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
     return false;
   }
 
-  File file;
-  if (!FsHelpers::openFileForRead("EHP", filepath, file)) {
-    XML_ParserFree(parser);
-    return false;
-  }
-
   XML_SetUserData(parser, this);
   XML_SetElementHandler(parser, startElement, endElement);
   XML_SetCharacterDataHandler(parser, characterData);
@@ -233,7 +411,6 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
       XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
       XML_SetCharacterDataHandler(parser, nullptr);
       XML_ParserFree(parser);
-      file.close();
       return false;
     }
 
@@ -245,7 +422,6 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
       XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
       XML_SetCharacterDataHandler(parser, nullptr);
       XML_ParserFree(parser);
-      file.close();
       return false;
     }
 
@@ -258,7 +434,6 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
       XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
       XML_SetCharacterDataHandler(parser, nullptr);
       XML_ParserFree(parser);
-      file.close();
       return false;
     }
   } while (!done);
@@ -267,28 +442,48 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
   XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
   XML_SetCharacterDataHandler(parser, nullptr);
   XML_ParserFree(parser);
-  file.close();
+  return true;
+}
 
-  // Process last page if there is still text
-  if (currentTextBlock) {
-    makePages();
-    completePageFn(std::move(currentPage));
-    currentPage.reset();
-    currentTextBlock.reset();
+// Feeds the same callbacks as expat, straight from the tokenizer's read buffer
+bool ChapterHtmlSlimParser::parseWithTokenizer(Stream& input) {
+  XhtmlTokenizer tokenizer(input);
+  if (!tokenizer.begin()) {
+    return false;
   }
 
-  return true;
+  while (!stopped) {
+    switch (tokenizer.next()) {
+      case XhtmlTokenizer::TOKEN_START_TAG:
+        startElement(this, tokenizer.getName().data(), tokenizer.getAttributes());
+        break;
+      case XhtmlTokenizer::TOKEN_END_TAG:
+        endElement(this, tokenizer.getName().data());
+        break;
+      case XhtmlTokenizer::TOKEN_TEXT:
+        characterData(this, tokenizer.getText().data(), static_cast<int>(tokenizer.getText().size()));
+        break;
+      case XhtmlTokenizer::TOKEN_END:
+        return true;
+    }
+  }
+  return false;
 }
 
 void ChapterHtmlSlimParser::addLineToPage(std::shared_ptr<TextBlock> line) {
-  const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
+  const int lineHeight = renderer.getLineHeight(font) * lineCompression;
   const int pageHeight = GfxRenderer::getScreenHeight() - marginTop - marginBottom;
 
   if (currentPageNextY + lineHeight > pageHeight) {
-    completePageFn(std::move(currentPage));
+    completePage();
     currentPage.reset(new Page());
     currentPageNextY = marginTop;
   }
+  placePendingTocAnchors();
+  // Lines come out of the text block in word order
+  notePageTextOffset(pendingWordOffsets.empty() ? textOffset : pendingWordOffsets.front());
+  const size_t lineWordCount = std::min(line->getWordCount(), pendingWordOffsets.size());
+  pendingWordOffsets.erase(pendingWordOffsets.begin(), pendingWordOffsets.begin() + lineWordCount);
 
   currentPage->elements.push_back(std::make_shared<PageLine>(line, marginLeft, currentPageNextY));
   currentPageNextY += lineHeight;
@@ -305,9 +500,9 @@ void ChapterHtmlSlimParser::makePages() {
     currentPageNextY = marginTop;
   }
 
-  const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
+  const int lineHeight = renderer.getLineHeight(font) * lineCompression;
   currentTextBlock->layoutAndExtractLines(
-      renderer, fontId, marginLeft + marginRight,
+      renderer, font, marginLeft + marginRight,
       [this](const std::shared_ptr<TextBlock>& textBlock) { addLineToPage(textBlock); });
   // Extra paragraph spacing if enabled
   if (extraParagraphSpacing) {
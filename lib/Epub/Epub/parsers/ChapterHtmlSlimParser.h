@@ -1,11 +1,18 @@
 #pragma once
 
+#include <FS.h>
+#include <FontHandle.h>
 #include <expat.h>
 
 #include <climits>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "../CssRuleTable.h"
 #include "../ParsedText.h"
 #include "../blocks/TextBlock.h"
 
@@ -14,14 +21,40 @@ class GfxRenderer;
 
 #define MAX_WORD_SIZE 200
 
+// Resolves an image src to a pre-rendered image fitting within maxWidth x maxHeight, returns false to leave it out
+using ImageResolverFn =
+    std::function<bool(const char* src, int maxWidth, int maxHeight, std::string* imagePath, int* width, int* height)>;
+// Receives each word with its text offset instead of it being laid out, returns false to stop parsing
+using WordFn = std::function<bool(const char* word, size_t length, uint32_t textOffset)>;
+
 class ChapterHtmlSlimParser {
+ public:
+  // EXPAT needs well formed XHTML, PULL_TOKENIZER copes with broken markup and uses less heap
+  enum Backend { EXPAT, PULL_TOKENIZER };
+
+ private:
   const std::string& filepath;
   GfxRenderer& renderer;
   std::function<void(std::unique_ptr<Page>)> completePageFn;
+  ImageResolverFn imageResolverFn;
   int depth = 0;
   int skipUntilDepth = INT_MAX;
   int boldUntilDepth = INT_MAX;
   int italicUntilDepth = INT_MAX;
+  // (depth, TextBlock::BLOCK_STYLE) for every open element with a text-align, inherited by the blocks inside it
+  std::vector<std::pair<int, uint8_t>> textAlignStack;
+  const CssRuleTable* cssRules = nullptr;
+  // Sorted ids of the TOC entries pointing into this chapter, with the page each one lands on once it's seen
+  std::vector<std::string> tocAnchors;
+  std::vector<bool> tocAnchorSeen;
+  std::vector<std::pair<std::string, int>> tocAnchorPages;
+  // Anchors seen since the last line was placed, they start on the page the next line goes to
+  std::vector<int> pendingTocAnchors;
+  int completedPageCount = 0;
+  // Layout independent position of the next word, and of each word waiting to be laid out
+  uint32_t textOffset = 0;
+  std::deque<uint32_t> pendingWordOffsets;
+  std::vector<uint32_t> pageTextOffsets;
   // buffer for building up words from characters, will auto break if longer than this
   // leave one char at end for null pointer
   char partWordBuffer[MAX_WORD_SIZE + 1] = {};
@@ -30,15 +63,30 @@ class ChapterHtmlSlimParser {
   std::unique_ptr<Page> currentPage = nullptr;
   int16_t currentPageNextY = 0;
   int fontId;
+  // Resolved from fontId once per section in parseAndBuildPages, used for every word measured during layout
+  FontHandle font;
   float lineCompression;
   int marginTop;
   int marginRight;
   int marginBottom;
   int marginLeft;
   bool extraParagraphSpacing;
+  Backend backend = EXPAT;
+  WordFn wordFn;
+  bool stopped = false;
 
   void startNewTextBlock(TextBlock::BLOCK_STYLE style);
+  CssStyle elementStyle(const char* name, const XML_Char** atts) const;
+  EpdFontStyle currentFontStyle() const;
+  void flushPartWord(EpdFontStyle fontStyle);
+  void addImage(const char* src);
+  void checkTocAnchor(const XML_Char** atts);
+  void placePendingTocAnchors();
+  void notePageTextOffset(uint32_t offset);
+  void completePage();
   void makePages();
+  bool parseWithExpat(File& file);
+  bool parseWithTokenizer(Stream& input);
   // XML callbacks
   static void XMLCALL startElement(void* userData, const XML_Char* name, const XML_Char** atts);
   static void XMLCALL characterData(void* userData, const XML_Char* s, int len);
@@ -48,7 +96,8 @@ class ChapterHtmlSlimParser {
   explicit ChapterHtmlSlimParser(const std::string& filepath, GfxRenderer& renderer, const int fontId,
                                  const float lineCompression, const int marginTop, const int marginRight,
                                  const int marginBottom, const int marginLeft, const bool extraParagraphSpacing,
-                                 const std::function<void(std::unique_ptr<Page>)>& completePageFn)
+                                 const std::function<void(std::unique_ptr<Page>)>& completePageFn,
+                                 const ImageResolverFn& imageResolverFn = nullptr)
       : filepath(filepath),
         renderer(renderer),
         fontId(fontId),
@@ -58,8 +107,19 @@ class ChapterHtmlSlimParser {
         marginBottom(marginBottom),
         marginLeft(marginLeft),
         extraParagraphSpacing(extraParagraphSpacing),
-        completePageFn(completePageFn) {}
+        completePageFn(completePageFn),
+        imageResolverFn(imageResolverFn) {}
   ~ChapterHtmlSlimParser() = default;
+  void setBackend(const Backend newBackend) { backend = newBackend; }
+  void setCssRuleTable(const CssRuleTable* rules) { cssRules = rules; }
+  void setTocAnchors(std::vector<std::string> anchors);
+  // (anchor, page index) for every TOC anchor found while building pages
+  const std::vector<std::pair<std::string, int>>& getTocAnchorPages() const { return tocAnchorPages; }
+  // Text offset of the first word on every page
+  const std::vector<uint32_t>& getPageTextOffsets() const { return pageTextOffsets; }
   bool parseAndBuildPages();
+  // Runs a chapter through the same element and word handling as parseAndBuildPages without laying anything out, so
+  // the text offsets match the ones recorded for pages
+  bool extractWords(Stream& input, const WordFn& fn);
   void addLineToPage(std::shared_ptr<TextBlock> line);
 };
@@ -6,9 +6,11 @@
 #include <ZipFile.h>
 
 #include "../BookMetadataCache.h"
+#include "AttributeTokens.h"
 
 namespace {
 constexpr char MEDIA_TYPE_NCX[] = "application/x-dtbncx+xml";
+constexpr char MEDIA_TYPE_CSS[] = "text/css";
 constexpr char itemCacheFile[] = "/.items.bin";
 }  // namespace
 
@@ -145,6 +147,7 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
     std::string itemId;
     std::string href;
     std::string mediaType;
+    bool isNav = false;
 
     for (int i = 0; atts[i]; i += 2) {
       if (strcmp(atts[i], "id") == 0) {
@@ -153,6 +156,8 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
         href = self->baseContentPath + atts[i + 1];
       } else if (strcmp(atts[i], "media-type") == 0) {
         mediaType = atts[i + 1];
+      } else if (strcmp(atts[i], "properties") == 0) {
+        isNav = hasAttributeToken(atts[i + 1], "nav");
       }
     }
 
@@ -172,6 +177,15 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
                       href.c_str());
       }
     }
+
+    // EPUB 3 navigation document
+    if (isNav && self->tocNavPath.empty()) {
+      self->tocNavPath = href;
+    }
+
+    if (mediaType == MEDIA_TYPE_CSS) {
+      self->stylesheetPaths.push_back(href);
+    }
     return;
   }
 
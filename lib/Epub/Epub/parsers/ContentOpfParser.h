@@ -1,6 +1,8 @@
 #pragma once
 #include <Print.h>
 
+#include <vector>
+
 #include "Epub.h"
 #include "expat.h"
 
@@ -32,6 +34,8 @@ class ContentOpfParser final : public Print {
  public:
   std::string title;
   std::string tocNcxPath;
+  std::string tocNavPath;
+  std::vector<std::string> stylesheetPaths;
   std::string coverItemHref;
 
   explicit ContentOpfParser(const std::string& cachePath, const std::string& baseContentPath, const size_t xmlSize,
@@ -0,0 +1,187 @@
+#include "CssParser.h"
+
+#include "../CssRuleTable.h"
+
+namespace {
+bool isCssSpace(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f'; }
+
+bool isTagChar(const char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-'; }
+
+bool isClassChar(const char c) { return isTagChar(c) || c == '_' || static_cast<uint8_t>(c) >= 0x80; }
+
+// Keys a "tag", ".class" or "tag.class" selector the same way CssRuleTable::lookup does, false for anything else
+bool keySimpleSelector(const char* start, const char* end, CssSelectorKey* key) {
+  while (start < end && isCssSpace(*start)) {
+    start++;
+  }
+  while (end > start && isCssSpace(end[-1])) {
+    end--;
+  }
+  if (start == end) {
+    return false;
+  }
+
+  CssSelectorKey result = CssRuleTable::EMPTY_KEY;
+  const char* cursor = start;
+  // Tag names are case insensitive and stored lower case
+  while (cursor < end && isTagChar(*cursor)) {
+    const char lower = *cursor >= 'A' && *cursor <= 'Z' ? *cursor + ('a' - 'A') : *cursor;
+    result = CssRuleTable::extendKey(result, &lower, 1);
+    cursor++;
+  }
+  if (cursor < end && *cursor == '.') {
+    const char* classStart = ++cursor;
+    while (cursor < end && isClassChar(*cursor)) {
+      cursor++;
+    }
+    if (cursor == classStart) {
+      return false;
+    }
+    result = CssRuleTable::extendKey(result, ".", 1);
+    result = CssRuleTable::extendKey(result, classStart, cursor - classStart);
+  }
+
+  // Ids, attributes, pseudo classes, combinators and compound classes aren't supported
+  if (cursor != end) {
+    return false;
+  }
+  *key = result;
+  return true;
+}
+}  // namespace
+
+size_t CssParser::write(const uint8_t data) { return write(&data, 1); }
+
+size_t CssParser::write(const uint8_t* buffer, const size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    const char c = static_cast<char>(buffer[i]);
+
+    if (inComment) {
+      if (pendingStar && c == '/') {
+        inComment = false;
+      }
+      pendingStar = c == '*';
+      continue;
+    }
+
+    if (pendingSlash) {
+      pendingSlash = false;
+      if (c == '*') {
+        inComment = true;
+        pendingStar = false;
+        continue;
+      }
+      process('/');
+    }
+    if (c == '/' && !quote) {
+      pendingSlash = true;
+      continue;
+    }
+
+    process(c);
+  }
+  return size;
+}
+
+void CssParser::process(const char c) {
+  if (quote) {
+    if (c == quote) {
+      quote = 0;
+    }
+  } else if (c == '"' || c == '\'') {
+    quote = c;
+  }
+
+  switch (state) {
+    case SELECTOR:
+      if (quote || c == '"' || c == '\'') {
+        break;
+      }
+      if (c == '@' && selectorLength == 0) {
+        state = AT_RULE;
+      } else if (c == '{') {
+        endSelector();
+        state = DECLARATIONS;
+        declarationsLength = 0;
+      } else if (c == '}' || c == ';') {
+        // Stray characters from broken CSS
+        selectorLength = 0;
+      } else if (selectorLength > 0 || !isCssSpace(c)) {
+        if (selectorLength < MAX_SELECTOR_LENGTH) {
+          selector[selectorLength] = c;
+        }
+        // Keep counting so an overlong selector can be dropped
+        if (selectorLength <= MAX_SELECTOR_LENGTH) {
+          selectorLength++;
+        }
+      }
+      break;
+
+    case DECLARATIONS:
+      if (c == '}' && !quote) {
+        endDeclarations();
+        state = SELECTOR;
+        selectorLength = 0;
+      } else if (declarationsLength < MAX_DECLARATIONS_LENGTH) {
+        declarations[declarationsLength++] = c;
+      }
+      break;
+
+    case AT_RULE:
+      if (quote) {
+        break;
+      }
+      if (c == ';') {
+        // @import, @charset, @namespace
+        state = SELECTOR;
+      } else if (c == '{') {
+        // @media, @font-face, @page, ...
+        state = SKIP_BLOCK;
+        skipDepth = 1;
+      }
+      break;
+
+    case SKIP_BLOCK:
+      if (quote) {
+        break;
+      }
+      if (c == '{') {
+        skipDepth++;
+      } else if (c == '}' && --skipDepth == 0) {
+        state = SELECTOR;
+        selectorLength = 0;
+      }
+      break;
+  }
+}
+
+void CssParser::endSelector() {
+  selectorCount = 0;
+  if (selectorLength > MAX_SELECTOR_LENGTH) {
+    return;
+  }
+
+  const char* end = selector + selectorLength;
+  const char* start = selector;
+  while (start < end && selectorCount < MAX_SELECTORS_PER_RULE) {
+    const char* comma = start;
+    while (comma < end && *comma != ',') {
+      comma++;
+    }
+    CssSelectorKey key;
+    if (keySimpleSelector(start, comma, &key)) {
+      selectorKeys[selectorCount++] = key;
+    }
+    start = comma + 1;
+  }
+}
+
+void CssParser::endDeclarations() {
+  if (selectorCount == 0) {
+    return;
+  }
+  const CssStyle style = CssStyle::parseDeclarations(declarations, declarationsLength);
+  for (int i = 0; i < selectorCount; i++) {
+    table->addRule(selectorKeys[i], style);
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <Print.h>
+
+#include <cstdint>
+
+#include "../CssRuleTable.h"
+
+// Streams a stylesheet into a CssRuleTable. Only rules whose selectors are a plain tag, .class or tag.class are kept,
+// at-rules (including @media blocks) are skipped.
+class CssParser final : public Print {
+  enum ParserState { SELECTOR, DECLARATIONS, AT_RULE, SKIP_BLOCK };
+
+  static constexpr int MAX_SELECTOR_LENGTH = 256;
+  static constexpr int MAX_DECLARATIONS_LENGTH = 512;
+  static constexpr int MAX_SELECTORS_PER_RULE = 16;
+
+  CssRuleTable* table;
+  ParserState state = SELECTOR;
+  bool inComment = false;
+  bool pendingSlash = false;
+  bool pendingStar = false;
+  char quote = 0;
+  int skipDepth = 0;
+
+  char selector[MAX_SELECTOR_LENGTH + 1] = {};
+  int selectorLength = 0;
+  char declarations[MAX_DECLARATIONS_LENGTH + 1] = {};
+  int declarationsLength = 0;
+  CssSelectorKey selectorKeys[MAX_SELECTORS_PER_RULE] = {};
+  int selectorCount = 0;
+
+  void process(char c);
+  void endSelector();
+  void endDeclarations();
+
+ public:
+  explicit CssParser(CssRuleTable* table) : table(table) {}
+  ~CssParser() override = default;
+
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+};
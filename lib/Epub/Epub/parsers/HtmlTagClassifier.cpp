@@ -0,0 +1,110 @@
+#include "HtmlTagClassifier.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+struct HtmlTag {
+  const char* name;
+  uint8_t categories;
+};
+
+// Add new tags here, the hash table below is rebuilt at compile time
+constexpr HtmlTag HTML_TAGS[] = {
+    {"h1", TAG_HEADER},
+    {"h2", TAG_HEADER},
+    {"h3", TAG_HEADER},
+    {"h4", TAG_HEADER},
+    {"h5", TAG_HEADER},
+    {"h6", TAG_HEADER},
+    {"p", TAG_BLOCK},
+    {"li", TAG_BLOCK},
+    {"div", TAG_BLOCK},
+    {"br", TAG_BLOCK | TAG_LINE_BREAK | TAG_VOID},
+    {"blockquote", TAG_BLOCK},
+    {"section", TAG_BLOCK},
+    {"aside", TAG_BLOCK},
+    {"figure", TAG_BLOCK},
+    {"b", TAG_BOLD},
+    {"strong", TAG_BOLD},
+    {"i", TAG_ITALIC},
+    {"em", TAG_ITALIC},
+    {"img", TAG_IMAGE | TAG_VOID},
+    {"image", TAG_IMAGE | TAG_VOID},
+    {"head", TAG_SKIP},
+    {"table", TAG_SKIP},
+    {"area", TAG_VOID},
+    {"base", TAG_VOID},
+    {"col", TAG_VOID},
+    {"embed", TAG_VOID},
+    {"hr", TAG_VOID},
+    {"input", TAG_VOID},
+    {"link", TAG_VOID},
+    {"meta", TAG_VOID},
+    {"param", TAG_VOID},
+    {"source", TAG_VOID},
+    {"track", TAG_VOID},
+    {"wbr", TAG_VOID},
+};
+constexpr size_t NUM_HTML_TAGS = sizeof(HTML_TAGS) / sizeof(HTML_TAGS[0]);
+
+constexpr int SLOT_BITS = 7;
+constexpr int NUM_SLOTS = 1 << SLOT_BITS;
+constexpr uint8_t EMPTY_SLOT = 0xFF;
+static_assert(NUM_HTML_TAGS <= NUM_SLOTS / 2, "Tag hash table is too full, raise SLOT_BITS");
+
+// FNV-1a
+constexpr uint32_t hashTag(const char* name) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; name[i]; i++) {
+    hash = (hash ^ static_cast<uint8_t>(name[i])) * 16777619u;
+  }
+  return hash;
+}
+
+constexpr int slotFor(const uint32_t hash, const uint32_t multiplier) { return (hash * multiplier) >> (32 - SLOT_BITS); }
+
+struct TagHashTable {
+  uint32_t multiplier = 0;
+  std::array<uint8_t, NUM_SLOTS> slots{};
+  bool valid = false;
+};
+
+// Tries odd multipliers until every tag lands in its own slot
+constexpr TagHashTable buildTagHashTable() {
+  TagHashTable table;
+  uint32_t candidate = 0x9E3779B1u;
+  for (int attempt = 0; attempt < 100000; attempt++) {
+    candidate = candidate * 1664525u + 1013904223u;
+    const uint32_t multiplier = candidate | 1;
+
+    for (auto& slot : table.slots) {
+      slot = EMPTY_SLOT;
+    }
+    bool collision = false;
+    for (size_t i = 0; i < NUM_HTML_TAGS && !collision; i++) {
+      const int slot = slotFor(hashTag(HTML_TAGS[i].name), multiplier);
+      collision = table.slots[slot] != EMPTY_SLOT;
+      table.slots[slot] = i;
+    }
+
+    if (!collision) {
+      table.multiplier = multiplier;
+      table.valid = true;
+      return table;
+    }
+  }
+  return table;
+}
+
+constexpr TagHashTable TAG_HASH_TABLE = buildTagHashTable();
+static_assert(TAG_HASH_TABLE.valid, "No perfect hash found for the tag table");
+}  // namespace
+
+uint8_t classifyHtmlTag(const char* name) {
+  const uint8_t index = TAG_HASH_TABLE.slots[slotFor(hashTag(name), TAG_HASH_TABLE.multiplier)];
+  if (index == EMPTY_SLOT || strcmp(HTML_TAGS[index].name, name) != 0) {
+    return TAG_NONE;
+  }
+  return HTML_TAGS[index].categories;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// Categories are bit flags, a tag can belong to several
+enum HtmlTagCategory : uint8_t {
+  TAG_NONE = 0,
+  TAG_HEADER = 1 << 0,
+  TAG_BLOCK = 1 << 1,
+  TAG_LINE_BREAK = 1 << 2,
+  TAG_BOLD = 1 << 3,
+  TAG_ITALIC = 1 << 4,
+  TAG_IMAGE = 1 << 5,
+  TAG_SKIP = 1 << 6,
+  // Never has content or an end tag in HTML
+  TAG_VOID = 1 << 7,
+};
+
+// Maps a tag name to its categories with one hash pass over the name and a single compare
+uint8_t classifyHtmlTag(const char* name);
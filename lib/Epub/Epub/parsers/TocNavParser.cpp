@@ -0,0 +1,182 @@
+#include "TocNavParser.h"
+
+#include <FsHelpers.h>
+#include <HardwareSerial.h>
+
+#include "../BookMetadataCache.h"
+#include "AttributeTokens.h"
+
+namespace {
+// Labels are only shown in the chapter list, anything longer is cut off
+constexpr size_t MAX_LABEL_LENGTH = 256;
+
+// Matches the unprefixed name as well as one with a namespace prefix, e.g. "html:nav"
+bool isElement(const char* name, const char* localName) {
+  const char* colon = strchr(name, ':');
+  return strcmp(colon ? colon + 1 : name, localName) == 0;
+}
+}  // namespace
+
+bool TocNavParser::setup() {
+  parser = XML_ParserCreate(nullptr);
+  if (!parser) {
+    Serial.printf("[%lu] [NAV] Couldn't allocate memory for parser\n", millis());
+    return false;
+  }
+
+  XML_SetUserData(parser, this);
+  XML_SetElementHandler(parser, startElement, endElement);
+  XML_SetCharacterDataHandler(parser, characterData);
+  return true;
+}
+
+TocNavParser::~TocNavParser() {
+  if (parser) {
+    XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
+    XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
+    XML_SetCharacterDataHandler(parser, nullptr);
+    XML_ParserFree(parser);
+    parser = nullptr;
+  }
+}
+
+size_t TocNavParser::write(const uint8_t data) { return write(&data, 1); }
+
+size_t TocNavParser::write(const uint8_t* buffer, const size_t size) {
+  if (!parser) return 0;
+
+  const uint8_t* currentBufferPos = buffer;
+  auto remainingInBuffer = size;
+
+  while (remainingInBuffer > 0) {
+    void* const buf = XML_GetBuffer(parser, 1024);
+    if (!buf) {
+      Serial.printf("[%lu] [NAV] Couldn't allocate memory for buffer\n", millis());
+      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
+      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
+      XML_SetCharacterDataHandler(parser, nullptr);
+      XML_ParserFree(parser);
+      parser = nullptr;
+      return 0;
+    }
+
+    const auto toRead = remainingInBuffer < 1024 ? remainingInBuffer : 1024;
+    memcpy(buf, currentBufferPos, toRead);
+
+    if (XML_ParseBuffer(parser, static_cast<int>(toRead), remainingSize == toRead) == XML_STATUS_ERROR) {
+      Serial.printf("[%lu] [NAV] Parse error at line %lu: %s\n", millis(), XML_GetCurrentLineNumber(parser),
+                    XML_ErrorString(XML_GetErrorCode(parser)));
+      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
+      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
+      XML_SetCharacterDataHandler(parser, nullptr);
+      XML_ParserFree(parser);
+      parser = nullptr;
+      return 0;
+    }
+
+    currentBufferPos += toRead;
+    remainingInBuffer -= toRead;
+    remainingSize -= toRead;
+  }
+  return size;
+}
+
+void XMLCALL TocNavParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
+  auto* self = static_cast<TocNavParser*>(userData);
+  const int elementDepth = self->depth++;
+
+  if (self->tocNavDepth < 0) {
+    // Only the first toc <nav>, the others are landmarks and page lists
+    if (!self->tocNavDone && isElement(name, "nav")) {
+      for (int i = 0; atts[i]; i += 2) {
+        if ((isElement(atts[i], "type") && hasAttributeToken(atts[i + 1], "toc")) ||
+            (strcmp(atts[i], "role") == 0 && strcmp(atts[i + 1], "doc-toc") == 0)) {
+          self->tocNavDepth = elementDepth;
+          break;
+        }
+      }
+    }
+    return;
+  }
+
+  if (isElement(name, "ol")) {
+    self->listDepth++;
+    return;
+  }
+
+  if (isElement(name, "a") && self->listDepth > 0) {
+    self->inLink = true;
+    self->currentLabel.clear();
+    self->currentHref.clear();
+    for (int i = 0; atts[i]; i += 2) {
+      if (strcmp(atts[i], "href") == 0) {
+        self->currentHref = atts[i + 1];
+        break;
+      }
+    }
+  }
+}
+
+void XMLCALL TocNavParser::characterData(void* userData, const XML_Char* s, const int len) {
+  auto* self = static_cast<TocNavParser*>(userData);
+  if (!self->inLink) {
+    return;
+  }
+
+  // Collapse the markup's line breaks and indentation into single spaces
+  for (int i = 0; i < len && self->currentLabel.size() < MAX_LABEL_LENGTH; i++) {
+    const bool isSpace = s[i] == ' ' || s[i] == '\n' || s[i] == '\r' || s[i] == '\t';
+    if (!isSpace) {
+      self->currentLabel += s[i];
+    } else if (!self->currentLabel.empty() && self->currentLabel.back() != ' ') {
+      self->currentLabel += ' ';
+    }
+  }
+}
+
+void XMLCALL TocNavParser::endElement(void* userData, const XML_Char* name) {
+  auto* self = static_cast<TocNavParser*>(userData);
+  self->depth--;
+
+  if (self->tocNavDepth < 0) {
+    return;
+  }
+
+  if (self->depth == self->tocNavDepth) {
+    self->tocNavDepth = -1;
+    self->tocNavDone = true;
+    return;
+  }
+
+  if (isElement(name, "ol") && self->listDepth > 0) {
+    self->listDepth--;
+    return;
+  }
+
+  if (isElement(name, "a") && self->inLink) {
+    self->inLink = false;
+    if (!self->currentLabel.empty() && self->currentLabel.back() == ' ') {
+      self->currentLabel.pop_back();
+    }
+    if (self->currentLabel.empty() || self->currentHref.empty()) {
+      return;
+    }
+
+    std::string href = self->currentHref;
+    std::string anchor;
+    const size_t pos = href.find('#');
+    if (pos != std::string::npos) {
+      anchor = href.substr(pos + 1);
+      href = href.substr(0, pos);
+    }
+    // Links to an anchor in the navigation document itself have no chapter to point at
+    if (href.empty()) {
+      return;
+    }
+
+    if (self->cache) {
+      self->cache->createTocEntry(self->currentLabel, FsHelpers::normalisePath(self->basePath + href), anchor,
+                                  self->listDepth);
+    }
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <Print.h>
+#include <expat.h>
+
+#include <string>
+
+class BookMetadataCache;
+
+// Reads the table of contents out of an EPUB 3 navigation document, the <ol> nesting inside <nav epub:type="toc">
+// gives the level of each <a> entry
+class TocNavParser final : public Print {
+  const std::string& basePath;
+  size_t remainingSize;
+  XML_Parser parser = nullptr;
+  BookMetadataCache* cache;
+
+  int depth = 0;
+  // Element depth of the toc <nav>, -1 outside it
+  int tocNavDepth = -1;
+  bool tocNavDone = false;
+  uint8_t listDepth = 0;
+  bool inLink = false;
+  std::string currentLabel;
+  std::string currentHref;
+
+  static void startElement(void* userData, const XML_Char* name, const XML_Char** atts);
+  static void characterData(void* userData, const XML_Char* s, int len);
+  static void endElement(void* userData, const XML_Char* name);
+
+ public:
+  // basePath is the directory of the navigation document, hrefs in it are relative to that
+  explicit TocNavParser(const std::string& basePath, const size_t xmlSize, BookMetadataCache* cache)
+      : basePath(basePath), remainingSize(xmlSize), cache(cache) {}
+  ~TocNavParser() override;
+
+  bool setup();
+
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+};
@@ -0,0 +1,362 @@
+#include "XhtmlTokenizer.h"
+
+#include <HardwareSerial.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "../htmlEntities.h"
+#include "HtmlTagClassifier.h"
+
+namespace {
+bool isSpace(const char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
+
+bool isNameEnd(const char c) { return isSpace(c) || c == '/' || c == '>' || c == '='; }
+
+char* const EMPTY_VALUE = const_cast<char*>("");
+
+const char* findSequence(const char* data, const size_t length, const char* sequence, const size_t sequenceLength) {
+  const char* end = data + length;
+  while (static_cast<size_t>(end - data) >= sequenceLength) {
+    const auto* first = static_cast<const char*>(memchr(data, sequence[0], end - data - sequenceLength + 1));
+    if (!first) {
+      return nullptr;
+    }
+    if (memcmp(first, sequence, sequenceLength) == 0) {
+      return first;
+    }
+    data = first + 1;
+  }
+  return nullptr;
+}
+}  // namespace
+
+XhtmlTokenizer::~XhtmlTokenizer() {
+  free(buffer);
+  free(openElementNames);
+}
+
+bool XhtmlTokenizer::begin() {
+  buffer = static_cast<char*>(malloc(bufferSize));
+  openElementNames = static_cast<char*>(malloc(OPEN_ELEMENT_NAMES_SIZE));
+  if (!buffer || !openElementNames) {
+    Serial.printf("[%lu] [XHT] Couldn't allocate memory for tokenizer\n", millis());
+    return false;
+  }
+  return true;
+}
+
+// Moves unconsumed bytes to the front and reads more, returns false if nothing more could be read
+bool XhtmlTokenizer::fill() {
+  if (bufferStart > 0) {
+    memmove(buffer, buffer + bufferStart, bufferEnd - bufferStart);
+    bufferEnd -= bufferStart;
+    bufferStart = 0;
+  }
+  if (inputEnded || bufferEnd == bufferSize) {
+    return false;
+  }
+
+  const size_t read = input.readBytes(buffer + bufferEnd, bufferSize - bufferEnd);
+  if (read == 0) {
+    inputEnded = true;
+    return false;
+  }
+  bufferEnd += read;
+  return true;
+}
+
+bool XhtmlTokenizer::ensureAvailable(const size_t length) {
+  while (bufferEnd - bufferStart < length) {
+    if (!fill()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool XhtmlTokenizer::startsWith(const char* prefix) const {
+  const size_t length = strlen(prefix);
+  return bufferEnd - bufferStart >= length && memcmp(buffer + bufferStart, prefix, length) == 0;
+}
+
+// Consumes input up to and including terminator, or all of it if the terminator never shows up
+void XhtmlTokenizer::skipPast(const char* terminator) {
+  const size_t length = strlen(terminator);
+  while (true) {
+    const char* found = findSequence(buffer + bufferStart, bufferEnd - bufferStart, terminator, length);
+    if (found) {
+      bufferStart = found - buffer + length;
+      return;
+    }
+    // Keep a partial terminator at the end of the buffer around for the next read
+    if (bufferEnd - bufferStart >= length) {
+      bufferStart = bufferEnd - (length - 1);
+    }
+    if (!fill()) {
+      bufferStart = bufferEnd;
+      return;
+    }
+  }
+}
+
+// Finds the '>' closing the tag at bufferStart, ignoring any inside quoted attribute values
+bool XhtmlTokenizer::findTagEnd(size_t* tagEnd) {
+  while (true) {
+    char quote = 0;
+    for (size_t i = bufferStart + 1; i < bufferEnd; i++) {
+      const char c = buffer[i];
+      if (quote) {
+        if (c == quote) {
+          quote = 0;
+        }
+      } else if (c == '"' || c == '\'') {
+        quote = c;
+      } else if (c == '>') {
+        *tagEnd = i;
+        return true;
+      }
+    }
+
+    if (bufferStart == 0 && bufferEnd == bufferSize) {
+      Serial.printf("[%lu] [XHT] Tag longer than %u bytes, dropping it\n", millis(),
+                    static_cast<unsigned>(bufferSize));
+      skipPast(">");
+      return false;
+    }
+    if (!fill()) {
+      // Unterminated tag at the end of the input
+      bufferStart = bufferEnd;
+      return false;
+    }
+  }
+}
+
+XhtmlTokenizer::TokenType XhtmlTokenizer::next() {
+  if (pendingSelfClose) {
+    pendingSelfClose = false;
+    return TOKEN_END_TAG;
+  }
+  if (pendingEndTags > 0) {
+    pendingEndTags--;
+    return popOpenElement();
+  }
+
+  while (true) {
+    if (bufferStart == bufferEnd && !fill()) {
+      if (openElementCount > 0) {
+        pendingEndTags = openElementCount - 1;
+        return popOpenElement();
+      }
+      return TOKEN_END;
+    }
+
+    if (inCdata) {
+      const char* found = findSequence(buffer + bufferStart, bufferEnd - bufferStart, "]]>", 3);
+      size_t textEnd = found ? found - buffer : bufferEnd;
+      if (!found && !inputEnded) {
+        // Hold back what could be the start of a split "]]>"
+        textEnd = bufferEnd - bufferStart > 2 ? bufferEnd - 2 : bufferStart;
+        if (textEnd == bufferStart) {
+          fill();
+          if (!inputEnded) {
+            continue;
+          }
+          textEnd = bufferEnd;
+        }
+      }
+      text = std::string_view(buffer + bufferStart, textEnd - bufferStart);
+      bufferStart = found ? textEnd + 3 : textEnd;
+      inCdata = !found;
+      if (text.empty()) {
+        continue;
+      }
+      return TOKEN_TEXT;
+    }
+
+    if (buffer[bufferStart] != '<') {
+      const auto* tagStart = static_cast<const char*>(memchr(buffer + bufferStart, '<', bufferEnd - bufferStart));
+      const size_t textEnd = tagStart ? tagStart - buffer : bufferEnd;
+      text = std::string_view(buffer + bufferStart, textEnd - bufferStart);
+      bufferStart = textEnd;
+      return TOKEN_TEXT;
+    }
+
+    // Enough to tell comments and CDATA sections apart from tags
+    ensureAvailable(9);
+    const char afterOpen = bufferEnd - bufferStart > 1 ? buffer[bufferStart + 1] : '\0';
+    if (!isalpha(static_cast<unsigned char>(afterOpen)) && afterOpen != '/' && afterOpen != '!' && afterOpen != '?') {
+      // A bare '<' in the text
+      text = std::string_view(buffer + bufferStart, 1);
+      bufferStart++;
+      return TOKEN_TEXT;
+    }
+    if (startsWith("<!--")) {
+      bufferStart += 4;
+      skipPast("-->");
+      continue;
+    }
+    if (startsWith("<![CDATA[")) {
+      bufferStart += 9;
+      inCdata = true;
+      continue;
+    }
+    if (startsWith("<!") || startsWith("<?")) {
+      // Doctype and processing instructions
+      skipPast(">");
+      continue;
+    }
+
+    size_t tagEnd;
+    if (!findTagEnd(&tagEnd)) {
+      continue;
+    }
+    const TokenType type = parseTag(tagEnd);
+    bufferStart = tagEnd + 1;
+    if (type != TOKEN_END) {
+      return type;
+    }
+  }
+}
+
+// Parses the tag between bufferStart and tagEnd, TOKEN_END means it produced no token
+XhtmlTokenizer::TokenType XhtmlTokenizer::parseTag(const size_t tagEnd) {
+  size_t nameStart = bufferStart + 1;
+  if (buffer[nameStart] == '/') {
+    return parseEndTag(nameStart + 1, tagEnd);
+  }
+
+  size_t nameEnd = nameStart;
+  while (nameEnd < tagEnd && !isNameEnd(buffer[nameEnd])) {
+    // Tag names are matched in lower case
+    if (buffer[nameEnd] >= 'A' && buffer[nameEnd] <= 'Z') {
+      buffer[nameEnd] += 'a' - 'A';
+    }
+    nameEnd++;
+  }
+  if (nameEnd == nameStart) {
+    return TOKEN_END;
+  }
+
+  size_t contentEnd = tagEnd;
+  while (contentEnd > nameEnd && isSpace(buffer[contentEnd - 1])) {
+    contentEnd--;
+  }
+  const bool selfClosing = contentEnd > nameStart && buffer[contentEnd - 1] == '/';
+  if (selfClosing) {
+    contentEnd--;
+  }
+
+  parseAttributes(nameEnd, contentEnd);
+  buffer[nameEnd] = '\0';
+  name = std::string_view(buffer + nameStart, nameEnd - nameStart);
+
+  if (selfClosing || (classifyHtmlTag(name.data()) & TAG_VOID) != 0 || !pushOpenElement()) {
+    pendingSelfClose = true;
+  }
+  return TOKEN_START_TAG;
+}
+
+XhtmlTokenizer::TokenType XhtmlTokenizer::parseEndTag(size_t nameStart, const size_t tagEnd) {
+  while (nameStart < tagEnd && isSpace(buffer[nameStart])) {
+    nameStart++;
+  }
+  size_t nameEnd = nameStart;
+  while (nameEnd < tagEnd && !isNameEnd(buffer[nameEnd])) {
+    if (buffer[nameEnd] >= 'A' && buffer[nameEnd] <= 'Z') {
+      buffer[nameEnd] += 'a' - 'A';
+    }
+    nameEnd++;
+  }
+  buffer[nameEnd] = '\0';
+  const char* endName = buffer + nameStart;
+
+  // Close everything opened after the matching element, drop end tags nothing matches
+  for (int i = openElementCount - 1; i >= 0; i--) {
+    if (strcmp(openElementNames + openElementOffsets[i], endName) == 0) {
+      pendingEndTags = openElementCount - 1 - i;
+      return popOpenElement();
+    }
+  }
+  return TOKEN_END;
+}
+
+void XhtmlTokenizer::parseAttributes(size_t start, const size_t end) {
+  int count = 0;
+  while (count < MAX_ATTRIBUTES) {
+    while (start < end && isSpace(buffer[start])) {
+      start++;
+    }
+    if (start >= end) {
+      break;
+    }
+
+    const size_t attributeNameStart = start;
+    while (start < end && !isNameEnd(buffer[start])) {
+      start++;
+    }
+    const size_t attributeNameEnd = start;
+    if (attributeNameEnd == attributeNameStart) {
+      // Stray '=' or '/'
+      start++;
+      continue;
+    }
+
+    while (start < end && isSpace(buffer[start])) {
+      start++;
+    }
+    char* value = EMPTY_VALUE;
+    if (start < end && buffer[start] == '=') {
+      start++;
+      while (start < end && isSpace(buffer[start])) {
+        start++;
+      }
+      size_t valueStart = start;
+      size_t valueEnd;
+      if (start < end && (buffer[start] == '"' || buffer[start] == '\'')) {
+        const char quote = buffer[start];
+        valueStart = ++start;
+        while (start < end && buffer[start] != quote) {
+          start++;
+        }
+        valueEnd = start;
+        start++;
+      } else {
+        while (start < end && !isSpace(buffer[start])) {
+          start++;
+        }
+        valueEnd = start;
+      }
+      value = buffer + valueStart;
+      value[decodeHtmlEntities(value, valueEnd - valueStart)] = '\0';
+    }
+
+    buffer[attributeNameEnd] = '\0';
+    attributes[count * 2] = buffer + attributeNameStart;
+    attributes[count * 2 + 1] = value;
+    count++;
+  }
+  attributes[count * 2] = nullptr;
+}
+
+bool XhtmlTokenizer::pushOpenElement() {
+  const size_t offset = openElementCount > 0 ? openElementOffsets[openElementCount - 1] +
+                                                   strlen(openElementNames + openElementOffsets[openElementCount - 1]) +
+                                                   1
+                                             : 0;
+  if (openElementCount == MAX_OPEN_ELEMENTS || offset + name.size() + 1 > OPEN_ELEMENT_NAMES_SIZE) {
+    // Too deep to track, treat it as empty so start and end tags stay balanced
+    return false;
+  }
+  memcpy(openElementNames + offset, name.data(), name.size() + 1);
+  openElementOffsets[openElementCount++] = offset;
+  return true;
+}
+
+XhtmlTokenizer::TokenType XhtmlTokenizer::popOpenElement() {
+  openElementCount--;
+  const char* openName = openElementNames + openElementOffsets[openElementCount];
+  name = std::string_view(openName, strlen(openName));
+  return TOKEN_END_TAG;
+}
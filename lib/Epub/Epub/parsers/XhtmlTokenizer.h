@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Stream.h>
+
+#include <cstdint>
+#include <string_view>
+
+// Forgiving pull tokenizer for chapter XHTML. Tokens point straight into the read buffer and stay valid until the
+// next call to next(). Names and attribute values are null terminated in place so they can be handed on as C strings.
+//
+// Malformed markup never stops tokenizing: unknown end tags are dropped, end tags that skip over open elements close
+// them, void elements (<br>, <img>, ...) close themselves, and anything still open at the end of the input is closed.
+class XhtmlTokenizer {
+ public:
+  enum TokenType { TOKEN_END, TOKEN_START_TAG, TOKEN_END_TAG, TOKEN_TEXT };
+
+  static constexpr int MAX_ATTRIBUTES = 16;
+  static constexpr int MAX_OPEN_ELEMENTS = 64;
+  static constexpr size_t OPEN_ELEMENT_NAMES_SIZE = 512;
+
+ private:
+  Stream& input;
+  size_t bufferSize;
+  char* buffer = nullptr;
+  size_t bufferStart = 0;
+  size_t bufferEnd = 0;
+  bool inputEnded = false;
+  bool inCdata = false;
+
+  std::string_view name;
+  std::string_view text;
+  // Expat style name/value pairs followed by a null
+  const char* attributes[MAX_ATTRIBUTES * 2 + 1] = {};
+
+  // Names of the open elements, packed one after the other
+  char* openElementNames = nullptr;
+  uint16_t openElementOffsets[MAX_OPEN_ELEMENTS] = {};
+  int openElementCount = 0;
+  int pendingEndTags = 0;
+  bool pendingSelfClose = false;
+
+  bool fill();
+  bool ensureAvailable(size_t length);
+  bool startsWith(const char* prefix) const;
+  void skipPast(const char* terminator);
+  bool findTagEnd(size_t* tagEnd);
+  TokenType parseTag(size_t tagEnd);
+  TokenType parseEndTag(size_t nameStart, size_t tagEnd);
+  void parseAttributes(size_t start, size_t end);
+  bool pushOpenElement();
+  TokenType popOpenElement();
+
+ public:
+  explicit XhtmlTokenizer(Stream& input, const size_t bufferSize = 2048) : input(input), bufferSize(bufferSize) {}
+  ~XhtmlTokenizer();
+  bool begin();
+  TokenType next();
+  // Tag name for TOKEN_START_TAG and TOKEN_END_TAG
+  std::string_view getName() const { return name; }
+  // Raw text for TOKEN_TEXT, entities are left for the caller to decode
+  std::string_view getText() const { return text; }
+  // Attributes of the last TOKEN_START_TAG, values have their entities decoded
+  const char** getAttributes() { return attributes; }
+};
@@ -118,36 +118,17 @@ BmpReaderError Bitmap::parseHeaders() {
   return BmpReaderError::Ok;
 }
 
-// packed 2bpp output, 0 = black, 1 = dark gray, 2 = light gray, 3 = white
-BmpReaderError Bitmap::readRow(uint8_t* data, uint8_t* rowBuffer) const {
+// Reads the next row and passes each pixel's 8-bit luminance to emit
+template <typename EmitLuminance>
+BmpReaderError Bitmap::readRowWith(uint8_t* rowBuffer, EmitLuminance&& emit) const {
   // Note: rowBuffer should be pre-allocated by the caller to size 'rowBytes'
   if (file.read(rowBuffer, rowBytes) != rowBytes) return BmpReaderError::ShortReadRow;
 
-  uint8_t* outPtr = data;
-  uint8_t currentOutByte = 0;
-  int bitShift = 6;
-
-  // Helper lambda to pack 2bpp color into the output stream
-  auto packPixel = [&](const uint8_t lum) {
-    uint8_t color = (lum >> 6);  // Simple 2-bit reduction: 0-255 -> 0-3
-    currentOutByte |= (color << bitShift);
-    if (bitShift == 0) {
-      *outPtr++ = currentOutByte;
-      currentOutByte = 0;
-      bitShift = 6;
-    } else {
-      bitShift -= 2;
-    }
-  };
-
-  uint8_t lum;
-
   switch (bpp) {
     case 32: {
       const uint8_t* p = rowBuffer;
       for (int x = 0; x < width; x++) {
-        lum = (77u * p[2] + 150u * p[1] + 29u * p[0]) >> 8;
-        packPixel(lum);
+        emit((77u * p[2] + 150u * p[1] + 29u * p[0]) >> 8);
         p += 4;
       }
       break;
@@ -155,29 +136,26 @@ BmpReaderError Bitmap::readRow(uint8_t* data, uint8_t* rowBuffer) const {
     case 24: {
       const uint8_t* p = rowBuffer;
       for (int x = 0; x < width; x++) {
-        lum = (77u * p[2] + 150u * p[1] + 29u * p[0]) >> 8;
-        packPixel(lum);
+        emit((77u * p[2] + 150u * p[1] + 29u * p[0]) >> 8);
         p += 3;
       }
       break;
     }
     case 8: {
       for (int x = 0; x < width; x++) {
-        packPixel(paletteLum[rowBuffer[x]]);
+        emit(paletteLum[rowBuffer[x]]);
       }
       break;
     }
     case 2: {
       for (int x = 0; x < width; x++) {
-        lum = paletteLum[(rowBuffer[x >> 2] >> (6 - ((x & 3) * 2))) & 0x03];
-        packPixel(lum);
+        emit(paletteLum[(rowBuffer[x >> 2] >> (6 - ((x & 3) * 2))) & 0x03]);
       }
       break;
     }
     case 1: {
       for (int x = 0; x < width; x++) {
-        lum = (rowBuffer[x >> 3] & (0x80 >> (x & 7))) ? 0xFF : 0x00;
-        packPixel(lum);
+        emit((rowBuffer[x >> 3] & (0x80 >> (x & 7))) ? 0xFF : 0x00);
       }
       break;
     }
@@ -185,12 +163,42 @@ BmpReaderError Bitmap::readRow(uint8_t* data, uint8_t* rowBuffer) const {
       return BmpReaderError::UnsupportedBpp;
   }
 
+  return BmpReaderError::Ok;
+}
+
+// packed 2bpp output, 0 = black, 1 = dark gray, 2 = light gray, 3 = white
+BmpReaderError Bitmap::readRow(uint8_t* data, uint8_t* rowBuffer) const {
+  uint8_t* outPtr = data;
+  uint8_t currentOutByte = 0;
+  int bitShift = 6;
+
+  // Pack 2bpp color into the output stream
+  const auto result = readRowWith(rowBuffer, [&](const uint8_t lum) {
+    uint8_t color = (lum >> 6);  // Simple 2-bit reduction: 0-255 -> 0-3
+    currentOutByte |= (color << bitShift);
+    if (bitShift == 0) {
+      *outPtr++ = currentOutByte;
+      currentOutByte = 0;
+      bitShift = 6;
+    } else {
+      bitShift -= 2;
+    }
+  });
+  if (result != BmpReaderError::Ok) {
+    return result;
+  }
+
   // Flush remaining bits if width is not a multiple of 4
   if (bitShift != 6) *outPtr = currentOutByte;
 
   return BmpReaderError::Ok;
 }
 
+BmpReaderError Bitmap::readRowLuminance(uint8_t* data, uint8_t* rowBuffer) const {
+  uint8_t* outPtr = data;
+  return readRowWith(rowBuffer, [&outPtr](const uint8_t lum) { *outPtr++ = lum; });
+}
+
 BmpReaderError Bitmap::rewindToData() const {
   if (!file.seek(bfOffBits)) {
     return BmpReaderError::SeekPixelDataFailed;
@@ -30,6 +30,8 @@ class Bitmap {
   explicit Bitmap(File& file) : file(file) {}
   BmpReaderError parseHeaders();
   BmpReaderError readRow(uint8_t* data, uint8_t* rowBuffer) const;
+  // Reads the next row as one 8-bit luminance value per pixel, data must hold getWidth() bytes
+  BmpReaderError readRowLuminance(uint8_t* data, uint8_t* rowBuffer) const;
   BmpReaderError rewindToData() const;
   int getWidth() const { return width; }
   int getHeight() const { return height; }
@@ -38,6 +40,8 @@ class Bitmap {
   int getRowBytes() const { return rowBytes; }
 
  private:
+  template <typename EmitLuminance>
+  BmpReaderError readRowWith(uint8_t* rowBuffer, EmitLuminance&& emit) const;
   static uint16_t readLE16(File& f);
   static uint32_t readLE32(File& f);
 
@@ -0,0 +1,16 @@
+#pragma once
+#include <EpdFontFamily.h>
+
+// A font family resolved once from the renderer's font map via `GfxRenderer::getFont`.
+// Passing this to the text functions instead of a font id skips the map lookup on every call, so callers that
+// measure or draw many words (layout, page rendering) should resolve the font once per page or section.
+class FontHandle {
+  const EpdFontFamily* family = nullptr;
+
+  explicit FontHandle(const EpdFontFamily* family) : family(family) {}
+  friend class GfxRenderer;
+
+ public:
+  FontHandle() = default;
+  bool isValid() const { return family != nullptr; }
+};
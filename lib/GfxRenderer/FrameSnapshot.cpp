@@ -0,0 +1,161 @@
+#include "FrameSnapshot.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+// PackBits: header 0..127 is followed by header + 1 literal bytes, header 129..255 repeats the next byte 257 - header
+// times. Writes nothing when out is null, so it can be used to size the output first.
+size_t packBits(const uint8_t* data, const size_t size, uint8_t* out) {
+  size_t in = 0;
+  size_t written = 0;
+  while (in < size) {
+    size_t run = 1;
+    while (in + run < size && run < 128 && data[in + run] == data[in]) {
+      run++;
+    }
+
+    if (run >= 2) {
+      if (out) {
+        out[written] = static_cast<uint8_t>(257 - run);
+        out[written + 1] = data[in];
+      }
+      written += 2;
+      in += run;
+      continue;
+    }
+
+    const size_t literalStart = in;
+    size_t literalLength = 0;
+    while (in < size && literalLength < 128 && !(in + 1 < size && data[in] == data[in + 1])) {
+      in++;
+      literalLength++;
+    }
+    if (out) {
+      out[written] = static_cast<uint8_t>(literalLength - 1);
+      memcpy(out + written + 1, data + literalStart, literalLength);
+    }
+    written += 1 + literalLength;
+  }
+
+  return written;
+}
+
+bool unpackBits(const uint8_t* data, const size_t size, uint8_t* out, const size_t outSize) {
+  size_t in = 0;
+  size_t written = 0;
+  while (in < size) {
+    const uint8_t header = data[in++];
+    if (header < 128) {
+      const size_t literalLength = header + 1;
+      if (in + literalLength > size || written + literalLength > outSize) {
+        return false;
+      }
+      memcpy(out + written, data + in, literalLength);
+      in += literalLength;
+      written += literalLength;
+    } else if (header > 128) {
+      const size_t run = 257 - header;
+      if (in >= size || written + run > outSize) {
+        return false;
+      }
+      memset(out + written, data[in++], run);
+      written += run;
+    }
+  }
+
+  return written == outSize;
+}
+}  // namespace
+
+bool FrameSnapshot::store(const uint8_t* frameBuffer, const size_t size, const size_t allocationBudget,
+                          const size_t maxAllocation) {
+  clear();
+  if (!frameBuffer || size == 0) {
+    return false;
+  }
+
+  const size_t chunkCount = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  if (chunkCount <= MAX_CHUNKS && size <= allocationBudget && CHUNK_SIZE <= maxAllocation) {
+    bool allocated = true;
+    for (size_t i = 0; i < chunkCount; i++) {
+      const size_t offset = i * CHUNK_SIZE;
+      const size_t chunkSize = size - offset < CHUNK_SIZE ? size - offset : CHUNK_SIZE;
+      chunks[i] = static_cast<uint8_t*>(malloc(chunkSize));
+      if (!chunks[i]) {
+        allocated = false;
+        break;
+      }
+      memcpy(chunks[i], frameBuffer + offset, chunkSize);
+    }
+
+    if (allocated) {
+      encoding = Encoding::Raw;
+      frameSize = size;
+      return true;
+    }
+    clear();
+  }
+
+  const size_t encodedSize = packBits(frameBuffer, size, nullptr);
+  if (encodedSize > allocationBudget || encodedSize > maxAllocation) {
+    return false;
+  }
+
+  rleData = static_cast<uint8_t*>(malloc(encodedSize));
+  if (!rleData) {
+    return false;
+  }
+  packBits(frameBuffer, size, rleData);
+  rleSize = encodedSize;
+  encoding = Encoding::Rle;
+  frameSize = size;
+  return true;
+}
+
+bool FrameSnapshot::restore(uint8_t* frameBuffer, const size_t size) const {
+  if (!frameBuffer || size != frameSize) {
+    return false;
+  }
+
+  switch (encoding) {
+    case Encoding::Raw:
+      for (size_t offset = 0, i = 0; offset < size; offset += CHUNK_SIZE, i++) {
+        memcpy(frameBuffer + offset, chunks[i], size - offset < CHUNK_SIZE ? size - offset : CHUNK_SIZE);
+      }
+      return true;
+    case Encoding::Rle:
+      return unpackBits(rleData, rleSize, frameBuffer, size);
+    case Encoding::None:
+    default:
+      return false;
+  }
+}
+
+void FrameSnapshot::clear() {
+  for (auto& chunk : chunks) {
+    if (chunk) {
+      free(chunk);
+      chunk = nullptr;
+    }
+  }
+  if (rleData) {
+    free(rleData);
+    rleData = nullptr;
+  }
+  rleSize = 0;
+  frameSize = 0;
+  encoding = Encoding::None;
+}
+
+size_t FrameSnapshot::getStoredBytes() const {
+  switch (encoding) {
+    case Encoding::Raw:
+      return frameSize;
+    case Encoding::Rle:
+      return rleSize;
+    case Encoding::None:
+    default:
+      return 0;
+  }
+}
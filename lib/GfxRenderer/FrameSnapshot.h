@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Off-screen copy of a framebuffer. Stored raw in 8KB chunks when there is room, otherwise PackBits RLE encoded, which
+// mostly white text pages compress well under.
+class FrameSnapshot {
+ public:
+  enum class Encoding : uint8_t { None, Raw, Rle };
+
+  static constexpr size_t CHUNK_SIZE = 8000;  // 8KB chunks to allow for non-contiguous memory
+
+  FrameSnapshot() = default;
+  ~FrameSnapshot() { clear(); }
+  FrameSnapshot(const FrameSnapshot&) = delete;
+  FrameSnapshot& operator=(const FrameSnapshot&) = delete;
+
+  // allocationBudget is how many bytes may be allocated in total, maxAllocation the largest single allocation
+  bool store(const uint8_t* frameBuffer, size_t size, size_t allocationBudget, size_t maxAllocation);
+  bool restore(uint8_t* frameBuffer, size_t size) const;
+  void clear();
+
+  Encoding getEncoding() const { return encoding; }
+  size_t getStoredBytes() const;
+
+ private:
+  static constexpr size_t MAX_CHUNKS = 8;
+
+  Encoding encoding = Encoding::None;
+  size_t frameSize = 0;
+  uint8_t* chunks[MAX_CHUNKS] = {nullptr};
+  uint8_t* rleData = nullptr;
+  size_t rleSize = 0;
+};
@@ -1,7 +1,10 @@
 #include "GfxRenderer.h"
 
+#include <GreyDitherer.h>
 #include <Utf8.h>
 
+#include <cstring>
+
 void GfxRenderer::insertFont(const int fontId, EpdFontFamily font) { fontMap.insert({fontId, font}); }
 
 void GfxRenderer::drawPixel(const int x, const int y, const bool state) const {
@@ -36,47 +39,58 @@ void GfxRenderer::drawPixel(const int x, const int y, const bool state) const {
   }
 }
 
-int GfxRenderer::getTextWidth(const int fontId, const char* text, const EpdFontStyle style) const {
-  if (fontMap.count(fontId) == 0) {
+FontHandle GfxRenderer::getFont(const int fontId) const {
+  const auto it = fontMap.find(fontId);
+  if (it == fontMap.end()) {
     Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
+    return {};
+  }
+
+  return FontHandle(&it->second);
+}
+
+int GfxRenderer::getTextWidth(const int fontId, const char* text, const EpdFontStyle style) const {
+  return getTextWidth(getFont(fontId), text, style);
+}
+
+int GfxRenderer::getTextWidth(const FontHandle& font, const char* text, const EpdFontStyle style) const {
+  if (!font.isValid()) {
     return 0;
   }
 
   int w = 0, h = 0;
-  fontMap.at(fontId).getTextDimensions(text, &w, &h, style);
+  font.family->getTextDimensions(text, &w, &h, style);
   return w;
 }
 
 void GfxRenderer::drawCenteredText(const int fontId, const int y, const char* text, const bool black,
                                    const EpdFontStyle style) const {
-  const int x = (getScreenWidth() - getTextWidth(fontId, text, style)) / 2;
-  drawText(fontId, x, y, text, black, style);
+  const FontHandle font = getFont(fontId);
+  const int x = (getScreenWidth() - getTextWidth(font, text, style)) / 2;
+  drawText(font, x, y, text, black, style);
 }
 
 void GfxRenderer::drawText(const int fontId, const int x, const int y, const char* text, const bool black,
                            const EpdFontStyle style) const {
-  const int yPos = y + getLineHeight(fontId);
-  int xpos = x;
+  drawText(getFont(fontId), x, y, text, black, style);
+}
 
+void GfxRenderer::drawText(const FontHandle& font, const int x, const int y, const char* text, const bool black,
+                           const EpdFontStyle style) const {
   // cannot draw a NULL / empty string
-  if (text == nullptr || *text == '\0') {
+  if (text == nullptr || *text == '\0' || !font.isValid()) {
     return;
   }
 
-  if (fontMap.count(fontId) == 0) {
-    Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
-    return;
-  }
-  const auto font = fontMap.at(fontId);
-
-  // no printable characters
-  if (!font.hasPrintableChars(text, style)) {
-    return;
-  }
+  // Characters without a glyph (or a '?' fallback) are skipped in renderChar, so there is no need for a separate
+  // printable characters bounds pass before drawing
+  const EpdFontFamily& fontFamily = *font.family;
+  const int yPos = y + getLineHeight(font);
+  int xpos = x;
 
   uint32_t cp;
   while ((cp = utf8NextCodepoint(reinterpret_cast<const uint8_t**>(&text)))) {
-    renderChar(font, cp, &xpos, &yPos, black, style);
+    renderChar(fontFamily, cp, &xpos, &yPos, black, style);
   }
 }
 
@@ -119,71 +133,121 @@ void GfxRenderer::drawImage(const uint8_t bitmap[], const int x, const int y, co
   einkDisplay.drawImage(bitmap, y, x, height, width);
 }
 
+void GfxRenderer::readStrips(const int x, const int y, const int width, const int height, uint8_t* strips) const {
+  const uint8_t* frameBuffer = einkDisplay.getFrameBuffer();
+  if (!frameBuffer) {
+    Serial.printf("[%lu] [GFX] !! No framebuffer in readStrips\n", millis());
+    return;
+  }
+
+  // Every portrait column is one framebuffer row and 8 portrait rows are one byte of it
+  const int stripCount = height / 8;
+  for (int column = 0; column < width; column++) {
+    const int screenX = x + column;
+    for (int strip = 0; strip < stripCount; strip++) {
+      const int byteColumn = y / 8 + strip;
+      const bool inside = screenX >= 0 && screenX < getScreenWidth() && byteColumn >= 0 &&
+                          byteColumn < EInkDisplay::DISPLAY_WIDTH_BYTES;
+      strips[column * stripCount + strip] =
+          inside ? frameBuffer[(EInkDisplay::DISPLAY_HEIGHT - 1 - screenX) * EInkDisplay::DISPLAY_WIDTH_BYTES +
+                               byteColumn]
+                 : 0xFF;
+    }
+  }
+}
+
+void GfxRenderer::drawStrips(const int x, const int y, const int width, const int height, const uint8_t* strips,
+                             const bool blackOnly) const {
+  uint8_t* frameBuffer = einkDisplay.getFrameBuffer();
+  if (!frameBuffer) {
+    Serial.printf("[%lu] [GFX] !! No framebuffer in drawStrips\n", millis());
+    return;
+  }
+
+  const int stripCount = height / 8;
+  for (int column = 0; column < width; column++) {
+    const int screenX = x + column;
+    if (screenX < 0 || screenX >= getScreenWidth()) {
+      continue;
+    }
+    uint8_t* row = frameBuffer + (EInkDisplay::DISPLAY_HEIGHT - 1 - screenX) * EInkDisplay::DISPLAY_WIDTH_BYTES;
+    for (int strip = 0; strip < stripCount; strip++) {
+      const int byteColumn = y / 8 + strip;
+      if (byteColumn < 0 || byteColumn >= EInkDisplay::DISPLAY_WIDTH_BYTES) {
+        continue;
+      }
+      const uint8_t bits = strips[column * stripCount + strip];
+      row[byteColumn] = blackOnly ? row[byteColumn] & bits : bits;
+    }
+  }
+}
+
 void GfxRenderer::drawBitmap(const Bitmap& bitmap, const int x, const int y, const int maxWidth,
                              const int maxHeight) const {
-  float scale = 1.0f;
-  bool isScaled = false;
-  if (maxWidth > 0 && bitmap.getWidth() > maxWidth) {
-    scale = static_cast<float>(maxWidth) / static_cast<float>(bitmap.getWidth());
-    isScaled = true;
-  }
-  if (maxHeight > 0 && bitmap.getHeight() > maxHeight) {
-    scale = std::min(scale, static_cast<float>(maxHeight) / static_cast<float>(bitmap.getHeight()));
-    isScaled = true;
+  uint8_t* frameBuffer = einkDisplay.getFrameBuffer();
+  if (!frameBuffer) {
+    Serial.printf("[%lu] [GFX] !! No framebuffer in drawBitmap\n", millis());
+    return;
   }
 
-  const uint8_t outputRowSize = (bitmap.getWidth() + 3) / 4;
-  auto* outputRow = static_cast<uint8_t*>(malloc(outputRowSize));
+  // Scaled and dithered the same way as images converted to BMP, one source row at a time
+  GreyDitherer ditherer(bitmap.getWidth(), bitmap.getHeight(), maxWidth, maxHeight);
   auto* rowBytes = static_cast<uint8_t*>(malloc(bitmap.getRowBytes()));
+  auto* lumRow = static_cast<uint8_t*>(malloc(bitmap.getWidth()));
 
-  if (!outputRow || !rowBytes) {
+  if (!rowBytes || !lumRow || !ditherer.begin()) {
     Serial.printf("[%lu] [GFX] !! Failed to allocate BMP row buffers\n", millis());
-    free(outputRow);
     free(rowBytes);
+    free(lumRow);
     return;
   }
 
-  for (int bmpY = 0; bmpY < bitmap.getHeight(); bmpY++) {
-    // The BMP's (0, 0) is the bottom-left corner (if the height is positive, top-left if negative).
-    // Screen's (0, 0) is the top-left corner.
-    int screenY = y + (bitmap.isTopDown() ? bmpY : bitmap.getHeight() - 1 - bmpY);
-    if (isScaled) {
-      screenY = std::floor(screenY * scale);
-    }
-    if (screenY >= getScreenHeight()) {
+  const int outWidth = ditherer.getOutWidth();
+  const int outHeight = ditherer.getOutHeight();
+  for (int bmpY = 0; bmpY < bitmap.getHeight() && ditherer.getOutRow() < outHeight; bmpY++) {
+    if (bitmap.readRowLuminance(lumRow, rowBytes) != BmpReaderError::Ok) {
+      Serial.printf("[%lu] [GFX] Failed to read row %d from bitmap\n", millis(), bmpY);
       break;
     }
+    const uint8_t* levels = ditherer.addRow(lumRow);
+    if (!levels) {
+      continue;
+    }
+    const int outRow = ditherer.getOutRow() - 1;
 
-    if (bitmap.readRow(outputRow, rowBytes) != BmpReaderError::Ok) {
-      Serial.printf("[%lu] [GFX] Failed to read row %d from bitmap\n", millis(), bmpY);
-      free(outputRow);
-      free(rowBytes);
-      return;
+    // The BMP's (0, 0) is the bottom-left corner (if the height is positive, top-left if negative).
+    // Screen's (0, 0) is the top-left corner.
+    const int screenY = y + (bitmap.isTopDown() ? outRow : outHeight - 1 - outRow);
+    if (screenY < 0 || screenY >= getScreenHeight()) {
+      continue;
     }
 
-    for (int bmpX = 0; bmpX < bitmap.getWidth(); bmpX++) {
-      int screenX = x + bmpX;
-      if (isScaled) {
-        screenX = std::floor(screenX * scale);
-      }
-      if (screenX >= getScreenWidth()) {
-        break;
-      }
+    // Rotate coordinates: portrait (480x800) -> landscape (800x480), a portrait row is one framebuffer bit column
+    const int byteColumn = screenY / 8;
+    const uint8_t bitMask = 1 << (7 - screenY % 8);
 
-      const uint8_t val = outputRow[bmpX / 4] >> (6 - ((bmpX * 2) % 8)) & 0x3;
+    for (int outX = 0; outX < outWidth; outX++) {
+      const int screenX = x + outX;
+      if (screenX < 0 || screenX >= getScreenWidth()) {
+        continue;
+      }
+      uint8_t& byte =
+          frameBuffer[(EInkDisplay::DISPLAY_HEIGHT - 1 - screenX) * EInkDisplay::DISPLAY_WIDTH_BYTES + byteColumn];
 
+      // Levels: 0 = black, 1 = dark gray, 2 = light gray, 3 = white
+      const uint8_t val = levels[outX];
       if (renderMode == BW && val < 3) {
-        drawPixel(screenX, screenY);
+        byte &= ~bitMask;
       } else if (renderMode == GRAYSCALE_MSB && (val == 1 || val == 2)) {
-        drawPixel(screenX, screenY, false);
+        byte |= bitMask;
       } else if (renderMode == GRAYSCALE_LSB && val == 1) {
-        drawPixel(screenX, screenY, false);
+        byte |= bitMask;
       }
     }
   }
 
-  free(outputRow);
   free(rowBytes);
+  free(lumRow);
 }
 
 void GfxRenderer::clearScreen(const uint8_t color) const { einkDisplay.clearScreen(color); }
@@ -199,11 +263,17 @@ void GfxRenderer::invertScreen() const {
   }
 }
 
-void GfxRenderer::displayBuffer(const EInkDisplay::RefreshMode refreshMode) const {
+void GfxRenderer::displayBuffer(const EInkDisplay::RefreshMode refreshMode) {
   einkDisplay.displayBuffer(refreshMode);
+  refreshedTop = 0;
+  refreshedBottom = getScreenHeight();
+
+  // The panel now matches the framebuffer, remember it so displayChanges can diff against it
+  flushedBandSignaturesValid = computeBandSignatures(flushedBandSignatures);
+  consecutiveWindowUpdates = 0;
 }
 
-void GfxRenderer::displayWindow(const int x, const int y, const int width, const int height) const {
+void GfxRenderer::displayWindow(const int x, const int y, const int width, const int height) {
   // Rotate coordinates from portrait (480x800) to landscape (800x480)
   // Rotation: 90 degrees clockwise
   // Portrait coordinates: (x, y) with dimensions (width, height)
@@ -215,41 +285,127 @@ void GfxRenderer::displayWindow(const int x, const int y, const int width, const
   const int rotatedHeight = width;
 
   einkDisplay.displayWindow(rotatedX, rotatedY, rotatedWidth, rotatedHeight);
+  refreshedTop = y;
+  refreshedBottom = y + height;
+
+  // Areas outside the window may still differ from the framebuffer
+  flushedBandSignaturesValid = false;
+}
+
+bool GfxRenderer::computeBandSignatures(uint32_t* signatures) const {
+  const uint8_t* frameBuffer = einkDisplay.getFrameBuffer();
+  if (!frameBuffer) {
+    Serial.printf("[%lu] [GFX] !! No framebuffer in computeBandSignatures\n", millis());
+    return false;
+  }
+
+  // FNV-1a over each byte column, walking the buffer row by row to keep reads sequential
+  for (int band = 0; band < DIRTY_BAND_COUNT; band++) {
+    signatures[band] = 2166136261u;
+  }
+  for (int row = 0; row < EInkDisplay::DISPLAY_HEIGHT; row++) {
+    const uint8_t* rowBytes = frameBuffer + row * EInkDisplay::DISPLAY_WIDTH_BYTES;
+    for (int band = 0; band < DIRTY_BAND_COUNT; band++) {
+      signatures[band] = (signatures[band] ^ rowBytes[band]) * 16777619u;
+    }
+  }
+
+  return true;
+}
+
+void GfxRenderer::displayChanges() {
+  refreshedTop = 0;
+  refreshedBottom = 0;
+  if (!flushedBandSignaturesValid) {
+    displayBuffer();
+    return;
+  }
+
+  uint32_t signatures[DIRTY_BAND_COUNT];
+  if (!computeBandSignatures(signatures)) {
+    return;
+  }
+
+  int firstDirtyBand = -1;
+  int lastDirtyBand = -1;
+  for (int band = 0; band < DIRTY_BAND_COUNT; band++) {
+    if (signatures[band] != flushedBandSignatures[band]) {
+      if (firstDirtyBand < 0) {
+        firstDirtyBand = band;
+      }
+      lastDirtyBand = band;
+    }
+  }
+
+  if (firstDirtyBand < 0) {
+    // Nothing changed since the last flush
+    return;
+  }
+
+  // Framebuffer byte columns map to portrait rows, so the dirty region spans the full portrait width
+  const int dirtyBands = lastDirtyBand - firstDirtyBand + 1;
+  if (dirtyBands * 100 > DIRTY_BAND_COUNT * MAX_WINDOW_AREA_PERCENT ||
+      consecutiveWindowUpdates >= MAX_CONSECUTIVE_WINDOW_UPDATES) {
+    displayBuffer();
+    return;
+  }
+
+  const int y = firstDirtyBand * DIRTY_BAND_HEIGHT;
+  const int height = dirtyBands * DIRTY_BAND_HEIGHT;
+  Serial.printf("[%lu] [GFX] Windowed update rows %d-%d\n", millis(), y, y + height - 1);
+  displayWindow(0, y, getScreenWidth(), height);
+
+  // The window covered every changed band, so the panel matches the framebuffer again
+  memcpy(flushedBandSignatures, signatures, sizeof(flushedBandSignatures));
+  flushedBandSignaturesValid = true;
+  consecutiveWindowUpdates++;
+}
+
+bool GfxRenderer::wasRefreshed(const int y, const int height) const {
+  return refreshedTop < y + height && y < refreshedBottom;
 }
 
 // Note: Internal driver treats screen in command orientation, this library treats in portrait orientation
 int GfxRenderer::getScreenWidth() { return EInkDisplay::DISPLAY_HEIGHT; }
 int GfxRenderer::getScreenHeight() { return EInkDisplay::DISPLAY_WIDTH; }
 
-int GfxRenderer::getSpaceWidth(const int fontId) const {
-  if (fontMap.count(fontId) == 0) {
-    Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
+int GfxRenderer::getSpaceWidth(const int fontId) const { return getSpaceWidth(getFont(fontId)); }
+
+int GfxRenderer::getSpaceWidth(const FontHandle& font) const {
+  if (!font.isValid()) {
     return 0;
   }
 
-  return fontMap.at(fontId).getGlyph(' ', REGULAR)->advanceX;
+  return font.family->getGlyph(' ', REGULAR)->advanceX;
 }
 
-int GfxRenderer::getLineHeight(const int fontId) const {
-  if (fontMap.count(fontId) == 0) {
-    Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
+int GfxRenderer::getLineHeight(const int fontId) const { return getLineHeight(getFont(fontId)); }
+
+int GfxRenderer::getLineHeight(const FontHandle& font) const {
+  if (!font.isValid()) {
     return 0;
   }
 
-  return fontMap.at(fontId).getData(REGULAR)->advanceY;
+  return font.family->getData(REGULAR)->advanceY;
 }
 
 uint8_t* GfxRenderer::getFrameBuffer() const { return einkDisplay.getFrameBuffer(); }
 
 size_t GfxRenderer::getBufferSize() { return EInkDisplay::BUFFER_SIZE; }
 
-void GfxRenderer::grayscaleRevert() const { einkDisplay.grayscaleRevert(); }
+void GfxRenderer::grayscaleRevert() {
+  einkDisplay.grayscaleRevert();
+  flushedBandSignaturesValid = false;
+}
 
 void GfxRenderer::copyGrayscaleLsbBuffers() const { einkDisplay.copyGrayscaleLsbBuffers(einkDisplay.getFrameBuffer()); }
 
 void GfxRenderer::copyGrayscaleMsbBuffers() const { einkDisplay.copyGrayscaleMsbBuffers(einkDisplay.getFrameBuffer()); }
 
-void GfxRenderer::displayGrayBuffer() const { einkDisplay.displayGrayBuffer(); }
+void GfxRenderer::displayGrayBuffer() {
+  einkDisplay.displayGrayBuffer();
+  flushedBandSignaturesValid = false;
+}
 
 void GfxRenderer::freeBwBufferChunks() {
   for (auto& bwBufferChunk : bwBufferChunks) {
@@ -266,6 +422,7 @@ void GfxRenderer::freeBwBufferChunks() {
  * Uses chunked allocation to avoid needing 48KB of contiguous memory.
  */
 void GfxRenderer::storeBwBuffer() {
+  signaturesValidBeforeGrayscale = flushedBandSignaturesValid;
   const uint8_t* frameBuffer = einkDisplay.getFrameBuffer();
   if (!frameBuffer) {
     Serial.printf("[%lu] [GFX] !! No framebuffer in storeBwBuffer\n", millis());
@@ -340,6 +497,9 @@ void GfxRenderer::restoreBwBuffer() {
   }
 
   einkDisplay.cleanupGrayscaleBuffers(frameBuffer);
+  // The grey levels only went on top of the flushed frame, which is back in the framebuffer. Bands the next update
+  // leaves alone keep their grey, so there's no need for a full refresh.
+  flushedBandSignaturesValid = signaturesValidBeforeGrayscale;
 
   freeBwBufferChunks();
   Serial.printf("[%lu] [GFX] Restored and freed BW buffer chunks\n", millis());
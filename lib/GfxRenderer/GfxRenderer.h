@@ -7,6 +7,7 @@
 #include <map>
 
 #include "Bitmap.h"
+#include "FontHandle.h"
 
 class GfxRenderer {
  public:
@@ -17,14 +18,29 @@ class GfxRenderer {
   static constexpr size_t BW_BUFFER_NUM_CHUNKS = EInkDisplay::BUFFER_SIZE / BW_BUFFER_CHUNK_SIZE;
   static_assert(BW_BUFFER_CHUNK_SIZE * BW_BUFFER_NUM_CHUNKS == EInkDisplay::BUFFER_SIZE,
                 "BW buffer chunking does not line up with display buffer size");
+  // One signature per framebuffer byte column, i.e. per 8 portrait rows
+  static constexpr int DIRTY_BAND_COUNT = EInkDisplay::DISPLAY_WIDTH_BYTES;
+  static constexpr int DIRTY_BAND_HEIGHT = 8;
+  // Fall back to a full refresh when more than this share of the screen (in percent) changed
+  static constexpr int MAX_WINDOW_AREA_PERCENT = 50;
+  // Force a full refresh after this many windowed updates to clear accumulated artifacts
+  static constexpr int MAX_CONSECUTIVE_WINDOW_UPDATES = 20;
 
   EInkDisplay& einkDisplay;
   RenderMode renderMode;
   uint8_t* bwBufferChunks[BW_BUFFER_NUM_CHUNKS] = {nullptr};
   std::map<int, EpdFontFamily> fontMap;
+  uint32_t flushedBandSignatures[DIRTY_BAND_COUNT] = {0};
+  bool flushedBandSignaturesValid = false;
+  bool signaturesValidBeforeGrayscale = false;
+  // Portrait rows the last display call refreshed, empty if it found nothing to do
+  int refreshedTop = 0;
+  int refreshedBottom = 0;
+  int consecutiveWindowUpdates = 0;
   void renderChar(const EpdFontFamily& fontFamily, uint32_t cp, int* x, const int* y, bool pixelState,
                   EpdFontStyle style) const;
   void freeBwBufferChunks();
+  bool computeBandSignatures(uint32_t* signatures) const;
 
  public:
   explicit GfxRenderer(EInkDisplay& einkDisplay) : einkDisplay(einkDisplay), renderMode(BW) {}
@@ -36,9 +52,13 @@ class GfxRenderer {
   // Screen ops
   static int getScreenWidth();
   static int getScreenHeight();
-  void displayBuffer(EInkDisplay::RefreshMode refreshMode = EInkDisplay::FAST_REFRESH) const;
-  // EXPERIMENTAL: Windowed update - display only a rectangular region (portrait coordinates)
-  void displayWindow(int x, int y, int width, int height) const;
+  void displayBuffer(EInkDisplay::RefreshMode refreshMode = EInkDisplay::FAST_REFRESH);
+  // Windowed update - display only a rectangular region (portrait coordinates)
+  void displayWindow(int x, int y, int width, int height);
+  // Display only what changed since the last flush, picking between a windowed update and a full fast refresh
+  void displayChanges();
+  // Whether the last display call refreshed any of the portrait rows y to y + height - 1, grey levels there are gone
+  bool wasRefreshed(int y, int height) const;
   void invertScreen() const;
   void clearScreen(uint8_t color = 0xFF) const;
 
@@ -49,24 +69,36 @@ class GfxRenderer {
   void fillRect(int x, int y, int width, int height, bool state = true) const;
   void drawImage(const uint8_t bitmap[], int x, int y, int width, int height) const;
   void drawBitmap(const Bitmap& bitmap, int x, int y, int maxWidth, int maxHeight) const;
+  // Panel bytes under a portrait area whose top and height are multiples of 8, height / 8 bytes per column with the
+  // columns one after another. Bytes read out can be drawn back anywhere with the same byte aligned height.
+  void readStrips(int x, int y, int width, int height, uint8_t* strips) const;
+  // blackOnly only clears bits, so anything already drawn under the white parts of the strips stays
+  void drawStrips(int x, int y, int width, int height, const uint8_t* strips, bool blackOnly) const;
 
   // Text
+  FontHandle getFont(int fontId) const;
   int getTextWidth(int fontId, const char* text, EpdFontStyle style = REGULAR) const;
+  int getTextWidth(const FontHandle& font, const char* text, EpdFontStyle style = REGULAR) const;
   void drawCenteredText(int fontId, int y, const char* text, bool black = true, EpdFontStyle style = REGULAR) const;
   void drawText(int fontId, int x, int y, const char* text, bool black = true, EpdFontStyle style = REGULAR) const;
+  void drawText(const FontHandle& font, int x, int y, const char* text, bool black = true,
+                EpdFontStyle style = REGULAR) const;
   int getSpaceWidth(int fontId) const;
+  int getSpaceWidth(const FontHandle& font) const;
   int getLineHeight(int fontId) const;
+  int getLineHeight(const FontHandle& font) const;
 
   // Grayscale functions
   void setRenderMode(const RenderMode mode) { this->renderMode = mode; }
+  RenderMode getRenderMode() const { return renderMode; }
   void copyGrayscaleLsbBuffers() const;
   void copyGrayscaleMsbBuffers() const;
-  void displayGrayBuffer() const;
+  void displayGrayBuffer();
   void storeBwBuffer();
   void restoreBwBuffer();
 
   // Low level functions
   uint8_t* getFrameBuffer() const;
   static size_t getBufferSize();
-  void grayscaleRevert() const;
+  void grayscaleRevert();
 };
@@ -0,0 +1,226 @@
+#include "PlaneBitmap.h"
+
+#include <EInkDisplay.h>
+#include <HardwareSerial.h>
+#include <Serialization.h>
+
+#include <cstring>
+
+#include "Bitmap.h"
+#include "GfxRenderer.h"
+
+namespace {
+constexpr uint8_t PLANE_BITMAP_VERSION = 1;
+constexpr char PLANE_BITMAP_MAGIC[4] = {'X', 'P', 'P', 'B'};
+constexpr size_t HEADER_SIZE = sizeof(PLANE_BITMAP_MAGIC) + sizeof(uint8_t) + 2 * sizeof(uint16_t) + sizeof(uint8_t);
+constexpr int STRIP_HEIGHT = 8;
+
+size_t planeSize(const PlaneBitmap::Header& header) {
+  return static_cast<size_t>(header.width) * ((header.height + STRIP_HEIGHT - 1) / STRIP_HEIGHT);
+}
+
+bool writeHeader(File& file, const PlaneBitmap::Header& header) {
+  if (file.write(reinterpret_cast<const uint8_t*>(PLANE_BITMAP_MAGIC), sizeof(PLANE_BITMAP_MAGIC)) !=
+      sizeof(PLANE_BITMAP_MAGIC)) {
+    return false;
+  }
+  serialization::writePod(file, PLANE_BITMAP_VERSION);
+  serialization::writePod(file, header.width);
+  serialization::writePod(file, header.height);
+  serialization::writePod(file, static_cast<uint8_t>(header.hasGrayscale));
+  return true;
+}
+
+// Whether a pixel at panel level 0 (black) to 3 (white) sets its bit in a plane, matching drawBitmap's pass rules
+bool planeBit(const int plane, const uint8_t level) {
+  switch (plane) {
+    case 0:  // BW, a cleared bit is black
+      return level == 3;
+    case 1:  // LSB
+      return level == 1;
+    default:  // MSB
+      return level == 1 || level == 2;
+  }
+}
+}  // namespace
+
+bool PlaneBitmap::writeFromBmp(File& bmpFile, File& out, Header* header) {
+  Bitmap bitmap(bmpFile);
+  const auto error = bitmap.parseHeaders();
+  if (error != BmpReaderError::Ok) {
+    Serial.printf("[%lu] [PLB] Failed to parse BMP: %s\n", millis(), Bitmap::errorToString(error));
+    return false;
+  }
+  if (!bitmap.isTopDown() || bitmap.getWidth() > UINT16_MAX || bitmap.getHeight() > UINT16_MAX) {
+    Serial.printf("[%lu] [PLB] Unsupported BMP layout\n", millis());
+    return false;
+  }
+
+  Header planeHeader;
+  planeHeader.width = bitmap.getWidth();
+  planeHeader.height = bitmap.getHeight();
+  const int width = planeHeader.width;
+  const int height = planeHeader.height;
+
+  // 8 rows of panel levels for one strip, the packed strip, and a BMP row
+  auto* levels = static_cast<uint8_t*>(malloc(width * STRIP_HEIGHT));
+  auto* strip = static_cast<uint8_t*>(malloc(width));
+  auto* rowBytes = static_cast<uint8_t*>(malloc(bitmap.getRowBytes()));
+  if (!levels || !strip || !rowBytes) {
+    Serial.printf("[%lu] [PLB] Failed to allocate strip buffers\n", millis());
+    free(levels);
+    free(strip);
+    free(rowBytes);
+    return false;
+  }
+
+  // The grayscale flag is only known after the BW pass, so the header is rewritten at the end
+  bool success = writeHeader(out, planeHeader);
+  for (int plane = 0; plane < 3 && success; plane++) {
+    if (plane == 1 && !planeHeader.hasGrayscale) {
+      break;
+    }
+    if (bitmap.rewindToData() != BmpReaderError::Ok) {
+      success = false;
+      break;
+    }
+
+    for (int stripY = 0; stripY < height && success; stripY += STRIP_HEIGHT) {
+      // Rows past the bottom edge are padding and stay white
+      memset(levels, 3, width * STRIP_HEIGHT);
+      for (int row = 0; row < STRIP_HEIGHT && stripY + row < height; row++) {
+        uint8_t* rowLevels = levels + row * width;
+        if (bitmap.readRowLuminance(rowLevels, rowBytes) != BmpReaderError::Ok) {
+          success = false;
+          break;
+        }
+        for (int x = 0; x < width; x++) {
+          rowLevels[x] = (rowLevels[x] + 42) / 85;
+          if (plane == 0 && (rowLevels[x] == 1 || rowLevels[x] == 2)) {
+            planeHeader.hasGrayscale = true;
+          }
+        }
+      }
+
+      for (int x = 0; x < width; x++) {
+        uint8_t byte = 0;
+        for (int row = 0; row < STRIP_HEIGHT; row++) {
+          if (planeBit(plane, levels[row * width + x])) {
+            byte |= 1 << (7 - row);
+          }
+        }
+        strip[x] = byte;
+      }
+      success = success && out.write(strip, width) == static_cast<size_t>(width);
+    }
+  }
+
+  free(levels);
+  free(strip);
+  free(rowBytes);
+
+  if (success) {
+    success = out.seek(0) && writeHeader(out, planeHeader);
+  }
+  if (!success) {
+    Serial.printf("[%lu] [PLB] Failed to write plane bitmap\n", millis());
+    return false;
+  }
+
+  if (header) {
+    *header = planeHeader;
+  }
+  return true;
+}
+
+bool PlaneBitmap::readHeader(File& file, Header& header) {
+  char magic[sizeof(PLANE_BITMAP_MAGIC)];
+  if (file.read(reinterpret_cast<uint8_t*>(magic), sizeof(magic)) != sizeof(magic) ||
+      memcmp(magic, PLANE_BITMAP_MAGIC, sizeof(magic)) != 0) {
+    Serial.printf("[%lu] [PLB] Not a plane bitmap\n", millis());
+    return false;
+  }
+
+  uint8_t version;
+  serialization::readPod(file, version);
+  if (version != PLANE_BITMAP_VERSION) {
+    Serial.printf("[%lu] [PLB] Deserialization failed: Unknown version %u\n", millis(), version);
+    return false;
+  }
+
+  uint8_t hasGrayscale;
+  serialization::readPod(file, header.width);
+  serialization::readPod(file, header.height);
+  serialization::readPod(file, hasGrayscale);
+  header.hasGrayscale = hasGrayscale != 0;
+
+  // A write that was cut short leaves missing planes behind
+  const size_t expectedSize = HEADER_SIZE + (header.hasGrayscale ? 3 : 1) * planeSize(header);
+  if (file.size() != expectedSize) {
+    Serial.printf("[%lu] [PLB] Truncated plane bitmap: %u of %u bytes\n", millis(),
+                  static_cast<unsigned>(file.size()), static_cast<unsigned>(expectedSize));
+    return false;
+  }
+
+  return true;
+}
+
+bool PlaneBitmap::draw(const GfxRenderer& renderer, File& file, const int x, const int y) {
+  Header header;
+  if (!readHeader(file, header)) {
+    return false;
+  }
+  return draw(renderer, file, header, x, y);
+}
+
+bool PlaneBitmap::draw(const GfxRenderer& renderer, File& file, const Header& header, const int x, const int y) {
+  int plane = 0;
+  if (renderer.getRenderMode() == GfxRenderer::GRAYSCALE_LSB) {
+    plane = 1;
+  } else if (renderer.getRenderMode() == GfxRenderer::GRAYSCALE_MSB) {
+    plane = 2;
+  }
+  // Grayscale passes start from a cleared buffer, so a plane that was never stored has nothing to add
+  if (plane > 0 && !header.hasGrayscale) {
+    return true;
+  }
+
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+  if (!frameBuffer || !file.seek(HEADER_SIZE + plane * planeSize(header))) {
+    return false;
+  }
+
+  auto* strip = static_cast<uint8_t*>(malloc(header.width));
+  if (!strip) {
+    Serial.printf("[%lu] [PLB] Failed to allocate strip buffer\n", millis());
+    return false;
+  }
+
+  // Rotate coordinates: portrait (480x800) -> landscape (800x480), a strip of 8 portrait rows is one framebuffer byte
+  // column and every portrait column is one framebuffer row
+  const int stripCount = (header.height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+  const int firstByteColumn = y / STRIP_HEIGHT;
+  bool success = true;
+  for (int stripIndex = 0; stripIndex < stripCount; stripIndex++) {
+    if (file.read(strip, header.width) != header.width) {
+      success = false;
+      break;
+    }
+
+    const int byteColumn = firstByteColumn + stripIndex;
+    if (byteColumn < 0 || byteColumn >= EInkDisplay::DISPLAY_WIDTH_BYTES) {
+      continue;
+    }
+    for (int column = 0; column < header.width; column++) {
+      const int screenX = x + column;
+      if (screenX < 0 || screenX >= GfxRenderer::getScreenWidth()) {
+        continue;
+      }
+      frameBuffer[(EInkDisplay::DISPLAY_HEIGHT - 1 - screenX) * EInkDisplay::DISPLAY_WIDTH_BYTES + byteColumn] =
+          strip[column];
+    }
+  }
+
+  free(strip);
+  return success;
+}
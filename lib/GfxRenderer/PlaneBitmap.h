@@ -0,0 +1,25 @@
+#pragma once
+
+#include <FS.h>
+
+class GfxRenderer;
+
+// Image that has already been scaled and dithered, stored as the panel's BW, LSB and MSB bit planes. Each plane is a
+// run of 8 row strips with one byte per column, and every byte lands as-is in one framebuffer byte, so drawing is a
+// copy with no decoding. Layout: header, BW plane, then LSB and MSB planes when the image has grayscale.
+class PlaneBitmap {
+ public:
+  struct Header {
+    uint16_t width = 0;
+    uint16_t height = 0;
+    bool hasGrayscale = false;
+  };
+
+  // Splits a top-down BMP (as written by the image converters) into planes, rounding each pixel to the 4 panel levels
+  static bool writeFromBmp(File& bmpFile, File& out, Header* header);
+  static bool readHeader(File& file, Header& header);
+  // The top edge is rounded down to a multiple of 8 rows, which is what makes the copy byte aligned
+  static bool draw(const GfxRenderer& renderer, File& file, int x, int y);
+  // Same as above for a file whose header has already been read, it only seeks to the plane for the render mode
+  static bool draw(const GfxRenderer& renderer, File& file, const Header& header, int x, int y);
+};
@@ -0,0 +1,64 @@
+#include "PlaneImage.h"
+
+#include <EInkDisplay.h>
+#include <HardwareSerial.h>
+#include <Serialization.h>
+
+#include <cstring>
+
+namespace {
+constexpr uint8_t PLANE_IMAGE_VERSION = 1;
+constexpr char PLANE_IMAGE_MAGIC[4] = {'X', 'P', 'P', 'L'};
+constexpr size_t HEADER_SIZE = sizeof(PLANE_IMAGE_MAGIC) + sizeof(uint8_t) + 2 * sizeof(uint32_t) + sizeof(uint8_t);
+}  // namespace
+
+bool PlaneImage::writeHeader(File& file, const Header& header) {
+  if (file.write(reinterpret_cast<const uint8_t*>(PLANE_IMAGE_MAGIC), sizeof(PLANE_IMAGE_MAGIC)) !=
+      sizeof(PLANE_IMAGE_MAGIC)) {
+    return false;
+  }
+  serialization::writePod(file, PLANE_IMAGE_VERSION);
+  serialization::writePod(file, header.sourceSize);
+  serialization::writePod(file, header.sourceTime);
+  serialization::writePod(file, static_cast<uint8_t>(header.hasGrayscale));
+  return true;
+}
+
+bool PlaneImage::readHeader(File& file, Header& header) {
+  char magic[sizeof(PLANE_IMAGE_MAGIC)];
+  if (file.read(reinterpret_cast<uint8_t*>(magic), sizeof(magic)) != sizeof(magic) ||
+      memcmp(magic, PLANE_IMAGE_MAGIC, sizeof(magic)) != 0) {
+    Serial.printf("[%lu] [PLI] Not a plane image\n", millis());
+    return false;
+  }
+
+  uint8_t version;
+  serialization::readPod(file, version);
+  if (version != PLANE_IMAGE_VERSION) {
+    Serial.printf("[%lu] [PLI] Deserialization failed: Unknown version %u\n", millis(), version);
+    return false;
+  }
+
+  uint8_t hasGrayscale;
+  serialization::readPod(file, header.sourceSize);
+  serialization::readPod(file, header.sourceTime);
+  serialization::readPod(file, hasGrayscale);
+  header.hasGrayscale = hasGrayscale != 0;
+
+  // A write that was cut short leaves missing planes behind
+  const size_t expectedSize = HEADER_SIZE + (header.hasGrayscale ? 3 : 1) * EInkDisplay::BUFFER_SIZE;
+  if (file.size() != expectedSize) {
+    Serial.printf("[%lu] [PLI] Truncated plane image: %d of %d bytes\n", millis(), file.size(), expectedSize);
+    return false;
+  }
+
+  return true;
+}
+
+bool PlaneImage::writePlane(File& file, const uint8_t* frameBuffer) {
+  return frameBuffer && file.write(frameBuffer, EInkDisplay::BUFFER_SIZE) == EInkDisplay::BUFFER_SIZE;
+}
+
+bool PlaneImage::readPlane(File& file, uint8_t* frameBuffer) {
+  return frameBuffer && file.read(frameBuffer, EInkDisplay::BUFFER_SIZE) == EInkDisplay::BUFFER_SIZE;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <FS.h>
+
+#include <string>
+
+// Full screen image cached as the display's BW, LSB and MSB framebuffer planes, so it can be shown with sequential
+// reads straight into the framebuffer instead of decoding and scaling the source image for every pass.
+// Layout: header, BW plane, then LSB and MSB planes when the image has grayscale. Each plane is one framebuffer.
+class PlaneImage {
+ public:
+  struct Header {
+    // Identify the source image the planes were rendered from, a change in either invalidates the cache
+    uint32_t sourceSize = 0;
+    uint32_t sourceTime = 0;
+    bool hasGrayscale = false;
+  };
+
+  static bool writeHeader(File& file, const Header& header);
+  // Reads the header and checks that the file holds every plane it announces
+  static bool readHeader(File& file, Header& header);
+  static bool writePlane(File& file, const uint8_t* frameBuffer);
+  static bool readPlane(File& file, uint8_t* frameBuffer);
+};
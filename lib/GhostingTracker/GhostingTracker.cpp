@@ -0,0 +1,79 @@
+#include "GhostingTracker.h"
+
+#include <algorithm>
+
+namespace {
+uint8_t countBlackPixels(const uint8_t byte) {
+  // Cleared bits are black
+  return 8 - __builtin_popcount(byte);
+}
+}  // namespace
+
+GhostingTracker::GhostingTracker(const int widthBytes, const int height)
+    : widthBytes(widthBytes),
+      height(height),
+      tilesPerRow((widthBytes + TILE_WIDTH_BYTES - 1) / TILE_WIDTH_BYTES),
+      tileRows((height + TILE_HEIGHT - 1) / TILE_HEIGHT),
+      tileBlackCounts(static_cast<size_t>(tilesPerRow) * tileRows, 0) {}
+
+void GhostingTracker::observe(const uint8_t* frameBuffer) {
+  if (!frameBuffer) {
+    return;
+  }
+
+  uint32_t flipped = 0;
+  uint32_t blackToWhite = 0;
+  std::vector<uint8_t> rowCounts(tilesPerRow);
+
+  for (int tileRow = 0; tileRow < tileRows; tileRow++) {
+    std::fill(rowCounts.begin(), rowCounts.end(), 0);
+
+    const int lastRow = std::min(height, (tileRow + 1) * TILE_HEIGHT);
+    for (int row = tileRow * TILE_HEIGHT; row < lastRow; row++) {
+      const uint8_t* rowBytes = frameBuffer + row * widthBytes;
+      for (int byteX = 0; byteX < widthBytes; byteX++) {
+        rowCounts[byteX / TILE_WIDTH_BYTES] += countBlackPixels(rowBytes[byteX]);
+      }
+    }
+
+    uint8_t* previousCounts = &tileBlackCounts[static_cast<size_t>(tileRow) * tilesPerRow];
+    for (int tile = 0; tile < tilesPerRow; tile++) {
+      // A tile's black count difference is a lower bound on the pixels that flipped inside it
+      if (previousCounts[tile] > rowCounts[tile]) {
+        flipped += previousCounts[tile] - rowCounts[tile];
+        blackToWhite += previousCounts[tile] - rowCounts[tile];
+      } else {
+        flipped += rowCounts[tile] - previousCounts[tile];
+      }
+      previousCounts[tile] = rowCounts[tile];
+    }
+  }
+
+  if (hasPreviousFrame) {
+    flippedPixels += flipped;
+    blackToWhitePixels += blackToWhite;
+  }
+  hasPreviousFrame = true;
+  pagesSinceFullRefresh++;
+}
+
+bool GhostingTracker::exceedsBudget(const uint32_t flippedPixels, const uint32_t blackToWhitePixels,
+                                    const int pagesSinceFullRefresh, const uint32_t screenPixels) {
+  if (pagesSinceFullRefresh >= MAX_PAGES_BETWEEN_FULL_REFRESH) {
+    return true;
+  }
+  return flippedPixels * 100 >= screenPixels * FLIPPED_BUDGET_PERCENT ||
+         blackToWhitePixels * 100 >= screenPixels * BLACK_TO_WHITE_BUDGET_PERCENT;
+}
+
+bool GhostingTracker::shouldFullRefresh() const {
+  const uint32_t screenPixels = static_cast<uint32_t>(widthBytes) * 8 * height;
+  return fullRefreshRequested || exceedsBudget(flippedPixels, blackToWhitePixels, pagesSinceFullRefresh, screenPixels);
+}
+
+void GhostingTracker::onFullRefresh() {
+  fullRefreshRequested = false;
+  flippedPixels = 0;
+  blackToWhitePixels = 0;
+  pagesSinceFullRefresh = 0;
+}
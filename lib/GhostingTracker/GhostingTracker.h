@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decides when an e-ink page turn needs a slow (ghost clearing) refresh based on how much the panel content has
+// changed since the last one. Keeps no previous frame, only per tile black pixel counts. It works on plain framebuffer
+// bytes and lives outside GfxRenderer so host tests can feed it recorded framebuffers without a display.
+class GhostingTracker {
+ public:
+  // Tiles are 2 bytes (16 pixels) wide and 8 rows tall so a tile count always fits in a byte
+  static constexpr int TILE_WIDTH_BYTES = 2;
+  static constexpr int TILE_HEIGHT = 8;
+
+  // Accumulated change budgets, in percent of the screen area, so they can exceed 100. A full page of reader text
+  // flips about 8.5% of the screen, which lands plain text near the old fixed cadence of 15 pages. Sparse pages
+  // stretch it and image heavy pages shorten it (see test/test_ghosting_tracker).
+  static constexpr uint32_t FLIPPED_BUDGET_PERCENT = 120;
+  static constexpr uint32_t BLACK_TO_WHITE_BUDGET_PERCENT = 60;
+  // Safety net for content the tile estimate under-counts (e.g. text reflowing within the same tiles)
+  static constexpr int MAX_PAGES_BETWEEN_FULL_REFRESH = 30;
+
+  // Framebuffer geometry in bytes per row and rows, 1 bit per pixel with 0 meaning black
+  GhostingTracker(int widthBytes, int height);
+
+  // The policy on its own: whether the change accumulated since the last slow refresh calls for another one
+  static bool exceedsBudget(uint32_t flippedPixels, uint32_t blackToWhitePixels, int pagesSinceFullRefresh,
+                            uint32_t screenPixels);
+
+  // Record the framebuffer that is about to be displayed
+  void observe(const uint8_t* frameBuffer);
+  bool shouldFullRefresh() const;
+  // Call after the slow refresh has been issued for the observed frame
+  void onFullRefresh();
+  // Force the next page to use a slow refresh (e.g. after an overlay was drawn outside of observe)
+  void requestFullRefresh() { fullRefreshRequested = true; }
+
+  uint32_t getFlippedPixels() const { return flippedPixels; }
+  uint32_t getBlackToWhitePixels() const { return blackToWhitePixels; }
+  int getPagesSinceFullRefresh() const { return pagesSinceFullRefresh; }
+
+ private:
+  int widthBytes;
+  int height;
+  int tilesPerRow;
+  int tileRows;
+  std::vector<uint8_t> tileBlackCounts;
+  bool hasPreviousFrame = false;
+  bool fullRefreshRequested = true;
+  uint32_t flippedPixels = 0;
+  uint32_t blackToWhitePixels = 0;
+  int pagesSinceFullRefresh = 0;
+};
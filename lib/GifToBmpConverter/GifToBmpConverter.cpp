@@ -0,0 +1,325 @@
+#include "GifToBmpConverter.h"
+
+#include <DitheredBmpWriter.h>
+#include <HardwareSerial.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr int MAX_LZW_CODES = 4096;
+constexpr int MAX_LZW_BITS = 12;
+
+bool readExact(Stream& in, uint8_t* buffer, const size_t length) { return in.readBytes(buffer, length) == length; }
+
+uint16_t readLe16(const uint8_t* bytes) { return bytes[0] | bytes[1] << 8; }
+
+// Skips a chain of data sub-blocks up to and including the zero length terminator
+bool skipSubBlocks(Stream& in) {
+  uint8_t block[255];
+  while (true) {
+    uint8_t length;
+    if (!readExact(in, &length, 1)) {
+      return false;
+    }
+    if (length == 0) {
+      return true;
+    }
+    if (!readExact(in, block, length)) {
+      return false;
+    }
+  }
+}
+
+bool readColorTable(Stream& in, const int entries, uint8_t* gray) {
+  for (int i = 0; i < entries; i++) {
+    uint8_t rgb[3];
+    if (!readExact(in, rgb, 3)) {
+      return false;
+    }
+    gray[i] = (rgb[0] * 30 + rgb[1] * 59 + rgb[2] * 11) / 100;
+  }
+  return true;
+}
+
+// Reads LZW codes least significant bit first out of the image data sub-blocks
+class CodeReader {
+  Stream& in;
+  uint8_t block[255] = {};
+  uint8_t blockLength = 0;
+  uint8_t blockCursor = 0;
+  uint32_t bits = 0;
+  int bitCount = 0;
+  bool ended = false;
+
+ public:
+  explicit CodeReader(Stream& in) : in(in) {}
+
+  // Returns -1 once the sub-blocks run out
+  int read(const int codeSize) {
+    while (bitCount < codeSize) {
+      if (blockCursor >= blockLength) {
+        if (ended || !readExact(in, &blockLength, 1) || blockLength == 0) {
+          ended = true;
+          return -1;
+        }
+        // A truncated file still gives the codes that made it into the last block
+        const size_t blockRead = in.readBytes(block, blockLength);
+        if (blockRead < blockLength) {
+          ended = true;
+          blockLength = blockRead;
+        }
+        blockCursor = 0;
+      }
+      bits |= static_cast<uint32_t>(block[blockCursor++]) << bitCount;
+      bitCount += 8;
+    }
+    const int code = bits & ((1 << codeSize) - 1);
+    bits >>= codeSize;
+    bitCount -= codeSize;
+    return code;
+  }
+
+  // Consumes whatever is left of the image data, including the terminator
+  bool finish() {
+    if (ended) {
+      return true;
+    }
+    ended = true;
+    return skipSubBlocks(in);
+  }
+};
+}  // namespace
+
+bool GifToBmpConverter::gifStreamToBmpStream(Stream& gifStream, Print& bmpOut, const int maxWidth,
+                                             const int maxHeight) {
+  Serial.printf("[%lu] [GIF] Converting GIF to BMP\n", millis());
+  const auto start = millis();
+
+  // Header and logical screen descriptor
+  uint8_t header[13];
+  if (!readExact(gifStream, header, sizeof(header)) ||
+      (memcmp(header, "GIF87a", 6) != 0 && memcmp(header, "GIF89a", 6) != 0)) {
+    Serial.printf("[%lu] [GIF] Not a GIF file\n", millis());
+    return false;
+  }
+  int screenWidth = readLe16(header + 6);
+  int screenHeight = readLe16(header + 8);
+  const uint8_t screenFlags = header[10];
+
+  uint8_t palette[256];
+  memset(palette, 0, sizeof(palette));
+  if (screenFlags & 0x80 && !readColorTable(gifStream, 1 << ((screenFlags & 0x07) + 1), palette)) {
+    Serial.printf("[%lu] [GIF] Failed to read global color table\n", millis());
+    return false;
+  }
+
+  // Walk the blocks up to the first image, remembering its transparent index
+  int transparentIndex = -1;
+  uint8_t descriptor[9];
+  while (true) {
+    uint8_t introducer;
+    if (!readExact(gifStream, &introducer, 1) || introducer == 0x3B) {
+      Serial.printf("[%lu] [GIF] No image found\n", millis());
+      return false;
+    }
+
+    if (introducer == 0x2C) {
+      if (!readExact(gifStream, descriptor, sizeof(descriptor))) {
+        Serial.printf("[%lu] [GIF] Truncated image descriptor\n", millis());
+        return false;
+      }
+      break;
+    }
+
+    if (introducer != 0x21) {
+      Serial.printf("[%lu] [GIF] Unexpected block 0x%02X\n", millis(), introducer);
+      return false;
+    }
+
+    uint8_t label;
+    if (!readExact(gifStream, &label, 1)) {
+      return false;
+    }
+    if (label == 0xF9) {
+      // Graphic control extension
+      uint8_t control[6];
+      if (!readExact(gifStream, control, sizeof(control))) {
+        return false;
+      }
+      transparentIndex = control[1] & 0x01 ? control[4] : -1;
+      if (control[5] != 0 && !skipSubBlocks(gifStream)) {
+        return false;
+      }
+    } else if (!skipSubBlocks(gifStream)) {
+      return false;
+    }
+  }
+
+  const int frameLeft = readLe16(descriptor);
+  const int frameTop = readLe16(descriptor + 2);
+  const int frameWidth = readLe16(descriptor + 4);
+  const int frameHeight = readLe16(descriptor + 6);
+  const uint8_t frameFlags = descriptor[8];
+  if (screenWidth == 0 || screenHeight == 0) {
+    screenWidth = frameLeft + frameWidth;
+    screenHeight = frameTop + frameHeight;
+  }
+  Serial.printf("[%lu] [GIF] GIF dimensions: %dx%d, frame %dx%d at %d,%d\n", millis(), screenWidth, screenHeight,
+                frameWidth, frameHeight, frameLeft, frameTop);
+
+  if (frameWidth == 0 || frameHeight == 0) {
+    Serial.printf("[%lu] [GIF] Empty frame\n", millis());
+    return false;
+  }
+  if (frameFlags & 0x40) {
+    Serial.printf("[%lu] [GIF] Interlaced GIFs are not supported\n", millis());
+    return false;
+  }
+  if (frameFlags & 0x80 && !readColorTable(gifStream, 1 << ((frameFlags & 0x07) + 1), palette)) {
+    Serial.printf("[%lu] [GIF] Failed to read local color table\n", millis());
+    return false;
+  }
+  if (transparentIndex >= 0) {
+    palette[transparentIndex] = 255;
+  }
+
+  uint8_t minCodeSize;
+  if (!readExact(gifStream, &minCodeSize, 1) || minCodeSize < 2 || minCodeSize > 8) {
+    Serial.printf("[%lu] [GIF] Invalid LZW code size\n", millis());
+    return false;
+  }
+
+  DitheredBmpWriter writer(bmpOut, screenWidth, screenHeight, maxWidth, maxHeight);
+
+  // LZW table as prefix/suffix pairs plus a stack to unwind one string, and one screen row of luminance
+  auto* prefix = static_cast<uint16_t*>(malloc(MAX_LZW_CODES * sizeof(uint16_t)));
+  auto* suffix = static_cast<uint8_t*>(malloc(MAX_LZW_CODES));
+  auto* stack = static_cast<uint8_t*>(malloc(MAX_LZW_CODES));
+  auto* row = static_cast<uint8_t*>(malloc(screenWidth));
+  if (!prefix || !suffix || !stack || !row) {
+    Serial.printf("[%lu] [GIF] Failed to allocate LZW buffers\n", millis());
+    free(prefix);
+    free(suffix);
+    free(stack);
+    free(row);
+    return false;
+  }
+  if (!writer.begin()) {
+    free(prefix);
+    free(suffix);
+    free(stack);
+    free(row);
+    return false;
+  }
+
+  // Rows above the frame show the (white) background
+  int screenRow = 0;
+  memset(row, 255, screenWidth);
+  for (; screenRow < frameTop && screenRow < screenHeight; screenRow++) {
+    writer.writeRow(row);
+  }
+
+  const int clearCode = 1 << minCodeSize;
+  const int endCode = clearCode + 1;
+  for (int i = 0; i < clearCode; i++) {
+    prefix[i] = 0;
+    suffix[i] = i;
+  }
+  int codeSize = minCodeSize + 1;
+  int nextCode = clearCode + 2;
+  int previousCode = -1;
+  uint8_t firstChar = 0;
+  int frameX = 0;
+  int frameY = 0;
+  bool failed = false;
+
+  CodeReader codes(gifStream);
+  while (frameY < frameHeight) {
+    const int code = codes.read(codeSize);
+    if (code < 0 || code == endCode) {
+      break;
+    }
+
+    if (code == clearCode) {
+      codeSize = minCodeSize + 1;
+      nextCode = clearCode + 2;
+      previousCode = -1;
+      continue;
+    }
+
+    // Unwind the string for this code onto the stack, last pixel first
+    int stackSize = 0;
+    int walk = code;
+    if (previousCode < 0) {
+      if (code >= clearCode) {
+        failed = true;
+        break;
+      }
+    } else if (code == nextCode) {
+      // The string isn't in the table yet, it's the previous string plus its own first character
+      stack[stackSize++] = firstChar;
+      walk = previousCode;
+    } else if (code > nextCode) {
+      failed = true;
+      break;
+    }
+    while (walk >= clearCode && stackSize < MAX_LZW_CODES - 1) {
+      stack[stackSize++] = suffix[walk];
+      walk = prefix[walk];
+    }
+    stack[stackSize++] = walk;
+    firstChar = walk;
+
+    if (previousCode >= 0 && nextCode < MAX_LZW_CODES) {
+      prefix[nextCode] = previousCode;
+      suffix[nextCode] = firstChar;
+      nextCode++;
+      if (nextCode == 1 << codeSize && codeSize < MAX_LZW_BITS) {
+        codeSize++;
+      }
+    }
+    previousCode = code;
+
+    while (stackSize > 0 && frameY < frameHeight) {
+      const int screenX = frameLeft + frameX;
+      const uint8_t index = stack[--stackSize];
+      if (screenX < screenWidth) {
+        row[screenX] = palette[index];
+      }
+      if (++frameX == frameWidth) {
+        if (screenRow < screenHeight) {
+          writer.writeRow(row);
+          screenRow++;
+        }
+        memset(row, 255, screenWidth);
+        frameX = 0;
+        frameY++;
+      }
+    }
+  }
+  codes.finish();
+
+  // Anything the frame didn't cover (or a truncated frame) is left as background
+  memset(row, 255, screenWidth);
+  for (; screenRow < screenHeight; screenRow++) {
+    writer.writeRow(row);
+  }
+
+  free(prefix);
+  free(suffix);
+  free(stack);
+  free(row);
+
+  if (failed) {
+    Serial.printf("[%lu] [GIF] Invalid LZW code at row %d\n", millis(), frameY);
+    return false;
+  }
+  if (frameY < frameHeight) {
+    Serial.printf("[%lu] [GIF] Image data ended early at row %d of %d\n", millis(), frameY, frameHeight);
+  }
+
+  Serial.printf("[%lu] [GIF] Successfully converted GIF to %dx%d BMP in %lums\n", millis(), writer.getOutWidth(),
+                writer.getOutHeight(), millis() - start);
+  return true;
+}
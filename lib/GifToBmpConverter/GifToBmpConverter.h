@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Print.h>
+#include <Stream.h>
+
+class GifToBmpConverter {
+ public:
+  // Decodes the first frame one row at a time using a 4096 entry LZW table. Interlaced frames are not supported as
+  // they can't be written out row by row.
+  static bool gifStreamToBmpStream(Stream& gifStream, Print& bmpOut, int maxWidth, int maxHeight);
+};
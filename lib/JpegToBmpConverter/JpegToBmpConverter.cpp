@@ -1,5 +1,6 @@
 #include "JpegToBmpConverter.h"
 
+#include <DitheredBmpWriter.h>
 #include <picojpeg.h>
 
 #include <cstdio>
@@ -7,96 +8,24 @@
 
 // Context structure for picojpeg callback
 struct JpegReadContext {
-  File& file;
+  Stream& source;
   uint8_t buffer[512];
   size_t bufferPos;
   size_t bufferFilled;
 };
 
-// Helper function: Convert 8-bit grayscale to 2-bit (0-3)
-uint8_t JpegToBmpConverter::grayscaleTo2Bit(const uint8_t grayscale) {
-  // Simple threshold mapping:
-  // 0-63 -> 0 (black)
-  // 64-127 -> 1 (dark gray)
-  // 128-191 -> 2 (light gray)
-  // 192-255 -> 3 (white)
-  return grayscale >> 6;
-}
-
-inline void write16(Print& out, const uint16_t value) {
-  // out.write(reinterpret_cast<const uint8_t *>(&value), 2);
-  out.write(value & 0xFF);
-  out.write((value >> 8) & 0xFF);
-}
-
-inline void write32(Print& out, const uint32_t value) {
-  // out.write(reinterpret_cast<const uint8_t *>(&value), 4);
-  out.write(value & 0xFF);
-  out.write((value >> 8) & 0xFF);
-  out.write((value >> 16) & 0xFF);
-  out.write((value >> 24) & 0xFF);
-}
-
-inline void write32Signed(Print& out, const int32_t value) {
-  // out.write(reinterpret_cast<const uint8_t *>(&value), 4);
-  out.write(value & 0xFF);
-  out.write((value >> 8) & 0xFF);
-  out.write((value >> 16) & 0xFF);
-  out.write((value >> 24) & 0xFF);
-}
-
-// Helper function: Write BMP header with 2-bit color depth
-void JpegToBmpConverter::writeBmpHeader(Print& bmpOut, const int width, const int height) {
-  // Calculate row padding (each row must be multiple of 4 bytes)
-  const int bytesPerRow = (width * 2 + 31) / 32 * 4;  // 2 bits per pixel, round up
-  const int imageSize = bytesPerRow * height;
-  const uint32_t fileSize = 70 + imageSize;  // 14 (file header) + 40 (DIB header) + 16 (palette) + image
-
-  // BMP File Header (14 bytes)
-  bmpOut.write('B');
-  bmpOut.write('M');
-  write32(bmpOut, fileSize);  // File size
-  write32(bmpOut, 0);         // Reserved
-  write32(bmpOut, 70);        // Offset to pixel data
-
-  // DIB Header (BITMAPINFOHEADER - 40 bytes)
-  write32(bmpOut, 40);
-  write32Signed(bmpOut, width);
-  write32Signed(bmpOut, -height);  // Negative height = top-down bitmap
-  write16(bmpOut, 1);              // Color planes
-  write16(bmpOut, 2);              // Bits per pixel (2 bits)
-  write32(bmpOut, 0);              // BI_RGB (no compression)
-  write32(bmpOut, imageSize);
-  write32(bmpOut, 2835);  // xPixelsPerMeter (72 DPI)
-  write32(bmpOut, 2835);  // yPixelsPerMeter (72 DPI)
-  write32(bmpOut, 4);     // colorsUsed
-  write32(bmpOut, 4);     // colorsImportant
-
-  // Color Palette (4 colors x 4 bytes = 16 bytes)
-  // Format: Blue, Green, Red, Reserved (BGRA)
-  uint8_t palette[16] = {
-      0x00, 0x00, 0x00, 0x00,  // Color 0: Black
-      0x55, 0x55, 0x55, 0x00,  // Color 1: Dark gray (85)
-      0xAA, 0xAA, 0xAA, 0x00,  // Color 2: Light gray (170)
-      0xFF, 0xFF, 0xFF, 0x00   // Color 3: White
-  };
-  for (const uint8_t i : palette) {
-    bmpOut.write(i);
-  }
-}
-
 // Callback function for picojpeg to read JPEG data
 unsigned char JpegToBmpConverter::jpegReadCallback(unsigned char* pBuf, const unsigned char buf_size,
                                                    unsigned char* pBytes_actually_read, void* pCallback_data) {
   auto* context = static_cast<JpegReadContext*>(pCallback_data);
 
-  if (!context || !context->file) {
+  if (!context) {
     return PJPG_STREAM_READ_ERROR;
   }
 
   // Check if we need to refill our context buffer
   if (context->bufferPos >= context->bufferFilled) {
-    context->bufferFilled = context->file.read(context->buffer, sizeof(context->buffer));
+    context->bufferFilled = context->source.readBytes(context->buffer, sizeof(context->buffer));
     context->bufferPos = 0;
 
     if (context->bufferFilled == 0) {
@@ -118,15 +47,89 @@ unsigned char JpegToBmpConverter::jpegReadCallback(unsigned char* pBuf, const un
 }
 
 // Core function: Convert JPEG file to 2-bit BMP
-bool JpegToBmpConverter::jpegFileToBmpStream(File& jpegFile, Print& bmpOut) {
-  Serial.printf("[%lu] [JPG] Converting JPEG to BMP\n", millis());
+bool JpegToBmpConverter::jpegFileToBmpStream(Stream& jpegStream, Print& bmpOut) {
+  return jpegFileToBmpStream(jpegStream, bmpOut, 0, 0);
+}
+
+bool JpegToBmpConverter::jpegFileToBmpStream(Stream& jpegStream, Print& bmpOut, const int maxWidth,
+                                             const int maxHeight) {
+  return convert(jpegStream, bmpOut, maxWidth, maxHeight, false);
+}
+
+bool JpegToBmpConverter::jpegFileToThumbnailBmpStream(Stream& jpegStream, Print& bmpOut, const int maxWidth,
+                                                      const int maxHeight) {
+  return convert(jpegStream, bmpOut, maxWidth, maxHeight, true);
+}
+
+bool JpegToBmpConverter::readJpegSize(Stream& jpegStream, int* width, int* height) {
+  if (jpegStream.read() != 0xFF || jpegStream.read() != 0xD8) {
+    return false;
+  }
+
+  while (true) {
+    // Markers can be padded with any number of 0xFF bytes
+    int marker = jpegStream.read();
+    if (marker != 0xFF) {
+      return false;
+    }
+    while (marker == 0xFF) {
+      marker = jpegStream.read();
+    }
+    if (marker < 0 || marker == 0xD9 || marker == 0xDA) {
+      // End of image or start of scan without a frame header
+      return false;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      // No length field
+      continue;
+    }
+
+    const int lengthHigh = jpegStream.read();
+    const int lengthLow = jpegStream.read();
+    if (lengthHigh < 0 || lengthLow < 0) {
+      return false;
+    }
+    const int length = lengthHigh << 8 | lengthLow;
+    if (length < 2) {
+      return false;
+    }
+
+    // SOF0-SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      uint8_t frame[5];
+      if (length < 2 + sizeof(frame) || jpegStream.readBytes(frame, sizeof(frame)) != sizeof(frame)) {
+        return false;
+      }
+      *height = frame[1] << 8 | frame[2];
+      *width = frame[3] << 8 | frame[4];
+      return *width > 0 && *height > 0;
+    }
+
+    for (int i = 0; i < length - 2; i++) {
+      if (jpegStream.read() < 0) {
+        return false;
+      }
+    }
+  }
+}
+
+bool JpegToBmpConverter::thumbnailDecodeFills(const int width, const int height, const int maxWidth,
+                                              const int maxHeight) {
+  // The fit scale is at most 1/8 once either constrained side is 8 times the box
+  return (maxWidth > 0 && width >= maxWidth * 8) || (maxHeight > 0 && height >= maxHeight * 8);
+}
+
+bool JpegToBmpConverter::convert(Stream& jpegStream, Print& bmpOut, const int maxWidth, const int maxHeight,
+                                 const bool reduced) {
+  Serial.printf("[%lu] [JPG] Converting JPEG to BMP%s\n", millis(), reduced ? " (DC only)" : "");
+  const auto start = millis();
 
   // Setup context for picojpeg callback
-  JpegReadContext context = {.file = jpegFile, .bufferPos = 0, .bufferFilled = 0};
+  JpegReadContext context = {.source = jpegStream, .bufferPos = 0, .bufferFilled = 0};
 
   // Initialize picojpeg decoder
   pjpeg_image_info_t imageInfo;
-  const unsigned char status = pjpeg_decode_init(&imageInfo, jpegReadCallback, &context, 0);
+  const unsigned char status = pjpeg_decode_init(&imageInfo, jpegReadCallback, &context, reduced ? 1 : 0);
   if (status != 0) {
     Serial.printf("[%lu] [JPG] JPEG decode init failed with error code: %d\n", millis(), status);
     return false;
@@ -135,32 +138,28 @@ bool JpegToBmpConverter::jpegFileToBmpStream(File& jpegFile, Print& bmpOut) {
   Serial.printf("[%lu] [JPG] JPEG dimensions: %dx%d, components: %d, MCUs: %dx%d\n", millis(), imageInfo.m_width,
                 imageInfo.m_height, imageInfo.m_comps, imageInfo.m_MCUSPerRow, imageInfo.m_MCUSPerCol);
 
-  // Write BMP header
-  writeBmpHeader(bmpOut, imageInfo.m_width, imageInfo.m_height);
-
-  // Calculate row parameters
-  const int bytesPerRow = (imageInfo.m_width * 2 + 31) / 32 * 4;
+  // In reduced mode each 8x8 block decodes to a single pixel
+  const int blockScale = reduced ? 8 : 1;
+  const int srcWidth = (imageInfo.m_width + blockScale - 1) / blockScale;
+  const int srcHeight = (imageInfo.m_height + blockScale - 1) / blockScale;
 
-  // Allocate row buffer for packed 2-bit pixels
-  auto* rowBuffer = static_cast<uint8_t*>(malloc(bytesPerRow));
-  if (!rowBuffer) {
-    Serial.printf("[%lu] [JPG] Failed to allocate row buffer\n", millis());
+  DitheredBmpWriter writer(bmpOut, srcWidth, srcHeight, maxWidth, maxHeight);
+  if (!writer.begin()) {
     return false;
   }
 
   // Allocate a buffer for one MCU row worth of grayscale pixels
   // This is the minimal memory needed for streaming conversion
-  const int mcuPixelHeight = imageInfo.m_MCUHeight;
-  const int mcuRowPixels = imageInfo.m_width * mcuPixelHeight;
+  const int mcuPixelHeight = imageInfo.m_MCUHeight / blockScale;
+  const int mcuRowPixels = srcWidth * mcuPixelHeight;
   auto* mcuRowBuffer = static_cast<uint8_t*>(malloc(mcuRowPixels));
   if (!mcuRowBuffer) {
     Serial.printf("[%lu] [JPG] Failed to allocate MCU row buffer\n", millis());
-    free(rowBuffer);
     return false;
   }
 
   // Process MCUs row-by-row and write to BMP as we go (top-down)
-  const int mcuPixelWidth = imageInfo.m_MCUWidth;
+  const int mcuPixelWidth = imageInfo.m_MCUWidth / blockScale;
 
   for (int mcuY = 0; mcuY < imageInfo.m_MCUSPerCol; mcuY++) {
     // Clear the MCU row buffer
@@ -177,7 +176,6 @@ bool JpegToBmpConverter::jpegFileToBmpStream(File& jpegFile, Print& bmpOut) {
                         mcuStatus);
         }
         free(mcuRowBuffer);
-        free(rowBuffer);
         return false;
       }
 
@@ -190,19 +188,22 @@ bool JpegToBmpConverter::jpegFileToBmpStream(File& jpegFile, Print& bmpOut) {
           const int pixelX = mcuX * mcuPixelWidth + blockX;
 
           // Skip pixels outside image width (can happen with MCU alignment)
-          if (pixelX >= imageInfo.m_width) {
+          if (pixelX >= srcWidth) {
             continue;
           }
 
           // Calculate which 8x8 block and position within that block
-          const int block8x8Col = blockX / 8;  // 0 or 1 for 16-wide MCU
-          const int block8x8Row = blockY / 8;  // 0 or 1 for 16-tall MCU
-          const int pixelInBlockX = blockX % 8;
-          const int pixelInBlockY = blockY % 8;
+          // In reduced mode only the first pixel of each block is populated
+          const int mcuX8 = blockX * blockScale;
+          const int mcuY8 = blockY * blockScale;
+          const int block8x8Col = mcuX8 / 8;  // 0 or 1 for 16-wide MCU
+          const int block8x8Row = mcuY8 / 8;  // 0 or 1 for 16-tall MCU
+          const int pixelInBlockX = mcuX8 % 8;
+          const int pixelInBlockY = mcuY8 % 8;
 
           // Calculate byte offset: each 8x8 block is 64 bytes
-          // Blocks are arranged: [0, 64], [128, 192]
-          const int blockOffset = (block8x8Row * (mcuPixelWidth / 8) + block8x8Col) * 64;
+          // Blocks are arranged: [0, 64], [128, 192] (H1V2 MCUs also place their second block at 128)
+          const int blockOffset = block8x8Row * 128 + block8x8Col * 64;
           const int mcuIndex = blockOffset + pixelInBlockY * 8 + pixelInBlockX;
 
           // Get grayscale value
@@ -221,38 +222,22 @@ bool JpegToBmpConverter::jpegFileToBmpStream(File& jpegFile, Print& bmpOut) {
           }
 
           // Store grayscale value in MCU row buffer
-          mcuRowBuffer[blockY * imageInfo.m_width + pixelX] = gray;
+          mcuRowBuffer[blockY * srcWidth + pixelX] = gray;
         }
       }
     }
 
-    // Write all pixel rows from this MCU row to BMP file
+    // Feed every pixel row of this MCU row to the writer
     const int startRow = mcuY * mcuPixelHeight;
-    const int endRow = (mcuY + 1) * mcuPixelHeight;
-
-    for (int y = startRow; y < endRow && y < imageInfo.m_height; y++) {
-      memset(rowBuffer, 0, bytesPerRow);
-
-      // Pack 4 pixels per byte (2 bits each)
-      for (int x = 0; x < imageInfo.m_width; x++) {
-        const int bufferY = y - startRow;
-        const uint8_t gray = mcuRowBuffer[bufferY * imageInfo.m_width + x];
-        const uint8_t twoBit = grayscaleTo2Bit(gray);
-
-        const int byteIndex = (x * 2) / 8;
-        const int bitOffset = 6 - ((x * 2) % 8);  // 6, 4, 2, 0
-        rowBuffer[byteIndex] |= (twoBit << bitOffset);
-      }
-
-      // Write row with padding
-      bmpOut.write(rowBuffer, bytesPerRow);
+    for (int y = startRow; y < startRow + mcuPixelHeight && y < srcHeight; y++) {
+      writer.writeRow(mcuRowBuffer + (y - startRow) * srcWidth);
     }
   }
 
   // Clean up
   free(mcuRowBuffer);
-  free(rowBuffer);
 
-  Serial.printf("[%lu] [JPG] Successfully converted JPEG to BMP\n", millis());
+  Serial.printf("[%lu] [JPG] Successfully converted JPEG to %dx%d BMP in %lums\n", millis(), writer.getOutWidth(),
+                writer.getOutHeight(), millis() - start);
   return true;
 }
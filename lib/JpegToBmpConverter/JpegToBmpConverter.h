@@ -2,14 +2,19 @@
 
 #include <FS.h>
 
-class ZipFile;
-
 class JpegToBmpConverter {
-  static void writeBmpHeader(Print& bmpOut, int width, int height);
-  static uint8_t grayscaleTo2Bit(uint8_t grayscale);
   static unsigned char jpegReadCallback(unsigned char* pBuf, unsigned char buf_size,
                                         unsigned char* pBytes_actually_read, void* pCallback_data);
+  static bool convert(Stream& jpegStream, Print& bmpOut, int maxWidth, int maxHeight, bool reduced);
 
  public:
-  static bool jpegFileToBmpStream(File& jpegFile, Print& bmpOut);
+  static bool jpegFileToBmpStream(Stream& jpegStream, Print& bmpOut);
+  // Scales the image down to fit within maxWidth x maxHeight while decoding, 0 leaves that dimension unconstrained
+  static bool jpegFileToBmpStream(Stream& jpegStream, Print& bmpOut, int maxWidth, int maxHeight);
+  // Decodes only the DC coefficient of each 8x8 block, giving a 1/8 scale image much faster than a full decode
+  static bool jpegFileToThumbnailBmpStream(Stream& jpegStream, Print& bmpOut, int maxWidth, int maxHeight);
+  // Reads the frame size from the header, consuming the stream up to the end of the SOF segment
+  static bool readJpegSize(Stream& jpegStream, int* width, int* height);
+  // Whether the 1/8 scale thumbnail decode is still at least as big as the image fit within maxWidth x maxHeight
+  static bool thumbnailDecodeFills(int width, int height, int maxWidth, int maxHeight);
 };
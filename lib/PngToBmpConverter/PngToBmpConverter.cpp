@@ -0,0 +1,396 @@
+#include "PngToBmpConverter.h"
+
+#include <Arduino.h>
+#include <DitheredBmpWriter.h>
+#include <HardwareSerial.h>
+#include <miniz.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr uint8_t PNG_SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+constexpr size_t INPUT_CHUNK_SIZE = 1024;
+// Inflate state (about 11KB), window and input chunk, allocated at the first IDAT
+constexpr size_t INFLATE_HEAP = sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE + INPUT_CHUNK_SIZE;
+// Left free after inflating starts, for the SD card and whatever the caller has open
+constexpr size_t HEAP_HEADROOM = 16 * 1024;
+
+enum PngColorType : uint8_t { GRAY = 0, RGB = 2, PALETTE = 3, GRAY_ALPHA = 4, RGBA = 6 };
+
+bool readExact(Stream& in, uint8_t* buffer, const size_t length) { return in.readBytes(buffer, length) == length; }
+
+bool readU32(Stream& in, uint32_t* value) {
+  uint8_t bytes[4];
+  if (!readExact(in, bytes, 4)) {
+    return false;
+  }
+  *value = bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3];
+  return true;
+}
+
+bool skipBytes(Stream& in, size_t length) {
+  uint8_t scratch[64];
+  while (length > 0) {
+    const size_t toRead = length < sizeof(scratch) ? length : sizeof(scratch);
+    if (!readExact(in, scratch, toRead)) {
+      return false;
+    }
+    length -= toRead;
+  }
+  return true;
+}
+
+uint8_t luminance(const uint8_t r, const uint8_t g, const uint8_t b) { return (r * 30 + g * 59 + b * 11) / 100; }
+
+// Blends onto a white background, e-ink has no transparency
+uint8_t overWhite(const uint8_t gray, const uint8_t alpha) { return (gray * alpha + 255 * (255 - alpha)) / 255; }
+
+// Reassembles inflated bytes into scanlines, reverses the PNG filters against the previous scanline and hands each row
+// to the BMP writer as luminance
+class ScanlineDecoder {
+  DitheredBmpWriter& writer;
+  int width;
+  int height;
+  uint8_t bitDepth;
+  uint8_t colorType;
+  int channels;
+  int filterStride;
+  size_t scanlineBytes;
+  // Both hold the filter type byte followed by the scanline
+  uint8_t* current = nullptr;
+  uint8_t* previous = nullptr;
+  uint8_t* luminanceRow = nullptr;
+  size_t cursor = 0;
+  int rowsDone = 0;
+
+  uint16_t sample(const uint8_t* row, const int index) const {
+    if (bitDepth == 8) {
+      return row[index];
+    }
+    if (bitDepth == 16) {
+      return row[index * 2] << 8 | row[index * 2 + 1];
+    }
+    const int bitOffset = index * bitDepth;
+    return (row[bitOffset / 8] >> (8 - bitDepth - bitOffset % 8)) & ((1 << bitDepth) - 1);
+  }
+
+  uint8_t sampleTo8(const uint16_t value) const {
+    if (bitDepth == 16) {
+      return value >> 8;
+    }
+    return value * 255 / ((1 << bitDepth) - 1);
+  }
+
+  void unfilter() const {
+    uint8_t* row = current + 1;
+    const uint8_t* prior = previous + 1;
+    switch (current[0]) {
+      case 1:  // Sub
+        for (size_t i = filterStride; i < scanlineBytes; i++) {
+          row[i] += row[i - filterStride];
+        }
+        break;
+      case 2:  // Up
+        for (size_t i = 0; i < scanlineBytes; i++) {
+          row[i] += prior[i];
+        }
+        break;
+      case 3:  // Average
+        for (size_t i = 0; i < scanlineBytes; i++) {
+          const int left = i >= static_cast<size_t>(filterStride) ? row[i - filterStride] : 0;
+          row[i] += (left + prior[i]) / 2;
+        }
+        break;
+      case 4:  // Paeth
+        for (size_t i = 0; i < scanlineBytes; i++) {
+          const bool hasLeft = i >= static_cast<size_t>(filterStride);
+          const int a = hasLeft ? row[i - filterStride] : 0;
+          const int b = prior[i];
+          const int c = hasLeft ? prior[i - filterStride] : 0;
+          const int p = a + b - c;
+          const int pa = abs(p - a);
+          const int pb = abs(p - b);
+          const int pc = abs(p - c);
+          row[i] += pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+        }
+        break;
+      default:  // None
+        break;
+    }
+  }
+
+  void convertRow() const {
+    const uint8_t* row = current + 1;
+    for (int x = 0; x < width; x++) {
+      const int base = x * channels;
+      uint8_t gray;
+      switch (colorType) {
+        case GRAY: {
+          const uint16_t value = sample(row, base);
+          gray = hasTransparentKey && value == transparentKey[0] ? 255 : sampleTo8(value);
+          break;
+        }
+        case RGB: {
+          const uint16_t r = sample(row, base);
+          const uint16_t g = sample(row, base + 1);
+          const uint16_t b = sample(row, base + 2);
+          const bool transparent =
+              hasTransparentKey && r == transparentKey[0] && g == transparentKey[1] && b == transparentKey[2];
+          gray = transparent ? 255 : luminance(sampleTo8(r), sampleTo8(g), sampleTo8(b));
+          break;
+        }
+        case PALETTE: {
+          const uint16_t index = sample(row, base);
+          gray = overWhite(paletteGray[index], paletteAlpha[index]);
+          break;
+        }
+        case GRAY_ALPHA:
+          gray = overWhite(sampleTo8(sample(row, base)), sampleTo8(sample(row, base + 1)));
+          break;
+        default:  // RGBA
+          gray = overWhite(
+              luminance(sampleTo8(sample(row, base)), sampleTo8(sample(row, base + 1)), sampleTo8(sample(row, base + 2))),
+              sampleTo8(sample(row, base + 3)));
+          break;
+      }
+      luminanceRow[x] = gray;
+    }
+  }
+
+ public:
+  uint8_t paletteGray[256] = {};
+  uint8_t paletteAlpha[256];
+  uint16_t transparentKey[3] = {};
+  bool hasTransparentKey = false;
+
+  ScanlineDecoder(DitheredBmpWriter& writer, const int width, const int height, const uint8_t bitDepth,
+                  const uint8_t colorType)
+      : writer(writer), width(width), height(height), bitDepth(bitDepth), colorType(colorType) {
+    channels = colorType == RGB ? 3 : colorType == GRAY_ALPHA ? 2 : colorType == RGBA ? 4 : 1;
+    const int bitsPerPixel = channels * bitDepth;
+    filterStride = bitsPerPixel < 8 ? 1 : bitsPerPixel / 8;
+    scanlineBytes = (static_cast<size_t>(width) * bitsPerPixel + 7) / 8;
+    memset(paletteAlpha, 255, sizeof(paletteAlpha));
+  }
+
+  ~ScanlineDecoder() {
+    free(current);
+    free(previous);
+    free(luminanceRow);
+  }
+
+  bool allocate() {
+    current = static_cast<uint8_t*>(malloc(scanlineBytes + 1));
+    previous = static_cast<uint8_t*>(calloc(scanlineBytes + 1, 1));
+    luminanceRow = static_cast<uint8_t*>(malloc(width));
+    return current && previous && luminanceRow;
+  }
+
+  void consume(const uint8_t* data, size_t length) {
+    while (length > 0 && rowsDone < height) {
+      const size_t toCopy = length < scanlineBytes + 1 - cursor ? length : scanlineBytes + 1 - cursor;
+      memcpy(current + cursor, data, toCopy);
+      cursor += toCopy;
+      data += toCopy;
+      length -= toCopy;
+
+      if (cursor == scanlineBytes + 1) {
+        unfilter();
+        convertRow();
+        writer.writeRow(luminanceRow);
+        uint8_t* swap = previous;
+        previous = current;
+        current = swap;
+        cursor = 0;
+        rowsDone++;
+      }
+    }
+  }
+
+  bool isComplete() const { return rowsDone == height; }
+  int getRowsDone() const { return rowsDone; }
+  size_t getScanlineBytes() const { return scanlineBytes; }
+};
+}  // namespace
+
+bool PngToBmpConverter::pngStreamToBmpStream(Stream& pngStream, Print& bmpOut, const int maxWidth,
+                                             const int maxHeight) {
+  Serial.printf("[%lu] [PNG] Converting PNG to BMP\n", millis());
+  const auto start = millis();
+
+  uint8_t signature[8];
+  if (!readExact(pngStream, signature, sizeof(signature)) || memcmp(signature, PNG_SIGNATURE, 8) != 0) {
+    Serial.printf("[%lu] [PNG] Not a PNG file\n", millis());
+    return false;
+  }
+
+  // IHDR must be the first chunk
+  uint32_t chunkLength;
+  uint8_t chunkType[4];
+  uint8_t ihdr[13];
+  if (!readU32(pngStream, &chunkLength) || !readExact(pngStream, chunkType, 4) || chunkLength != 13 ||
+      memcmp(chunkType, "IHDR", 4) != 0 || !readExact(pngStream, ihdr, 13) || !skipBytes(pngStream, 4)) {
+    Serial.printf("[%lu] [PNG] Missing IHDR chunk\n", millis());
+    return false;
+  }
+
+  const int width = ihdr[0] << 24 | ihdr[1] << 16 | ihdr[2] << 8 | ihdr[3];
+  const int height = ihdr[4] << 24 | ihdr[5] << 16 | ihdr[6] << 8 | ihdr[7];
+  const uint8_t bitDepth = ihdr[8];
+  const uint8_t colorType = ihdr[9];
+  const uint8_t interlace = ihdr[12];
+  Serial.printf("[%lu] [PNG] PNG dimensions: %dx%d, bit depth: %d, color type: %d\n", millis(), width, height,
+                bitDepth, colorType);
+
+  const bool validDepth =
+      (colorType == GRAY && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16)) ||
+      (colorType == PALETTE && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8)) ||
+      ((colorType == RGB || colorType == GRAY_ALPHA || colorType == RGBA) && (bitDepth == 8 || bitDepth == 16));
+  if (width <= 0 || height <= 0 || !validDepth) {
+    Serial.printf("[%lu] [PNG] Unsupported PNG format\n", millis());
+    return false;
+  }
+  if (interlace != 0) {
+    Serial.printf("[%lu] [PNG] Interlaced PNGs are not supported\n", millis());
+    return false;
+  }
+
+  DitheredBmpWriter writer(bmpOut, width, height, maxWidth, maxHeight);
+  ScanlineDecoder decoder(writer, width, height, bitDepth, colorType);
+  if (!decoder.allocate()) {
+    Serial.printf("[%lu] [PNG] Failed to allocate scanline buffers\n", millis());
+    return false;
+  }
+  if (!writer.begin()) {
+    return false;
+  }
+
+  tinfl_decompressor* inflator = nullptr;
+  uint8_t* dictionary = nullptr;
+  uint8_t* inputBuffer = nullptr;
+  size_t dictionaryCursor = 0;
+  bool inflateDone = false;
+  bool failed = false;
+
+  while (!failed && !inflateDone) {
+    if (!readU32(pngStream, &chunkLength) || !readExact(pngStream, chunkType, 4)) {
+      Serial.printf("[%lu] [PNG] Unexpected end of file\n", millis());
+      failed = true;
+      break;
+    }
+
+    if (memcmp(chunkType, "IEND", 4) == 0) {
+      break;
+    }
+
+    if (memcmp(chunkType, "PLTE", 4) == 0 && chunkLength <= 768 && chunkLength % 3 == 0) {
+      for (uint32_t i = 0; i < chunkLength / 3; i++) {
+        uint8_t rgb[3];
+        if (!readExact(pngStream, rgb, 3)) {
+          Serial.printf("[%lu] [PNG] Truncated PLTE chunk\n", millis());
+          failed = true;
+          break;
+        }
+        decoder.paletteGray[i] = luminance(rgb[0], rgb[1], rgb[2]);
+      }
+    } else if (memcmp(chunkType, "tRNS", 4) == 0 && colorType == PALETTE && chunkLength <= 256) {
+      failed = !readExact(pngStream, decoder.paletteAlpha, chunkLength);
+    } else if (memcmp(chunkType, "tRNS", 4) == 0 && (colorType == GRAY || colorType == RGB) &&
+               chunkLength == (colorType == GRAY ? 2u : 6u)) {
+      uint8_t key[6];
+      failed = !readExact(pngStream, key, chunkLength);
+      for (uint32_t i = 0; i < chunkLength / 2; i++) {
+        decoder.transparentKey[i] = key[i * 2] << 8 | key[i * 2 + 1];
+      }
+      decoder.hasTransparentKey = true;
+    } else if (memcmp(chunkType, "IDAT", 4) == 0) {
+      if (!inflator) {
+        // A deflated ZIP entry stream has its own window open under this one, so check before taking another
+        if (ESP.getMaxAllocHeap() < TINFL_LZ_DICT_SIZE || ESP.getFreeHeap() < INFLATE_HEAP + HEAP_HEADROOM) {
+          Serial.printf("[%lu] [PNG] Not enough heap to inflate, free %d bytes, largest block %d bytes\n", millis(),
+                        ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+          failed = true;
+          break;
+        }
+        inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+        dictionary = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+        inputBuffer = static_cast<uint8_t*>(malloc(INPUT_CHUNK_SIZE));
+        if (!inflator || !dictionary || !inputBuffer) {
+          Serial.printf("[%lu] [PNG] Failed to allocate memory for inflator\n", millis());
+          failed = true;
+          break;
+        }
+        tinfl_init(inflator);
+      }
+
+      // IDAT chunks together form one zlib stream, inflate it as it arrives
+      uint32_t chunkRemaining = chunkLength;
+      while (chunkRemaining > 0 && !failed && !inflateDone) {
+        const size_t toRead = chunkRemaining < INPUT_CHUNK_SIZE ? chunkRemaining : INPUT_CHUNK_SIZE;
+        if (!readExact(pngStream, inputBuffer, toRead)) {
+          Serial.printf("[%lu] [PNG] Unexpected end of IDAT\n", millis());
+          failed = true;
+          break;
+        }
+        chunkRemaining -= toRead;
+
+        size_t inputCursor = 0;
+        while (true) {
+          size_t inBytes = toRead - inputCursor;
+          size_t outBytes = TINFL_LZ_DICT_SIZE - dictionaryCursor;
+          const tinfl_status status =
+              tinfl_decompress(inflator, inputBuffer + inputCursor, &inBytes, dictionary, dictionary + dictionaryCursor,
+                               &outBytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+          inputCursor += inBytes;
+
+          if (outBytes > 0) {
+            decoder.consume(dictionary + dictionaryCursor, outBytes);
+            // Update output position in buffer (with wraparound)
+            dictionaryCursor = (dictionaryCursor + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+          }
+
+          if (status < 0) {
+            Serial.printf("[%lu] [PNG] tinfl_decompress() failed with status %d\n", millis(), status);
+            failed = true;
+            break;
+          }
+          if (status == TINFL_STATUS_DONE) {
+            inflateDone = true;
+            break;
+          }
+          if (status == TINFL_STATUS_NEEDS_MORE_INPUT && inputCursor >= toRead) {
+            break;
+          }
+        }
+      }
+
+      // Only the unread part of the chunk is left when inflation finished early
+      if (!failed && chunkRemaining > 0) {
+        failed = !skipBytes(pngStream, chunkRemaining);
+      }
+    } else {
+      // Ancillary chunk, or an oversized one we don't understand
+      failed = !skipBytes(pngStream, chunkLength);
+    }
+
+    // Skip the CRC
+    if (!failed) {
+      failed = !skipBytes(pngStream, 4);
+    }
+  }
+
+  free(inflator);
+  free(dictionary);
+  free(inputBuffer);
+
+  if (failed || !decoder.isComplete()) {
+    Serial.printf("[%lu] [PNG] Failed to decode PNG, got %d of %d rows\n", millis(), decoder.getRowsDone(), height);
+    return false;
+  }
+
+  Serial.printf("[%lu] [PNG] Successfully converted PNG to %dx%d BMP in %lums (scanline %u bytes)\n", millis(),
+                writer.getOutWidth(), writer.getOutHeight(), millis() - start,
+                static_cast<unsigned>(decoder.getScanlineBytes()));
+  return true;
+}
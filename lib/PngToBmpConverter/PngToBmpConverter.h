@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Print.h>
+#include <Stream.h>
+
+class PngToBmpConverter {
+ public:
+  // Decodes one scanline at a time, keeping only the current and previous scanline plus the inflate state: about 44KB
+  // for the 11KB tinfl state, the 32KB window and a 1KB input chunk. Read from a deflated ZIP entry, the entry stream
+  // holds another set of those, so the peak is about 88KB plus the scanlines. Fails if the heap can't take it.
+  // Interlaced (Adam7) images are not supported as they can't be written out row by row.
+  static bool pngStreamToBmpStream(Stream& pngStream, Print& bmpOut, int maxWidth, int maxHeight);
+};
@@ -213,7 +213,12 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
         return false;
       }
 
-      out.write(buffer, dataRead);
+      if (out.write(buffer, dataRead) != dataRead) {
+        Serial.printf("[%lu] [ZIP] Failed to write all output bytes to stream\n", millis());
+        free(buffer);
+        fclose(file);
+        return false;
+      }
       remaining -= dataRead;
     }
 
@@ -336,3 +341,177 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
   Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
   return false;
 }
+
+bool ZipFile::EntryStream::open(const ZipFile& zip, const char* filename, const size_t chunkSize) {
+  close();
+
+  mz_zip_archive_file_stat fileStat;
+  if (!zip.loadFileStat(filename, &fileStat)) {
+    return false;
+  }
+
+  if (fileStat.m_method != MZ_NO_COMPRESSION && fileStat.m_method != MZ_DEFLATED) {
+    Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
+    return false;
+  }
+
+  const long fileOffset = zip.getDataOffset(fileStat);
+  if (fileOffset < 0) {
+    return false;
+  }
+
+  file = fopen(zip.filePath.c_str(), "rb");
+  if (!file) {
+    Serial.printf("[%lu] [ZIP] Failed to open file for streaming\n", millis());
+    return false;
+  }
+  fseek(file, fileOffset, SEEK_SET);
+
+  stored = fileStat.m_method == MZ_NO_COMPRESSION;
+  storedRemaining = static_cast<size_t>(fileStat.m_uncomp_size);
+  compressedRemaining = static_cast<size_t>(fileStat.m_comp_size);
+  finished = false;
+  if (stored) {
+    return true;
+  }
+
+  inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  inputBuffer = static_cast<uint8_t*>(malloc(chunkSize));
+  dictionary = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+  if (!inflator || !inputBuffer || !dictionary) {
+    Serial.printf("[%lu] [ZIP] Failed to allocate memory for entry stream\n", millis());
+    close();
+    return false;
+  }
+  memset(inflator, 0, sizeof(tinfl_decompressor));
+  tinfl_init(inflator);
+  inputBufferSize = chunkSize;
+  return true;
+}
+
+void ZipFile::EntryStream::close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+  free(inflator);
+  free(inputBuffer);
+  free(dictionary);
+  inflator = nullptr;
+  inputBuffer = nullptr;
+  dictionary = nullptr;
+  inputFilled = inputCursor = 0;
+  dictionaryCursor = pendingStart = pendingEnd = 0;
+  compressedRemaining = storedRemaining = 0;
+  finished = true;
+}
+
+// Inflates until at least one output byte is pending, returns false at the end of the entry or on error
+bool ZipFile::EntryStream::inflateMore() {
+  while (!finished) {
+    // Load more compressed bytes when needed
+    if (inputCursor >= inputFilled && compressedRemaining > 0) {
+      inputFilled =
+          fread(inputBuffer, 1, compressedRemaining < inputBufferSize ? compressedRemaining : inputBufferSize, file);
+      compressedRemaining -= inputFilled;
+      inputCursor = 0;
+
+      if (inputFilled == 0) {
+        Serial.printf("[%lu] [ZIP] Unexpected EOF\n", millis());
+        finished = true;
+        return false;
+      }
+    }
+
+    size_t inBytes = inputFilled - inputCursor;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - dictionaryCursor;
+    const tinfl_status status =
+        tinfl_decompress(inflator, inputBuffer + inputCursor, &inBytes, dictionary, dictionary + dictionaryCursor,
+                         &outBytes, compressedRemaining > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+    inputCursor += inBytes;
+
+    if (status < 0) {
+      Serial.printf("[%lu] [ZIP] tinfl_decompress() failed with status %d\n", millis(), status);
+      finished = true;
+      return false;
+    }
+    if (status == TINFL_STATUS_DONE) {
+      finished = true;
+    }
+
+    if (outBytes > 0) {
+      pendingStart = dictionaryCursor;
+      pendingEnd = dictionaryCursor + outBytes;
+      // Update output position in buffer (with wraparound)
+      dictionaryCursor = (dictionaryCursor + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+      return true;
+    }
+
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && compressedRemaining == 0 && inputCursor >= inputFilled) {
+      Serial.printf("[%lu] [ZIP] Unexpected EOF\n", millis());
+      finished = true;
+      return false;
+    }
+  }
+  return false;
+}
+
+size_t ZipFile::EntryStream::readBytes(char* buffer, const size_t length) {
+  if (!file) {
+    return 0;
+  }
+
+  if (stored) {
+    const size_t toRead = length < storedRemaining ? length : storedRemaining;
+    const size_t dataRead = fread(buffer, 1, toRead, file);
+    storedRemaining -= dataRead;
+    return dataRead;
+  }
+
+  size_t copied = 0;
+  while (copied < length) {
+    if (pendingStart >= pendingEnd && !inflateMore()) {
+      break;
+    }
+    const size_t available = pendingEnd - pendingStart;
+    const size_t toCopy = available < length - copied ? available : length - copied;
+    memcpy(buffer + copied, dictionary + pendingStart, toCopy);
+    pendingStart += toCopy;
+    copied += toCopy;
+  }
+  return copied;
+}
+
+int ZipFile::EntryStream::read() {
+  char c;
+  return readBytes(&c, 1) == 1 ? static_cast<uint8_t>(c) : -1;
+}
+
+int ZipFile::EntryStream::peek() {
+  if (!file) {
+    return -1;
+  }
+  if (stored) {
+    const int c = fgetc(file);
+    if (c == EOF) {
+      return -1;
+    }
+    ungetc(c, file);
+    return c;
+  }
+  if (pendingStart >= pendingEnd && !inflateMore()) {
+    return -1;
+  }
+  return dictionary[pendingStart];
+}
+
+int ZipFile::EntryStream::available() {
+  if (!file) {
+    return 0;
+  }
+  if (stored) {
+    return static_cast<int>(storedRemaining);
+  }
+  // The inflated size left isn't tracked exactly, report whether anything is left
+  return pendingStart < pendingEnd || !finished ? 1 : 0;
+}
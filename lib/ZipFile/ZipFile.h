@@ -1,10 +1,16 @@
 #pragma once
 #include <Print.h>
+#include <Stream.h>
 
 #include <string>
 
 #include "miniz.h"
 
+// Where stdio sees the SD card, ZipFile paths for files on the card start with this
+#ifndef SD_MOUNT_POINT
+#define SD_MOUNT_POINT "/sd"
+#endif
+
 class ZipFile {
   std::string filePath;
   mutable mz_zip_archive zipArchive = {};
@@ -12,6 +18,41 @@ class ZipFile {
   long getDataOffset(const mz_zip_archive_file_stat& fileStat) const;
 
  public:
+  // Reads a single entry sequentially, inflating only as many bytes as the caller asks for
+  class EntryStream final : public Stream {
+    FILE* file = nullptr;
+    tinfl_decompressor* inflator = nullptr;
+    uint8_t* inputBuffer = nullptr;
+    uint8_t* dictionary = nullptr;
+    size_t inputBufferSize = 0;
+    size_t inputFilled = 0;
+    size_t inputCursor = 0;
+    size_t compressedRemaining = 0;
+    size_t storedRemaining = 0;
+    // Inflated bytes in the dictionary not yet handed to the caller
+    size_t dictionaryCursor = 0;
+    size_t pendingStart = 0;
+    size_t pendingEnd = 0;
+    bool stored = false;
+    bool finished = false;
+
+    bool inflateMore();
+
+   public:
+    EntryStream() = default;
+    ~EntryStream() override { close(); }
+    EntryStream(const EntryStream&) = delete;
+    EntryStream& operator=(const EntryStream&) = delete;
+    bool open(const ZipFile& zip, const char* filename, size_t chunkSize);
+    void close();
+    size_t readBytes(char* buffer, size_t length) override;
+    int read() override;
+    int peek() override;
+    int available() override;
+    size_t write(uint8_t) override { return 0; }
+    explicit operator bool() const { return file != nullptr; }
+  };
+
   explicit ZipFile(std::string filePath);
   ~ZipFile() { mz_zip_reader_end(&zipArchive); }
   bool getInflatedFileSize(const char* filename, size_t* size) const;
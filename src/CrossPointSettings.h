@@ -24,6 +24,8 @@ class CrossPointSettings {
   uint8_t extraParagraphSpacing = 1;
   // Duration of the power button press
   uint8_t shortPwrBtn = 0;
+  // Pre-render the next page while the reader is idle
+  uint8_t pageLookahead = 1;
 
   ~CrossPointSettings() = default;
 
@@ -0,0 +1,149 @@
+#include "SleepImageIndex.h"
+
+#include <Bitmap.h>
+#include <FsHelpers.h>
+#include <HardwareSerial.h>
+#include <SD.h>
+#include <Serialization.h>
+
+namespace {
+constexpr uint8_t INDEX_FILE_VERSION = 3;
+constexpr char SLEEP_DIR[] = "/sleep";
+constexpr char INDEX_DIR[] = "/.crosspoint/sleep";
+constexpr char INDEX_FILE[] = "/.crosspoint/sleep/index.bin";
+}  // namespace
+
+bool SleepImageIndex::load() {
+  auto dir = SD.open(SLEEP_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    entries.clear();
+    return false;
+  }
+  const uint32_t currentDirectoryTime = dir.getLastWrite();
+  dir.close();
+
+  if (loadFromFile(currentDirectoryTime)) {
+    Serial.printf("[%lu] [SII] Loaded index: %d images\n", millis(), entries.size());
+    return true;
+  }
+
+  return rebuild();
+}
+
+bool SleepImageIndex::rebuild() {
+  const auto start = millis();
+  entries.clear();
+
+  auto dir = SD.open(SLEEP_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return false;
+  }
+  directoryTime = dir.getLastWrite();
+
+  // collect all valid BMP files
+  for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    if (file.isDirectory()) {
+      file.close();
+      continue;
+    }
+    auto filename = std::string(file.name());
+    if (filename[0] == '.') {
+      file.close();
+      continue;
+    }
+
+    if (filename.length() < 4 || filename.substr(filename.length() - 4) != ".bmp") {
+      Serial.printf("[%lu] [SII] Skipping non-.bmp file name: %s\n", millis(), filename.c_str());
+      file.close();
+      continue;
+    }
+    Bitmap bitmap(file);
+    if (bitmap.parseHeaders() != BmpReaderError::Ok) {
+      Serial.printf("[%lu] [SII] Skipping invalid BMP file: %s\n", millis(), filename.c_str());
+      file.close();
+      continue;
+    }
+    entries.push_back({filename, static_cast<uint32_t>(file.size()), static_cast<uint32_t>(file.getLastWrite()),
+                       static_cast<uint16_t>(bitmap.getWidth()), static_cast<uint16_t>(bitmap.getHeight())});
+    file.close();
+  }
+  dir.close();
+
+  Serial.printf("[%lu] [SII] Rebuilt index in %lums: %d images\n", millis(), millis() - start, entries.size());
+  saveToFile();
+  return true;
+}
+
+void SleepImageIndex::invalidate() {
+  if (SD.exists(INDEX_FILE)) {
+    SD.remove(INDEX_FILE);
+  }
+}
+
+bool SleepImageIndex::loadFromFile(const uint32_t currentDirectoryTime) {
+  if (!SD.exists(INDEX_FILE)) {
+    return false;
+  }
+
+  File inputFile;
+  if (!FsHelpers::openFileForRead("SII", INDEX_FILE, inputFile)) {
+    return false;
+  }
+
+  uint8_t version;
+  serialization::readPod(inputFile, version);
+  if (version != INDEX_FILE_VERSION) {
+    Serial.printf("[%lu] [SII] Deserialization failed: Unknown version %u\n", millis(), version);
+    inputFile.close();
+    return false;
+  }
+
+  serialization::readPod(inputFile, directoryTime);
+  if (directoryTime != currentDirectoryTime) {
+    Serial.printf("[%lu] [SII] /sleep changed, index is stale\n", millis());
+    inputFile.close();
+    return false;
+  }
+
+  uint32_t count;
+  serialization::readPod(inputFile, count);
+  entries.clear();
+  entries.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Entry entry;
+    serialization::readString(inputFile, entry.name);
+    serialization::readPod(inputFile, entry.size);
+    serialization::readPod(inputFile, entry.time);
+    serialization::readPod(inputFile, entry.width);
+    serialization::readPod(inputFile, entry.height);
+    entries.push_back(std::move(entry));
+  }
+
+  inputFile.close();
+  return true;
+}
+
+bool SleepImageIndex::saveToFile() const {
+  SD.mkdir(INDEX_DIR);
+
+  File outputFile;
+  if (!FsHelpers::openFileForWrite("SII", INDEX_FILE, outputFile)) {
+    return false;
+  }
+
+  serialization::writePod(outputFile, INDEX_FILE_VERSION);
+  serialization::writePod(outputFile, directoryTime);
+  const uint32_t count = entries.size();
+  serialization::writePod(outputFile, count);
+  for (const auto& entry : entries) {
+    serialization::writeString(outputFile, entry.name);
+    serialization::writePod(outputFile, entry.size);
+    serialization::writePod(outputFile, entry.time);
+    serialization::writePod(outputFile, entry.width);
+    serialization::writePod(outputFile, entry.height);
+  }
+  outputFile.close();
+  return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Validated BMPs in /sleep, cached so entering sleep does not list the directory or parse every image each time.
+// The index is keyed on the directory's modification time. The web server invalidates it when it changes /sleep, and
+// the sleep screen rebuilds it when the chosen entry no longer matches its file.
+class SleepImageIndex {
+ public:
+  struct Entry {
+    std::string name;
+    uint32_t size;
+    uint32_t time;
+    uint16_t width;
+    uint16_t height;
+  };
+
+  // Loads the index, rebuilding it when /sleep changed since it was written
+  bool load();
+  bool rebuild();
+  const std::vector<Entry>& getEntries() const { return entries; }
+
+  // Forces a rebuild on next load, for changes that may not touch the directory's modification time
+  static void invalidate();
+
+ private:
+  uint32_t directoryTime = 0;
+  std::vector<Entry> entries;
+
+  bool loadFromFile(uint32_t currentDirectoryTime);
+  bool saveToFile() const;
+};
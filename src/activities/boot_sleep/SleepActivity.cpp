@@ -5,13 +5,16 @@
 #include <GfxRenderer.h>
 #include <SD.h>
 
-#include <vector>
-
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
+#include "SleepImageIndex.h"
 #include "config.h"
 #include "images/CrossLarge.h"
 
+namespace {
+constexpr char SLEEP_CACHE_DIR[] = "/.crosspoint/sleep";
+}  // namespace
+
 void SleepActivity::onEnter() {
   Activity::onEnter();
   renderPopup("Entering Sleep...");
@@ -42,64 +45,50 @@ void SleepActivity::renderPopup(const char* message) const {
 }
 
 void SleepActivity::renderCustomSleepScreen() const {
-  // Check if we have a /sleep directory
-  auto dir = SD.open("/sleep");
-  if (dir && dir.isDirectory()) {
-    std::vector<std::string> files;
-    // collect all valid BMP files
-    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
-      if (file.isDirectory()) {
-        file.close();
-        continue;
-      }
-      auto filename = std::string(file.name());
-      if (filename[0] == '.') {
-        file.close();
-        continue;
-      }
+  SD.mkdir(SLEEP_CACHE_DIR);
 
-      if (filename.substr(filename.length() - 4) != ".bmp") {
-        Serial.printf("[%lu] [SLP] Skipping non-.bmp file name: %s\n", millis(), file.name());
-        file.close();
-        continue;
-      }
-      Bitmap bitmap(file);
-      if (bitmap.parseHeaders() != BmpReaderError::Ok) {
-        Serial.printf("[%lu] [SLP] Skipping invalid BMP file: %s\n", millis(), file.name());
-        file.close();
-        continue;
+  SleepImageIndex index;
+  if (index.load() && !index.getEntries().empty()) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+      const auto& entries = index.getEntries();
+      if (entries.empty()) {
+        break;
       }
-      files.emplace_back(filename);
-      file.close();
-    }
-    const auto numFiles = files.size();
-    if (numFiles > 0) {
-      // Generate a random number between 1 and numFiles
-      const auto randomFileIndex = random(numFiles);
-      const auto filename = "/sleep/" + files[randomFileIndex];
+
+      // Only the chosen file is opened, its size and time show whether the index still matches it
+      const auto& entry = entries[random(entries.size())];
+      const auto filename = "/sleep/" + entry.name;
       File file;
       if (FsHelpers::openFileForRead("SLP", filename, file)) {
-        Serial.printf("[%lu] [SLP] Randomly loading: /sleep/%s\n", millis(), files[randomFileIndex].c_str());
-        delay(100);
-        Bitmap bitmap(file);
-        if (bitmap.parseHeaders() == BmpReaderError::Ok) {
-          renderBitmapSleepScreen(bitmap);
-          dir.close();
-          return;
+        if (file.size() == entry.size && static_cast<uint32_t>(file.getLastWrite()) == entry.time) {
+          Serial.printf("[%lu] [SLP] Randomly loading: %s (%ux%u)\n", millis(), filename.c_str(), entry.width,
+                        entry.height);
+          const bool rendered =
+              renderImageSleepScreen(file, std::string(SLEEP_CACHE_DIR) + "/" + entry.name + ".planes");
+          file.close();
+          if (rendered) {
+            return;
+          }
+        } else {
+          file.close();
         }
       }
+
+      Serial.printf("[%lu] [SLP] Sleep image index out of date, rebuilding\n", millis());
+      if (!index.rebuild()) {
+        break;
+      }
     }
   }
-  if (dir) dir.close();
 
   // Look for sleep.bmp on the root of the sd card to determine if we should
   // render a custom sleep screen instead of the default.
   File file;
   if (FsHelpers::openFileForRead("SLP", "/sleep.bmp", file)) {
-    Bitmap bitmap(file);
-    if (bitmap.parseHeaders() == BmpReaderError::Ok) {
-      Serial.printf("[%lu] [SLP] Loading: /sleep.bmp\n", millis());
-      renderBitmapSleepScreen(bitmap);
+    Serial.printf("[%lu] [SLP] Loading: /sleep.bmp\n", millis());
+    const bool rendered = renderImageSleepScreen(file, std::string(SLEEP_CACHE_DIR) + "/sleep.bmp.planes");
+    file.close();
+    if (rendered) {
       return;
     }
   }
@@ -124,7 +113,64 @@ void SleepActivity::renderDefaultSleepScreen() const {
   renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
 }
 
-void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap) const {
+bool SleepActivity::renderImageSleepScreen(File& file, const std::string& cachePath) const {
+  const uint32_t sourceSize = file.size();
+  const uint32_t sourceTime = file.getLastWrite();
+  if (renderCachedSleepScreen(cachePath, sourceSize, sourceTime)) {
+    return true;
+  }
+
+  Bitmap bitmap(file);
+  if (bitmap.parseHeaders() != BmpReaderError::Ok) {
+    return false;
+  }
+
+  renderBitmapSleepScreen(bitmap, cachePath, {sourceSize, sourceTime, bitmap.hasGreyscale()});
+  return true;
+}
+
+bool SleepActivity::renderCachedSleepScreen(const std::string& cachePath, const uint32_t sourceSize,
+                                            const uint32_t sourceTime) const {
+  if (!SD.exists(cachePath.c_str())) {
+    return false;
+  }
+
+  File cache;
+  if (!FsHelpers::openFileForRead("SLP", cachePath, cache)) {
+    return false;
+  }
+
+  PlaneImage::Header header;
+  if (!PlaneImage::readHeader(cache, header) || header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+    Serial.printf("[%lu] [SLP] Stale plane cache: %s\n", millis(), cachePath.c_str());
+    cache.close();
+    return false;
+  }
+
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+  if (!PlaneImage::readPlane(cache, frameBuffer)) {
+    cache.close();
+    return false;
+  }
+  Serial.printf("[%lu] [SLP] Showing cached planes: %s\n", millis(), cachePath.c_str());
+  renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
+
+  if (header.hasGrayscale) {
+    if (PlaneImage::readPlane(cache, frameBuffer)) {
+      renderer.copyGrayscaleLsbBuffers();
+      if (PlaneImage::readPlane(cache, frameBuffer)) {
+        renderer.copyGrayscaleMsbBuffers();
+        renderer.displayGrayBuffer();
+      }
+    }
+  }
+
+  cache.close();
+  return true;
+}
+
+void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap, const std::string& cachePath,
+                                            const PlaneImage::Header& header) const {
   int x, y;
   const auto pageWidth = renderer.getScreenWidth();
   const auto pageHeight = renderer.getScreenHeight();
@@ -149,8 +195,13 @@ void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap) const {
     y = (pageHeight - bitmap.getHeight()) / 2;
   }
 
+  // Write each plane out as it is rendered so the next time is just reads
+  File cache;
+  bool caching = FsHelpers::openFileForWrite("SLP", cachePath, cache) && PlaneImage::writeHeader(cache, header);
+
   renderer.clearScreen();
   renderer.drawBitmap(bitmap, x, y, pageWidth, pageHeight);
+  caching = caching && PlaneImage::writePlane(cache, renderer.getFrameBuffer());
   renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
 
   if (bitmap.hasGreyscale()) {
@@ -158,17 +209,27 @@ void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap) const {
     renderer.clearScreen(0x00);
     renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
     renderer.drawBitmap(bitmap, x, y, pageWidth, pageHeight);
+    caching = caching && PlaneImage::writePlane(cache, renderer.getFrameBuffer());
     renderer.copyGrayscaleLsbBuffers();
 
     bitmap.rewindToData();
     renderer.clearScreen(0x00);
     renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
     renderer.drawBitmap(bitmap, x, y, pageWidth, pageHeight);
+    caching = caching && PlaneImage::writePlane(cache, renderer.getFrameBuffer());
     renderer.copyGrayscaleMsbBuffers();
 
     renderer.displayGrayBuffer();
     renderer.setRenderMode(GfxRenderer::BW);
   }
+
+  if (cache) {
+    cache.close();
+    if (!caching) {
+      Serial.printf("[%lu] [SLP] Failed to write plane cache: %s\n", millis(), cachePath.c_str());
+      SD.remove(cachePath.c_str());
+    }
+  }
 }
 
 void SleepActivity::renderCoverSleepScreen() const {
@@ -189,9 +250,9 @@ void SleepActivity::renderCoverSleepScreen() const {
 
   File file;
   if (FsHelpers::openFileForRead("SLP", lastEpub.getCoverBmpPath(), file)) {
-    Bitmap bitmap(file);
-    if (bitmap.parseHeaders() == BmpReaderError::Ok) {
-      renderBitmapSleepScreen(bitmap);
+    const bool rendered = renderImageSleepScreen(file, lastEpub.getCachePath() + "/cover.planes");
+    file.close();
+    if (rendered) {
       return;
     }
   }
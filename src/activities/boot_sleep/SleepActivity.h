@@ -1,4 +1,8 @@
 #pragma once
+#include <PlaneImage.h>
+
+#include <string>
+
 #include "../Activity.h"
 
 class Bitmap;
@@ -14,5 +18,8 @@ class SleepActivity final : public Activity {
   void renderDefaultSleepScreen() const;
   void renderCustomSleepScreen() const;
   void renderCoverSleepScreen() const;
-  void renderBitmapSleepScreen(const Bitmap& bitmap) const;
+  bool renderImageSleepScreen(File& file, const std::string& cachePath) const;
+  bool renderCachedSleepScreen(const std::string& cachePath, uint32_t sourceSize, uint32_t sourceTime) const;
+  void renderBitmapSleepScreen(const Bitmap& bitmap, const std::string& cachePath,
+                               const PlaneImage::Header& header) const;
 };
@@ -1,14 +1,22 @@
 #include "HomeActivity.h"
 
+#include <Epub.h>
+#include <FsHelpers.h>
 #include <GfxRenderer.h>
 #include <InputManager.h>
 #include <SD.h>
 
+#include <algorithm>
+
+#include "CrossPointState.h"
 #include "config.h"
 
 namespace {
 constexpr int menuItemCount = 3;
-}
+constexpr int thumbY = 180;
+constexpr int thumbMaxWidth = 200;
+constexpr int thumbMaxHeight = 300;
+}  // namespace
 
 void HomeActivity::taskTrampoline(void* param) {
   auto* self = static_cast<HomeActivity*>(param);
@@ -22,11 +30,20 @@ void HomeActivity::onEnter() {
 
   selectorIndex = 0;
 
+  // Only look for an existing thumbnail, it is generated when the book is opened
+  thumbBmpPath.clear();
+  if (!APP_STATE.openEpubPath.empty()) {
+    const Epub lastEpub(APP_STATE.openEpubPath, "/.crosspoint");
+    if (SD.exists(lastEpub.getThumbBmpPath().c_str())) {
+      thumbBmpPath = lastEpub.getThumbBmpPath();
+    }
+  }
+
   // Trigger first update
   updateRequired = true;
 
   xTaskCreate(&HomeActivity::taskTrampoline, "HomeActivityTask",
-              2048,               // Stack size
+              4096,               // Stack size, drawing the thumbnail needs more than the menu alone
               this,               // Parameters
               1,                  // Priority
               &displayTaskHandle  // Task handle
@@ -81,7 +98,7 @@ void HomeActivity::displayTaskLoop() {
   }
 }
 
-void HomeActivity::render() const {
+void HomeActivity::render() {
   renderer.clearScreen();
 
   const auto pageWidth = renderer.getScreenWidth();
@@ -94,6 +111,8 @@ void HomeActivity::render() const {
   renderer.drawText(UI_FONT_ID, 20, 90, "File transfer", selectorIndex != 1);
   renderer.drawText(UI_FONT_ID, 20, 120, "Settings", selectorIndex != 2);
 
+  const bool thumbHasGreyscale = renderThumb();
+
   renderer.drawRect(25, pageHeight - 40, 106, 40);
   renderer.drawText(UI_FONT_ID, 25 + (105 - renderer.getTextWidth(UI_FONT_ID, "Back")) / 2, pageHeight - 35, "Back");
 
@@ -107,5 +126,42 @@ void HomeActivity::render() const {
   renderer.drawRect(350, pageHeight - 40, 106, 40);
   renderer.drawText(UI_FONT_ID, 350 + (105 - renderer.getTextWidth(UI_FONT_ID, "Right")) / 2, pageHeight - 35, "Right");
 
-  renderer.displayBuffer();
+  renderer.displayChanges();
+
+  // Any refresh over the thumbnail wipes its grey levels, menu moves only refresh the rows around the menu
+  if (thumbHasGreyscale && renderer.wasRefreshed(thumbY, thumbMaxHeight)) {
+    // Save bw buffer to reset buffer state after grayscale data sync
+    renderer.storeBwBuffer();
+
+    renderer.clearScreen(0x00);
+    renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
+    renderThumb();
+    renderer.copyGrayscaleLsbBuffers();
+
+    renderer.clearScreen(0x00);
+    renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+    renderThumb();
+    renderer.copyGrayscaleMsbBuffers();
+
+    renderer.displayGrayBuffer();
+    renderer.setRenderMode(GfxRenderer::BW);
+    renderer.restoreBwBuffer();
+  }
+}
+
+bool HomeActivity::renderThumb() const {
+  File thumbFile;
+  if (thumbBmpPath.empty() || !FsHelpers::openFileForRead("HOM", thumbBmpPath, thumbFile)) {
+    return false;
+  }
+
+  bool hasGreyscale = false;
+  Bitmap bitmap(thumbFile);
+  if (bitmap.parseHeaders() == BmpReaderError::Ok) {
+    const int x = (renderer.getScreenWidth() - std::min(bitmap.getWidth(), thumbMaxWidth)) / 2;
+    renderer.drawBitmap(bitmap, x, thumbY, thumbMaxWidth, thumbMaxHeight);
+    hasGreyscale = bitmap.hasGreyscale();
+  }
+  thumbFile.close();
+  return hasGreyscale;
 }
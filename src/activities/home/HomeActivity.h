@@ -4,6 +4,7 @@
 #include <freertos/task.h>
 
 #include <functional>
+#include <string>
 
 #include "../Activity.h"
 
@@ -12,13 +13,17 @@ class HomeActivity final : public Activity {
   SemaphoreHandle_t renderingMutex = nullptr;
   int selectorIndex = 0;
   bool updateRequired = false;
+  // Cover thumbnail of the last opened book, empty if there isn't one cached
+  std::string thumbBmpPath;
   const std::function<void()> onReaderOpen;
   const std::function<void()> onSettingsOpen;
   const std::function<void()> onFileTransferOpen;
 
   static void taskTrampoline(void* param);
   [[noreturn]] void displayTaskLoop();
-  void render() const;
+  void render();
+  // Draws the thumbnail in the renderer's current mode, returns whether it has grey levels to draw
+  bool renderThumb() const;
 
  public:
   explicit HomeActivity(GfxRenderer& renderer, InputManager& inputManager, const std::function<void()>& onReaderOpen,
@@ -476,7 +476,8 @@ void WifiSelectionActivity::render() const {
       break;
   }
 
-  renderer.displayBuffer();
+  // Keyboard typing and list navigation only change a few rows
+  renderer.displayChanges();
 }
 
 void WifiSelectionActivity::renderNetworkList() const {
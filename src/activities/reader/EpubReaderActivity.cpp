@@ -5,20 +5,80 @@
 #include <GfxRenderer.h>
 #include <InputManager.h>
 
+#include <algorithm>
+#include <array>
+
 #include "Battery.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "EpubReaderChapterSelectionActivity.h"
+#include "EpubReaderSearchActivity.h"
 #include "config.h"
 
 namespace {
-constexpr int pagesPerRefresh = 15;
 constexpr unsigned long skipChapterMs = 700;
 constexpr float lineCompression = 0.95f;
 constexpr int marginTop = 8;
 constexpr int marginRight = 10;
 constexpr int marginBottom = 22;
 constexpr int marginLeft = 10;
+constexpr int statusBarTextY = 776;
+// 1 column on left, 2 columns on right, 5 columns of battery body
+constexpr int batteryWidth = 15;
+constexpr int batteryHeight = 10;
+constexpr int batteryFillWidth = batteryWidth - 5;
+constexpr int batteryY = 783;
+// Percentage text starts this far right of the battery icon
+constexpr int batteryTextOffset = 20;
+constexpr unsigned long batteryCheckIntervalMs = 60 * 1000;
+// Idle time after a page turn before the look-ahead page is rendered
+constexpr unsigned long lookaheadIdleMs = 400;
+
+// One bitmask per row, bit 0 being the leftmost column
+using BatteryGlyph = std::array<uint16_t, batteryHeight>;
+
+BatteryGlyph buildBatteryGlyph(const int filledWidth) {
+  BatteryGlyph glyph{};
+  const auto set = [&glyph](const int column, const int row) { glyph[row] |= 1 << column; };
+
+  // Top and bottom lines
+  for (int column = 0; column <= batteryWidth - 4; column++) {
+    set(column, 0);
+    set(column, batteryHeight - 1);
+  }
+  // Left line and battery end
+  for (int row = 0; row < batteryHeight; row++) {
+    set(0, row);
+    set(batteryWidth - 4, row);
+  }
+  // Battery terminal
+  for (int column = batteryWidth - 3; column < batteryWidth; column++) {
+    set(column, 2);
+    set(column, batteryHeight - 3);
+  }
+  for (int row = 2; row <= batteryHeight - 3; row++) {
+    set(batteryWidth - 1, row);
+  }
+  // Charge level
+  for (int row = 1; row < batteryHeight - 1; row++) {
+    for (int column = 1; column <= filledWidth; column++) {
+      set(column, row);
+    }
+  }
+
+  return glyph;
+}
+
+// Glyphs are built once per fill level (percentage bucket)
+const BatteryGlyph& getBatteryGlyph(const int filledWidth) {
+  static std::array<BatteryGlyph, batteryFillWidth + 1> glyphs{};
+  static std::array<bool, batteryFillWidth + 1> built{};
+  if (!built[filledWidth]) {
+    glyphs[filledWidth] = buildBatteryGlyph(filledWidth);
+    built[filledWidth] = true;
+  }
+  return glyphs[filledWidth];
+}
 }  // namespace
 
 void EpubReaderActivity::taskTrampoline(void* param) {
@@ -36,18 +96,31 @@ void EpubReaderActivity::onEnter() {
   renderingMutex = xSemaphoreCreateMutex();
 
   epub->setupCacheDir();
+  // Cached for the home screen, only decoded again when the book's metadata has been rebuilt since
+  if (!epub->isThumbBmpCurrent()) {
+    epub->generateThumbBmp();
+  }
 
   File f;
   if (FsHelpers::openFileForRead("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
+    // Spine index and page number, followed by the page's text offset since it was added
+    uint8_t data[8];
+    const size_t length = f.read(data, 8);
+    if (length >= 4) {
       currentSpineIndex = data[0] + (data[1] << 8);
       nextPageNumber = data[2] + (data[3] << 8);
       Serial.printf("[%lu] [ERS] Loaded cache: %d, %d\n", millis(), currentSpineIndex, nextPageNumber);
     }
+    if (length == 8) {
+      nextTextOffset = data[4] + (data[5] << 8) + (data[6] << 16) + (static_cast<uint32_t>(data[7]) << 24);
+    }
     f.close();
   }
 
+  pageMap.reset(new BookPageMap(epub->getCachePath() + "/pages.bin"));
+  pageMap->load(*epub, BookPageMap::computeLayoutHash(READER_FONT_ID, lineCompression, marginTop, marginRight,
+                                                      marginBottom, marginLeft, SETTINGS.extraParagraphSpacing));
+
   // Save current epub as last opened epub
   APP_STATE.openEpubPath = epub->getPath();
   APP_STATE.saveToFile();
@@ -74,8 +147,12 @@ void EpubReaderActivity::onExit() {
   }
   vSemaphoreDelete(renderingMutex);
   renderingMutex = nullptr;
+  clearLookahead();
+  displayedPage.reset();
   section.reset();
+  pageMap.reset();
   epub.reset();
+  PageImage::closeOpenFile();
 }
 
 void EpubReaderActivity::loop() {
@@ -85,8 +162,58 @@ void EpubReaderActivity::loop() {
     return;
   }
 
-  // Enter chapter selection activity
+  // Only a press that started here counts, not the release of one that closed a sub activity
   if (inputManager.wasPressed(InputManager::BTN_CONFIRM)) {
+    confirmPressed = true;
+  }
+
+  // Holding confirm searches the book
+  if (confirmPressed && inputManager.wasReleased(InputManager::BTN_CONFIRM) &&
+      inputManager.getHeldTime() > skipChapterMs) {
+    confirmPressed = false;
+    // Don't start activity transition while rendering
+    xSemaphoreTake(renderingMutex, portMAX_DELAY);
+    exitActivity();
+    // The search inflates whole chapters, so give it the heap held by the section's page cache and the look-ahead
+    // frame. The section is reloaded from its cache at the same page when the search closes.
+    clearLookahead();
+    displayedPage.reset();
+    if (section) {
+      nextPageNumber = section->currentPage;
+      section.reset();
+    }
+    PageImage::closeOpenFile();
+    enterNewActivity(new EpubReaderSearchActivity(
+        this->renderer, this->inputManager, epub,
+        [this](const int spineIndex) {
+          std::unique_ptr<Section> cached(new Section(epub, spineIndex, renderer));
+          if (!cached->loadCacheMetadata(READER_FONT_ID, lineCompression, marginTop, marginRight, marginBottom,
+                                         marginLeft, SETTINGS.extraParagraphSpacing)) {
+            cached.reset();
+          }
+          return cached;
+        },
+        [this] {
+          exitActivity();
+          updateRequired = true;
+        },
+        [this](const int spineIndex, const uint32_t textOffset) {
+          // Resolved to a page once the section is loaded for the current layout
+          currentSpineIndex = spineIndex;
+          nextPageNumber = 0;
+          nextTextOffset = textOffset;
+          nextAnchor.clear();
+          section.reset();
+          exitActivity();
+          updateRequired = true;
+        }));
+    xSemaphoreGive(renderingMutex);
+    return;
+  }
+
+  // Enter chapter selection activity
+  if (confirmPressed && inputManager.wasReleased(InputManager::BTN_CONFIRM)) {
+    confirmPressed = false;
     // Don't start activity transition while rendering
     xSemaphoreTake(renderingMutex, portMAX_DELAY);
     exitActivity();
@@ -96,11 +223,15 @@ void EpubReaderActivity::loop() {
           exitActivity();
           updateRequired = true;
         },
-        [this](const int newSpineIndex) {
-          if (currentSpineIndex != newSpineIndex) {
+        [this](const int newSpineIndex, const std::string& anchor) {
+          if (currentSpineIndex != newSpineIndex || !section) {
             currentSpineIndex = newSpineIndex;
             nextPageNumber = 0;
+            nextAnchor = anchor;
             section.reset();
+          } else if (section && !anchor.empty()) {
+            const int anchorPage = section->getPageForAnchor(anchor);
+            section->currentPage = anchorPage >= 0 ? anchorPage : 0;
           }
           exitActivity();
           updateRequired = true;
@@ -149,6 +280,8 @@ void EpubReaderActivity::loop() {
     return;
   }
 
+  pageTurnDirection = prevReleased ? -1 : 1;
+
   if (prevReleased) {
     if (section->currentPage > 0) {
       section->currentPage--;
@@ -183,6 +316,14 @@ void EpubReaderActivity::displayTaskLoop() {
       xSemaphoreTake(renderingMutex, portMAX_DELAY);
       renderScreen();
       xSemaphoreGive(renderingMutex);
+    } else if (lookaheadPending && millis() - lastPageRenderTime > lookaheadIdleMs) {
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
+      renderLookahead();
+      xSemaphoreGive(renderingMutex);
+    } else if (millis() - lastBatteryCheckTime > batteryCheckIntervalMs) {
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
+      refreshBatteryIndicator();
+      xSemaphoreGive(renderingMutex);
     }
     vTaskDelay(10 / portTICK_PERIOD_MS);
   }
@@ -212,6 +353,10 @@ void EpubReaderActivity::renderScreen() {
   }
 
   if (!section) {
+    // Free the previous section's pages before indexing needs the heap
+    clearLookahead();
+    displayedPage.reset();
+
     const auto filepath = epub->getSpineItem(currentSpineIndex).href;
     Serial.printf("[%lu] [ERS] Loading file: %s, index: %d\n", millis(), filepath.c_str(), currentSpineIndex);
     section = std::unique_ptr<Section>(new Section(epub, currentSpineIndex, renderer));
@@ -230,7 +375,7 @@ void EpubReaderActivity::renderScreen() {
         renderer.drawText(READER_FONT_ID, x + margin, y + margin, "Indexing...");
         renderer.drawRect(x + 5, y + 5, w - 10, h - 10);
         renderer.displayBuffer();
-        pagesUntilFullRefresh = 0;
+        ghostingTracker.requestFullRefresh();
       }
 
       section->setupCacheDir();
@@ -249,6 +394,25 @@ void EpubReaderActivity::renderScreen() {
     } else {
       section->currentPage = nextPageNumber;
     }
+    pageMap->setPageCount(currentSpineIndex, section->pageCount);
+
+    // The saved page number only holds if the layout is the same as when it was saved
+    if (nextTextOffset != UINT32_MAX) {
+      if (section->getTextOffsetForPage(section->currentPage) != nextTextOffset) {
+        section->currentPage = section->getPageForTextOffset(nextTextOffset);
+        Serial.printf("[%lu] [ERS] Layout changed, text offset %u is now on page %d\n", millis(), nextTextOffset,
+                      section->currentPage);
+      }
+      nextTextOffset = UINT32_MAX;
+    }
+    // TOC jumps into the middle of a chapter
+    if (!nextAnchor.empty()) {
+      const int anchorPage = section->getPageForAnchor(nextAnchor);
+      if (anchorPage >= 0) {
+        section->currentPage = anchorPage;
+      }
+      nextAnchor.clear();
+    }
   }
 
   renderer.clearScreen();
@@ -269,10 +433,21 @@ void EpubReaderActivity::renderScreen() {
     return;
   }
 
-  {
+  if (lookaheadPage && lookaheadSpineIndex == currentSpineIndex && lookaheadPageIndex == section->currentPage &&
+      lookaheadFrame.restore(renderer.getFrameBuffer(), GfxRenderer::getBufferSize())) {
+    Serial.printf("[%lu] [ERS] Using look-ahead page %d\n", millis(), section->currentPage);
+    auto p = std::move(lookaheadPage);
+    clearLookahead();
+    const auto start = millis();
+    renderContents(std::move(p), true);
+    Serial.printf("[%lu] [ERS] Rendered page in %dms\n", millis(), millis() - start);
+  } else {
     auto p = section->loadPageFromSD();
     if (!p) {
       Serial.printf("[%lu] [ERS] Failed to load page from SD - clearing section cache\n", millis());
+      // Come back to the same text once it has been re-indexed
+      nextPageNumber = section->currentPage;
+      nextTextOffset = section->getTextOffsetForPage(section->currentPage);
       section->clearCache();
       section.reset();
       return renderScreen();
@@ -284,25 +459,35 @@ void EpubReaderActivity::renderScreen() {
 
   File f;
   if (FsHelpers::openFileForWrite("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
+    const uint32_t textOffset = section->getTextOffsetForPage(section->currentPage);
+    uint8_t data[8];
     data[0] = currentSpineIndex & 0xFF;
     data[1] = (currentSpineIndex >> 8) & 0xFF;
     data[2] = section->currentPage & 0xFF;
     data[3] = (section->currentPage >> 8) & 0xFF;
-    f.write(data, 4);
+    data[4] = textOffset & 0xFF;
+    data[5] = (textOffset >> 8) & 0xFF;
+    data[6] = (textOffset >> 16) & 0xFF;
+    data[7] = (textOffset >> 24) & 0xFF;
+    f.write(data, 8);
     f.close();
   }
 }
 
-void EpubReaderActivity::renderContents(std::unique_ptr<Page> page) {
-  page->render(renderer, READER_FONT_ID);
+void EpubReaderActivity::renderContents(std::shared_ptr<Page> page, const bool contentRendered) {
+  if (!contentRendered) {
+    page->render(renderer, READER_FONT_ID);
+  }
   renderStatusBar();
-  if (pagesUntilFullRefresh <= 1) {
+  ghostingTracker.observe(renderer.getFrameBuffer());
+  if (ghostingTracker.shouldFullRefresh()) {
+    Serial.printf("[%lu] [ERS] Full refresh after %d pages (%u flipped, %u black to white)\n", millis(),
+                  ghostingTracker.getPagesSinceFullRefresh(), ghostingTracker.getFlippedPixels(),
+                  ghostingTracker.getBlackToWhitePixels());
     renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
-    pagesUntilFullRefresh = pagesPerRefresh;
+    ghostingTracker.onFullRefresh();
   } else {
     renderer.displayBuffer();
-    pagesUntilFullRefresh--;
   }
 
   // Save bw buffer to reset buffer state after grayscale data sync
@@ -329,74 +514,196 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page) {
 
   // restore the bw data
   renderer.restoreBwBuffer();
+
+  displayedPage = std::move(page);
+  lookaheadPending = SETTINGS.pageLookahead;
+  lastPageRenderTime = millis();
+}
+
+void EpubReaderActivity::renderLookahead() {
+  lookaheadPending = false;
+
+  // Sub activities own the framebuffer while they are open
+  if (!section || !displayedPage || subActivity) {
+    return;
+  }
+
+  const int targetPage = section->currentPage + pageTurnDirection;
+  if (targetPage < 0 || targetPage >= section->pageCount) {
+    return;
+  }
+  if (lookaheadPage && lookaheadSpineIndex == currentSpineIndex && lookaheadPageIndex == targetPage) {
+    return;
+  }
+  clearLookahead();
+
+  if (ESP.getFreeHeap() < Section::RESERVED_HEAP) {
+    Serial.printf("[%lu] [ERS] Skipping look-ahead, free heap %d bytes\n", millis(), ESP.getFreeHeap());
+    return;
+  }
+
+  const auto start = millis();
+  auto page = section->loadPageFromSD(targetPage);
+  if (!page) {
+    return;
+  }
+
+  // The status bar is left out and drawn when the page is shown so it is up to date
+  renderer.clearScreen();
+  page->render(renderer, READER_FONT_ID);
+
+  const size_t freeHeap = ESP.getFreeHeap();
+  const size_t allocationBudget = freeHeap > Section::RESERVED_HEAP ? freeHeap - Section::RESERVED_HEAP : 0;
+  if (lookaheadFrame.store(renderer.getFrameBuffer(), GfxRenderer::getBufferSize(), allocationBudget,
+                           ESP.getMaxAllocHeap())) {
+    lookaheadPage = std::move(page);
+    lookaheadSpineIndex = currentSpineIndex;
+    lookaheadPageIndex = targetPage;
+    Serial.printf("[%lu] [ERS] Pre-rendered page %d in %dms (%s, %d bytes)\n", millis(), targetPage,
+                  millis() - start, lookaheadFrame.getEncoding() == FrameSnapshot::Encoding::Raw ? "raw" : "rle",
+                  lookaheadFrame.getStoredBytes());
+  } else {
+    Serial.printf("[%lu] [ERS] Not enough heap to keep look-ahead page, free heap %d bytes\n", millis(), freeHeap);
+  }
+
+  // Put the page that is on screen back into the framebuffer
+  renderer.clearScreen();
+  displayedPage->render(renderer, READER_FONT_ID);
+  renderStatusBar();
 }
 
-void EpubReaderActivity::renderStatusBar() const {
-  constexpr auto textY = 776;
+void EpubReaderActivity::clearLookahead() {
+  lookaheadFrame.clear();
+  lookaheadPage.reset();
+  lookaheadSpineIndex = -1;
+  lookaheadPageIndex = -1;
+}
 
-  // Calculate progress in book
-  const float sectionChapterProg = static_cast<float>(section->currentPage) / section->pageCount;
-  const uint8_t bookProgress = epub->calculateProgress(currentSpineIndex, sectionChapterProg);
+void EpubReaderActivity::renderStatusBar() {
+  // Page in book, the total is marked as approximate until every chapter has been indexed
+  std::string bookProgress;
+  if (pageMap && pageMap->getTotalPages() > 0) {
+    const int bookPage = pageMap->getPagesBefore(currentSpineIndex) + section->currentPage + 1;
+    bookProgress = std::to_string(bookPage) + "/" + (pageMap->isComplete() ? "" : "~") +
+                   std::to_string(pageMap->getTotalPages());
+  } else {
+    const float sectionChapterProg = static_cast<float>(section->currentPage) / section->pageCount;
+    bookProgress = std::to_string(epub->calculateProgress(currentSpineIndex, sectionChapterProg)) + "%";
+  }
 
   // Right aligned text for progress counter
-  const std::string progress = std::to_string(section->currentPage + 1) + "/" + std::to_string(section->pageCount) +
-                               "  " + std::to_string(bookProgress) + "%";
+  const std::string progress =
+      std::to_string(section->currentPage + 1) + "/" + std::to_string(section->pageCount) + "  " + bookProgress;
   const auto progressTextWidth = renderer.getTextWidth(SMALL_FONT_ID, progress.c_str());
-  renderer.drawText(SMALL_FONT_ID, GfxRenderer::getScreenWidth() - marginRight - progressTextWidth, textY,
+  renderer.drawText(SMALL_FONT_ID, GfxRenderer::getScreenWidth() - marginRight - progressTextWidth, statusBarTextY,
                     progress.c_str());
 
   // Left aligned battery icon and percentage
-  const uint16_t percentage = battery.readPercentage();
-  const auto percentageText = std::to_string(percentage) + "%";
-  const auto percentageTextWidth = renderer.getTextWidth(SMALL_FONT_ID, percentageText.c_str());
-  renderer.drawText(SMALL_FONT_ID, 20 + marginLeft, textY, percentageText.c_str());
-
-  // 1 column on left, 2 columns on right, 5 columns of battery body
-  constexpr int batteryWidth = 15;
-  constexpr int batteryHeight = 10;
-  constexpr int x = marginLeft;
-  constexpr int y = 783;
-
-  // Top line
-  renderer.drawLine(x, y, x + batteryWidth - 4, y);
-  // Bottom line
-  renderer.drawLine(x, y + batteryHeight - 1, x + batteryWidth - 4, y + batteryHeight - 1);
-  // Left line
-  renderer.drawLine(x, y, x, y + batteryHeight - 1);
-  // Battery end
-  renderer.drawLine(x + batteryWidth - 4, y, x + batteryWidth - 4, y + batteryHeight - 1);
-  renderer.drawLine(x + batteryWidth - 3, y + 2, x + batteryWidth - 1, y + 2);
-  renderer.drawLine(x + batteryWidth - 3, y + batteryHeight - 3, x + batteryWidth - 1, y + batteryHeight - 3);
-  renderer.drawLine(x + batteryWidth - 1, y + 2, x + batteryWidth - 1, y + batteryHeight - 3);
-
-  // The +1 is to round up, so that we always fill at least one pixel
-  int filledWidth = percentage * (batteryWidth - 5) / 100 + 1;
-  if (filledWidth > batteryWidth - 5) {
-    filledWidth = batteryWidth - 5;  // Ensure we don't overflow
-  }
-  renderer.fillRect(x + 1, y + 1, filledWidth, batteryHeight - 2);
+  displayedBatteryPercentage = battery.readPercentage();
+  lastBatteryCheckTime = millis();
+  const int percentageTextWidth =
+      renderer.getTextWidth(SMALL_FONT_ID, (std::to_string(displayedBatteryPercentage) + "%").c_str());
 
   // Centered chatper title text
   // Page width minus existing content with 30px padding on each side
-  const int titleMarginLeft = 20 + percentageTextWidth + 30 + marginLeft;
+  const int titleMarginLeft = batteryTextOffset + percentageTextWidth + 30 + marginLeft;
   const int titleMarginRight = progressTextWidth + 30 + marginRight;
   const int availableTextWidth = GfxRenderer::getScreenWidth() - titleMarginLeft - titleMarginRight;
-  const int tocIndex = epub->getTocIndexForSpineIndex(currentSpineIndex);
 
-  std::string title;
-  int titleWidth;
-  if (tocIndex == -1) {
-    title = "Unnamed";
-    titleWidth = renderer.getTextWidth(SMALL_FONT_ID, "Unnamed");
-  } else {
-    const auto tocItem = epub->getTocItem(tocIndex);
-    title = tocItem.title;
-    titleWidth = renderer.getTextWidth(SMALL_FONT_ID, title.c_str());
-    while (titleWidth > availableTextWidth && title.length() > 11) {
-      title.replace(title.length() - 8, 8, "...");
-      titleWidth = renderer.getTextWidth(SMALL_FONT_ID, title.c_str());
+  // The TOC lookup and truncation only depend on the chapter and the space left for the title
+  if (cachedTitleSpineIndex != currentSpineIndex || cachedTitleAvailableWidth != availableTextWidth) {
+    const int tocIndex = epub->getTocIndexForSpineIndex(currentSpineIndex);
+    if (tocIndex == -1) {
+      cachedTitle = "Unnamed";
+      cachedTitleWidth = renderer.getTextWidth(SMALL_FONT_ID, "Unnamed");
+    } else {
+      const auto tocItem = epub->getTocItem(tocIndex);
+      cachedTitle = tocItem.title;
+      cachedTitleWidth = renderer.getTextWidth(SMALL_FONT_ID, cachedTitle.c_str());
+      while (cachedTitleWidth > availableTextWidth && cachedTitle.length() > 11) {
+        cachedTitle.replace(cachedTitle.length() - 8, 8, "...");
+        cachedTitleWidth = renderer.getTextWidth(SMALL_FONT_ID, cachedTitle.c_str());
+      }
+    }
+    cachedTitleSpineIndex = currentSpineIndex;
+    cachedTitleAvailableWidth = availableTextWidth;
+  }
+
+  // Everything left of the progress text only changes with the chapter, the battery or the space for the title
+  const int top = std::min(statusBarTextY, batteryY) / 8 * 8;
+  const int height = (GfxRenderer::getScreenHeight() - top + 7) / 8 * 8;
+  if (statusStripSpineIndex != currentSpineIndex || statusStripTitleWidth != availableTextWidth ||
+      statusStripBatteryPercentage != displayedBatteryPercentage) {
+    const int titleX = titleMarginLeft + (availableTextWidth - cachedTitleWidth) / 2;
+    // A title that didn't truncate far enough can go past the space it was given
+    buildStatusStrip(titleX, std::max(titleX + cachedTitleWidth, titleMarginLeft + availableTextWidth), top, height);
+    statusStripSpineIndex = currentSpineIndex;
+    statusStripTitleWidth = availableTextWidth;
+    statusStripBatteryPercentage = displayedBatteryPercentage;
+  }
+  renderer.drawStrips(marginLeft, top, statusStripWidth, height, statusStrip.data(), true);
+}
+
+void EpubReaderActivity::buildStatusStrip(const int titleX, const int right, const int top, const int height) {
+  statusStripWidth = right - marginLeft;
+  statusStrip.resize(statusStripWidth * (height / 8));
+
+  // Drawn on white over whatever is there, then read out and the bytes underneath put back
+  std::vector<uint8_t> underneath(statusStrip.size());
+  renderer.readStrips(marginLeft, top, statusStripWidth, height, underneath.data());
+  renderer.fillRect(marginLeft, top, statusStripWidth, height, false);
+  renderBatteryIndicator(displayedBatteryPercentage);
+  renderer.drawText(SMALL_FONT_ID, titleX, statusBarTextY, cachedTitle.c_str());
+  renderer.readStrips(marginLeft, top, statusStripWidth, height, statusStrip.data());
+  renderer.drawStrips(marginLeft, top, statusStripWidth, height, underneath.data(), false);
+}
+
+void EpubReaderActivity::renderBatteryIndicator(const uint16_t percentage) const {
+  const auto percentageText = std::to_string(percentage) + "%";
+  renderer.drawText(SMALL_FONT_ID, batteryTextOffset + marginLeft, statusBarTextY, percentageText.c_str());
+
+  // The +1 is to round up, so that we always fill at least one pixel
+  const int filledWidth = std::min(percentage * batteryFillWidth / 100 + 1, batteryFillWidth);
+  const auto& glyph = getBatteryGlyph(filledWidth);
+  for (int row = 0; row < batteryHeight; row++) {
+    for (int column = 0; column < batteryWidth; column++) {
+      if (glyph[row] & (1 << column)) {
+        renderer.drawPixel(marginLeft + column, batteryY + row);
+      }
     }
   }
+}
+
+void EpubReaderActivity::refreshBatteryIndicator() {
+  lastBatteryCheckTime = millis();
+
+  // Only while a page is on screen and nothing else owns the framebuffer
+  if (!section || !displayedPage || subActivity) {
+    return;
+  }
+
+  const uint16_t percentage = battery.readPercentage();
+  if (percentage == displayedBatteryPercentage) {
+    return;
+  }
 
-  renderer.drawText(SMALL_FONT_ID, titleMarginLeft + (availableTextWidth - titleWidth) / 2, textY, title.c_str());
+  Serial.printf("[%lu] [ERS] Battery changed %u%% -> %u%%, updating status bar\n", millis(), displayedBatteryPercentage,
+                percentage);
+
+  // Only the icon and the wider of the old and new percentage are redrawn, the title keeps its place either way.
+  // Screen rows are panel columns, so the window's top and height are rounded out to whole bytes.
+  const auto percentageTextWidth = [this](const uint16_t value) {
+    return renderer.getTextWidth(SMALL_FONT_ID, (std::to_string(value) + "%").c_str());
+  };
+  const int width =
+      batteryTextOffset + std::max(percentageTextWidth(displayedBatteryPercentage), percentageTextWidth(percentage));
+  const int top = std::min(statusBarTextY, batteryY) / 8 * 8;
+  const int textBottom = statusBarTextY + renderer.getLineHeight(SMALL_FONT_ID);
+  const int bottom = std::min(std::max(textBottom, batteryY + batteryHeight), GfxRenderer::getScreenHeight());
+  const int height = (bottom - top + 7) / 8 * 8;
+
+  displayedBatteryPercentage = percentage;
+  renderer.fillRect(marginLeft, top, width, height, false);
+  renderBatteryIndicator(percentage);
+  renderer.displayWindow(marginLeft, top, width, height);
 }
@@ -1,28 +1,72 @@
 #pragma once
+#include <EInkDisplay.h>
 #include <Epub.h>
+#include <Epub/BookPageMap.h>
+#include <Epub/Page.h>
 #include <Epub/Section.h>
+#include <FrameSnapshot.h>
+#include <GhostingTracker.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <vector>
+
 #include "activities/ActivityWithSubactivity.h"
 
 class EpubReaderActivity final : public ActivityWithSubactivity {
   std::shared_ptr<Epub> epub;
   std::unique_ptr<Section> section = nullptr;
+  // Book wide page numbers for the reader's layout
+  std::unique_ptr<BookPageMap> pageMap = nullptr;
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   int currentSpineIndex = 0;
   int nextPageNumber = 0;
-  int pagesUntilFullRefresh = 0;
+  // Saved position within the next section, UINT32_MAX when there is none. Wins over nextPageNumber once the
+  // section has been laid out differently from when it was saved.
+  uint32_t nextTextOffset = UINT32_MAX;
+  // TOC anchor to open the next section at, overrides nextPageNumber when the section knows its page
+  std::string nextAnchor;
+  GhostingTracker ghostingTracker{EInkDisplay::DISPLAY_WIDTH_BYTES, EInkDisplay::DISPLAY_HEIGHT};
   bool updateRequired = false;
+  // Confirm went down while the reader had input, it opens chapter selection or search once released
+  bool confirmPressed = false;
+  // Page currently on screen, kept to restore the framebuffer after a look-ahead render
+  std::shared_ptr<Page> displayedPage = nullptr;
+  // Neighbouring page pre-rendered while idle
+  FrameSnapshot lookaheadFrame;
+  std::shared_ptr<Page> lookaheadPage = nullptr;
+  int lookaheadSpineIndex = -1;
+  int lookaheadPageIndex = -1;
+  int pageTurnDirection = 1;
+  bool lookaheadPending = false;
+  unsigned long lastPageRenderTime = 0;
+  // Status bar state, so page turns skip the TOC lookup and battery only changes stay small
+  int cachedTitleSpineIndex = -1;
+  int cachedTitleAvailableWidth = -1;
+  std::string cachedTitle;
+  int cachedTitleWidth = 0;
+  // Battery, percentage and title as panel bytes, page turns copy them in instead of drawing the glyphs again
+  std::vector<uint8_t> statusStrip;
+  int statusStripWidth = 0;
+  int statusStripSpineIndex = -1;
+  int statusStripTitleWidth = -1;
+  uint16_t statusStripBatteryPercentage = 0;
+  uint16_t displayedBatteryPercentage = 0;
+  unsigned long lastBatteryCheckTime = 0;
   const std::function<void()> onGoBack;
 
   static void taskTrampoline(void* param);
   [[noreturn]] void displayTaskLoop();
   void renderScreen();
-  void renderContents(std::unique_ptr<Page> p);
-  void renderStatusBar() const;
+  void renderContents(std::shared_ptr<Page> p, bool contentRendered = false);
+  void renderLookahead();
+  void clearLookahead();
+  void renderStatusBar();
+  void buildStatusStrip(int titleX, int right, int top, int height);
+  void renderBatteryIndicator(uint16_t percentage) const;
+  void refreshBatteryIndicator();
 
  public:
   explicit EpubReaderActivity(GfxRenderer& renderer, InputManager& inputManager, std::unique_ptr<Epub> epub,
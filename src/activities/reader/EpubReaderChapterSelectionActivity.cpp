@@ -4,6 +4,8 @@
 #include <InputManager.h>
 #include <SD.h>
 
+#include <algorithm>
+
 #include "config.h"
 
 namespace {
@@ -11,6 +13,10 @@ constexpr int PAGE_ITEMS = 24;
 constexpr int SKIP_PAGE_MS = 700;
 }  // namespace
 
+int EpubReaderChapterSelectionActivity::getItemCount() const {
+  return epub->getTocItemsCount() > 0 ? epub->getTocItemsCount() : epub->getSpineItemsCount();
+}
+
 void EpubReaderChapterSelectionActivity::taskTrampoline(void* param) {
   auto* self = static_cast<EpubReaderChapterSelectionActivity*>(param);
   self->displayTaskLoop();
@@ -24,7 +30,11 @@ void EpubReaderChapterSelectionActivity::onEnter() {
   }
 
   renderingMutex = xSemaphoreCreateMutex();
-  selectorIndex = currentSpineIndex;
+  if (epub->getTocItemsCount() > 0) {
+    selectorIndex = std::max(epub->getTocIndexForSpineIndex(currentSpineIndex), 0);
+  } else {
+    selectorIndex = currentSpineIndex;
+  }
 
   // Trigger first update
   updateRequired = true;
@@ -57,23 +67,32 @@ void EpubReaderChapterSelectionActivity::loop() {
 
   const bool skipPage = inputManager.getHeldTime() > SKIP_PAGE_MS;
 
+  const int itemCount = getItemCount();
+
   if (inputManager.wasPressed(InputManager::BTN_CONFIRM)) {
-    onSelectSpineIndex(selectorIndex);
+    if (epub->getTocItemsCount() == 0) {
+      onSelectSpineIndex(selectorIndex, "");
+      return;
+    }
+    // TOC entries whose file isn't in the spine have nowhere to go
+    const auto item = epub->getTocItem(selectorIndex);
+    if (item.spineIndex >= 0) {
+      onSelectSpineIndex(item.spineIndex, item.anchor);
+    }
   } else if (inputManager.wasPressed(InputManager::BTN_BACK)) {
     onGoBack();
   } else if (prevReleased) {
     if (skipPage) {
-      selectorIndex =
-          ((selectorIndex / PAGE_ITEMS - 1) * PAGE_ITEMS + epub->getSpineItemsCount()) % epub->getSpineItemsCount();
+      selectorIndex = ((selectorIndex / PAGE_ITEMS - 1) * PAGE_ITEMS + itemCount) % itemCount;
     } else {
-      selectorIndex = (selectorIndex + epub->getSpineItemsCount() - 1) % epub->getSpineItemsCount();
+      selectorIndex = (selectorIndex + itemCount - 1) % itemCount;
     }
     updateRequired = true;
   } else if (nextReleased) {
     if (skipPage) {
-      selectorIndex = ((selectorIndex / PAGE_ITEMS + 1) * PAGE_ITEMS) % epub->getSpineItemsCount();
+      selectorIndex = ((selectorIndex / PAGE_ITEMS + 1) * PAGE_ITEMS) % itemCount;
     } else {
-      selectorIndex = (selectorIndex + 1) % epub->getSpineItemsCount();
+      selectorIndex = (selectorIndex + 1) % itemCount;
     }
     updateRequired = true;
   }
@@ -99,8 +118,9 @@ void EpubReaderChapterSelectionActivity::renderScreen() {
 
   const auto pageStartIndex = selectorIndex / PAGE_ITEMS * PAGE_ITEMS;
   renderer.fillRect(0, 60 + (selectorIndex % PAGE_ITEMS) * 30 + 2, pageWidth - 1, 30);
-  for (int i = pageStartIndex; i < epub->getSpineItemsCount() && i < pageStartIndex + PAGE_ITEMS; i++) {
-    const int tocIndex = epub->getTocIndexForSpineIndex(i);
+  const bool hasToc = epub->getTocItemsCount() > 0;
+  for (int i = pageStartIndex; i < getItemCount() && i < pageStartIndex + PAGE_ITEMS; i++) {
+    const int tocIndex = hasToc ? i : epub->getTocIndexForSpineIndex(i);
     if (tocIndex == -1) {
       renderer.drawText(UI_FONT_ID, 20, 60 + (i % PAGE_ITEMS) * 30, "Unnamed", i != selectorIndex);
     } else {
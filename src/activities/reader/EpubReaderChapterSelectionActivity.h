@@ -5,6 +5,7 @@
 #include <freertos/task.h>
 
 #include <memory>
+#include <string>
 
 #include "../Activity.h"
 
@@ -16,8 +17,11 @@ class EpubReaderChapterSelectionActivity final : public Activity {
   int selectorIndex = 0;
   bool updateRequired = false;
   const std::function<void()> onGoBack;
-  const std::function<void(int newSpineIndex)> onSelectSpineIndex;
+  // anchor is empty when the entry points at the start of the spine item
+  const std::function<void(int newSpineIndex, const std::string& anchor)> onSelectSpineIndex;
 
+  // TOC entries when the book has a TOC, spine items otherwise
+  int getItemCount() const;
   static void taskTrampoline(void* param);
   [[noreturn]] void displayTaskLoop();
   void renderScreen();
@@ -26,7 +30,8 @@ class EpubReaderChapterSelectionActivity final : public Activity {
   explicit EpubReaderChapterSelectionActivity(GfxRenderer& renderer, InputManager& inputManager,
                                               const std::shared_ptr<Epub>& epub, const int currentSpineIndex,
                                               const std::function<void()>& onGoBack,
-                                              const std::function<void(int newSpineIndex)>& onSelectSpineIndex)
+                                              const std::function<void(int newSpineIndex, const std::string& anchor)>&
+                                                  onSelectSpineIndex)
       : Activity("EpubReaderChapterSelection", renderer, inputManager),
         epub(epub),
         currentSpineIndex(currentSpineIndex),
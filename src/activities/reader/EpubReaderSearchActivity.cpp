@@ -0,0 +1,268 @@
+#include "EpubReaderSearchActivity.h"
+
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <InputManager.h>
+
+#include "activities/util/KeyboardEntryActivity.h"
+#include "config.h"
+
+namespace {
+constexpr int PAGE_ITEMS = 22;
+constexpr int SKIP_PAGE_MS = 700;
+}  // namespace
+
+void EpubReaderSearchActivity::taskTrampoline(void* param) {
+  auto* self = static_cast<EpubReaderSearchActivity*>(param);
+  self->displayTaskLoop();
+}
+
+void EpubReaderSearchActivity::onEnter() {
+  Activity::onEnter();
+
+  if (!epub) {
+    return;
+  }
+
+  renderingMutex = xSemaphoreCreateMutex();
+  state = QUERY_ENTRY;
+  enterNewActivity(new KeyboardEntryActivity(renderer, inputManager, "Search", "", BookSearch::MAX_QUERY_LENGTH));
+
+  // Trigger first update
+  updateRequired = true;
+  xTaskCreate(&EpubReaderSearchActivity::taskTrampoline, "EpubReaderSearchActivityTask",
+              4096,               // Stack size
+              this,               // Parameters
+              1,                  // Priority
+              &displayTaskHandle  // Task handle
+  );
+}
+
+void EpubReaderSearchActivity::onExit() {
+  Activity::onExit();
+
+  // Wait until not rendering to delete task to avoid killing mid-instruction to EPD
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  if (displayTaskHandle) {
+    vTaskDelete(displayTaskHandle);
+    displayTaskHandle = nullptr;
+  }
+  vSemaphoreDelete(renderingMutex);
+  renderingMutex = nullptr;
+  // The keyboard, if still open
+  exitActivity();
+}
+
+void EpubReaderSearchActivity::startSearch(const std::string& text) {
+  // SD card operations need lock as we use SPI for both
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  exitActivity();
+  const bool started = search.begin(text);
+  xSemaphoreGive(renderingMutex);
+
+  if (!started) {
+    onGoBack();
+    return;
+  }
+  if (search.isComplete()) {
+    showResults();
+    return;
+  }
+  state = SEARCHING;
+  updateRequired = true;
+}
+
+void EpubReaderSearchActivity::searchNextItem() {
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  const bool searched = search.searchNextItem([this] {
+    inputManager.update();
+    return inputManager.wasPressed(InputManager::BTN_BACK);
+  });
+  xSemaphoreGive(renderingMutex);
+
+  if (!searched) {
+    stopped = true;
+    showResults();
+    return;
+  }
+  if (search.isComplete()) {
+    showResults();
+    return;
+  }
+
+  // Each redraw holds up the search, so progress is only shown in tenths
+  const int progress = search.getNextSpineIndex() * 10 / epub->getSpineItemsCount();
+  if (progress != renderedProgress) {
+    renderedProgress = progress;
+    updateRequired = true;
+  }
+}
+
+void EpubReaderSearchActivity::showResults() {
+  const auto& results = search.getResults();
+  resultPages.assign(results.size(), -1);
+
+  // Results come in spine order, so each chapter's cache is read once
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  std::unique_ptr<Section> section;
+  int sectionSpineIndex = -1;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].spineIndex != sectionSpineIndex) {
+      sectionSpineIndex = results[i].spineIndex;
+      section = loadSectionCache(sectionSpineIndex);
+    }
+    if (section) {
+      resultPages[i] = section->getPageForTextOffset(results[i].textOffset);
+    }
+  }
+  xSemaphoreGive(renderingMutex);
+
+  state = RESULTS;
+  selectorIndex = 0;
+  updateRequired = true;
+}
+
+void EpubReaderSearchActivity::loop() {
+  if (state == QUERY_ENTRY) {
+    if (!subActivity) {
+      return;
+    }
+    const auto keyboard = static_cast<KeyboardEntryActivity*>(subActivity.get());
+    keyboard->handleInput();
+
+    if (keyboard->isComplete()) {
+      startSearch(keyboard->getText());
+      return;
+    }
+    if (keyboard->isCancelled()) {
+      onGoBack();
+      return;
+    }
+    updateRequired = true;
+    return;
+  }
+
+  if (state == SEARCHING) {
+    if (inputManager.wasPressed(InputManager::BTN_BACK)) {
+      stopped = true;
+      showResults();
+      return;
+    }
+    searchNextItem();
+    return;
+  }
+
+  const auto& results = search.getResults();
+  const int itemCount = static_cast<int>(results.size());
+  const bool prevReleased =
+      inputManager.wasReleased(InputManager::BTN_UP) || inputManager.wasReleased(InputManager::BTN_LEFT);
+  const bool nextReleased =
+      inputManager.wasReleased(InputManager::BTN_DOWN) || inputManager.wasReleased(InputManager::BTN_RIGHT);
+  const bool skipPage = inputManager.getHeldTime() > SKIP_PAGE_MS;
+
+  if (inputManager.wasPressed(InputManager::BTN_BACK)) {
+    onGoBack();
+  } else if (itemCount == 0) {
+    return;
+  } else if (inputManager.wasPressed(InputManager::BTN_CONFIRM)) {
+    onSelectResult(results[selectorIndex].spineIndex, results[selectorIndex].textOffset);
+  } else if (prevReleased) {
+    if (skipPage) {
+      selectorIndex = ((selectorIndex / PAGE_ITEMS - 1) * PAGE_ITEMS + itemCount) % itemCount;
+    } else {
+      selectorIndex = (selectorIndex + itemCount - 1) % itemCount;
+    }
+    updateRequired = true;
+  } else if (nextReleased) {
+    if (skipPage) {
+      selectorIndex = ((selectorIndex / PAGE_ITEMS + 1) * PAGE_ITEMS) % itemCount;
+    } else {
+      selectorIndex = (selectorIndex + 1) % itemCount;
+    }
+    updateRequired = true;
+  }
+}
+
+void EpubReaderSearchActivity::displayTaskLoop() {
+  while (true) {
+    if (updateRequired) {
+      updateRequired = false;
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
+      renderScreen();
+      xSemaphoreGive(renderingMutex);
+    }
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+  }
+}
+
+void EpubReaderSearchActivity::renderScreen() {
+  renderer.clearScreen();
+
+  switch (state) {
+    case QUERY_ENTRY:
+      renderer.drawCenteredText(READER_FONT_ID, 5, "Search Book", true, BOLD);
+      if (subActivity) {
+        static_cast<KeyboardEntryActivity*>(subActivity.get())->render(58);
+      }
+      break;
+    case SEARCHING:
+      renderSearching();
+      break;
+    case RESULTS:
+      renderResults();
+      break;
+  }
+
+  // Keyboard typing and list navigation only change a few rows
+  renderer.displayChanges();
+}
+
+void EpubReaderSearchActivity::renderSearching() const {
+  const auto pageHeight = renderer.getScreenHeight();
+  const auto height = renderer.getLineHeight(UI_FONT_ID);
+  const auto top = (pageHeight - height) / 2;
+
+  renderer.drawCenteredText(READER_FONT_ID, top - 30, "Searching...", true, BOLD);
+  const std::string progress = "Chapter " + std::to_string(search.getNextSpineIndex() + 1) + " of " +
+                               std::to_string(epub->getSpineItemsCount()) + ", " +
+                               std::to_string(search.getResults().size()) + " found";
+  renderer.drawCenteredText(UI_FONT_ID, top, progress.c_str(), true, REGULAR);
+  renderer.drawCenteredText(SMALL_FONT_ID, top + height + 10, "Press BACK to stop", true, REGULAR);
+}
+
+void EpubReaderSearchActivity::renderResults() const {
+  const auto pageWidth = renderer.getScreenWidth();
+  const auto pageHeight = renderer.getScreenHeight();
+  const auto& results = search.getResults();
+
+  const std::string title = "\"" + search.getQuery() + "\"";
+  renderer.drawCenteredText(READER_FONT_ID, 10, title.c_str(), true, BOLD);
+
+  if (results.empty()) {
+    const auto height = renderer.getLineHeight(UI_FONT_ID);
+    renderer.drawCenteredText(UI_FONT_ID, (pageHeight - height) / 2, stopped ? "Nothing found yet" : "Not found",
+                              true, REGULAR);
+  } else {
+    const auto pageStartIndex = selectorIndex / PAGE_ITEMS * PAGE_ITEMS;
+    renderer.fillRect(0, 60 + (selectorIndex % PAGE_ITEMS) * 30 + 2, pageWidth - 1, 30);
+    for (int i = pageStartIndex; i < static_cast<int>(results.size()) && i < pageStartIndex + PAGE_ITEMS; i++) {
+      const int y = 60 + (i % PAGE_ITEMS) * 30;
+      const int tocIndex = epub->getTocIndexForSpineIndex(results[i].spineIndex);
+      const std::string chapter = tocIndex == -1 ? "Unnamed" : epub->getTocItem(tocIndex).title;
+      renderer.drawText(UI_FONT_ID, 20, y, chapter.c_str(), i != selectorIndex);
+      if (resultPages[i] >= 0) {
+        const std::string page = "p. " + std::to_string(resultPages[i] + 1);
+        renderer.drawText(UI_FONT_ID, pageWidth - 20 - renderer.getTextWidth(UI_FONT_ID, page.c_str()), y,
+                          page.c_str(), i != selectorIndex);
+      }
+    }
+  }
+
+  std::string status = std::to_string(results.size()) + " found";
+  if (results.size() >= BookSearch::MAX_RESULTS) {
+    status += ", showing the first " + std::to_string(BookSearch::MAX_RESULTS);
+  } else if (stopped) {
+    status += ", stopped early, search again to resume";
+  }
+  renderer.drawText(SMALL_FONT_ID, 20, pageHeight - 30, status.c_str());
+}
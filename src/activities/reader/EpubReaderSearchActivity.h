@@ -0,0 +1,62 @@
+#pragma once
+#include <Epub.h>
+#include <Epub/BookSearch.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "activities/ActivityWithSubactivity.h"
+
+class Section;
+
+// Asks for a query, then searches the book a spine item per loop so BACK can stop it, then lists the hits.
+// Stopping keeps the hits found so far, searching for the same text again carries on from there.
+class EpubReaderSearchActivity final : public ActivityWithSubactivity {
+  enum State { QUERY_ENTRY, SEARCHING, RESULTS };
+
+  std::shared_ptr<Epub> epub;
+  BookSearch search;
+  TaskHandle_t displayTaskHandle = nullptr;
+  SemaphoreHandle_t renderingMutex = nullptr;
+  State state = QUERY_ENTRY;
+  bool stopped = false;
+  int selectorIndex = 0;
+  int renderedProgress = -1;
+  bool updateRequired = false;
+  // Page of each result within its chapter, -1 when the chapter hasn't been indexed for the reader's layout
+  std::vector<int> resultPages;
+  // Section with its cache metadata loaded for the reader's layout, null if there is no cache for it
+  const std::function<std::unique_ptr<Section>(int spineIndex)> loadSectionCache;
+  const std::function<void()> onGoBack;
+  const std::function<void(int spineIndex, uint32_t textOffset)> onSelectResult;
+
+  static void taskTrampoline(void* param);
+  [[noreturn]] void displayTaskLoop();
+  void renderScreen();
+  void renderSearching() const;
+  void renderResults() const;
+  void startSearch(const std::string& text);
+  void searchNextItem();
+  void showResults();
+
+ public:
+  explicit EpubReaderSearchActivity(
+      GfxRenderer& renderer, InputManager& inputManager, const std::shared_ptr<Epub>& epub,
+      const std::function<std::unique_ptr<Section>(int spineIndex)>& loadSectionCache,
+      const std::function<void()>& onGoBack,
+      const std::function<void(int spineIndex, uint32_t textOffset)>& onSelectResult)
+      : ActivityWithSubactivity("EpubReaderSearch", renderer, inputManager),
+        epub(epub),
+        search(epub, renderer),
+        loadSectionCache(loadSectionCache),
+        onGoBack(onGoBack),
+        onSelectResult(onSelectResult) {}
+  void onEnter() override;
+  void onExit() override;
+  void loop() override;
+};
@@ -153,7 +153,7 @@ void FileSelectionActivity::render() const {
 
   if (files.empty()) {
     renderer.drawText(UI_FONT_ID, 20, 60, "No EPUBs found");
-    renderer.displayBuffer();
+    renderer.displayChanges();
     return;
   }
 
@@ -169,5 +169,5 @@ void FileSelectionActivity::render() const {
     renderer.drawText(UI_FONT_ID, 20, 60 + (i % PAGE_ITEMS) * 30, item.c_str(), i != selectorIndex);
   }
 
-  renderer.displayBuffer();
+  renderer.displayChanges();
 }
@@ -9,12 +9,13 @@
 
 // Define the static settings list
 namespace {
-constexpr int settingsCount = 4;
+constexpr int settingsCount = 5;
 const SettingInfo settingsList[settingsCount] = {
     // Should match with SLEEP_SCREEN_MODE
     {"Sleep Screen", SettingType::ENUM, &CrossPointSettings::sleepScreen, {"Dark", "Light", "Custom", "Cover"}},
     {"Extra Paragraph Spacing", SettingType::TOGGLE, &CrossPointSettings::extraParagraphSpacing, {}},
     {"Short Power Button Click", SettingType::TOGGLE, &CrossPointSettings::shortPwrBtn, {}},
+    {"Page Look-ahead", SettingType::TOGGLE, &CrossPointSettings::pageLookahead, {}},
     {"Check for updates", SettingType::ACTION, nullptr, {}},
 };
 }  // namespace
@@ -173,6 +174,6 @@ void SettingsActivity::render() const {
   renderer.drawText(SMALL_FONT_ID, pageWidth - 20 - renderer.getTextWidth(SMALL_FONT_ID, CROSSPOINT_VERSION),
                     pageHeight - 30, CROSSPOINT_VERSION);
 
-  // Always use standard refresh for settings screen
-  renderer.displayBuffer();
+  // Moving the selection only touches a couple of rows, so let the renderer pick a windowed update
+  renderer.displayChanges();
 }
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 
+#include "SleepImageIndex.h"
 #include "html/FilesPageHtml.generated.h"
 #include "html/HomePageHtml.generated.h"
 
@@ -15,6 +16,9 @@ namespace {
 // Note: Items starting with "." are automatically hidden
 const char* HIDDEN_ITEMS[] = {"System Volume Information", "XTCache"};
 constexpr size_t HIDDEN_ITEMS_COUNT = sizeof(HIDDEN_ITEMS) / sizeof(HIDDEN_ITEMS[0]);
+
+// The sleep image folder itself or anything in it, but not /sleepy.bmp or /sleep-old
+bool isSleepImagePath(const String& path) { return path == "/sleep" || path.startsWith("/sleep/"); }
 }  // namespace
 
 // File listing page template - now using generated headers:
@@ -384,6 +388,9 @@ void CrossPointWebServer::handleUpload() const {
       if (uploadError.isEmpty()) {
         uploadSuccess = true;
         Serial.printf("[%lu] [WEB] Upload complete: %s (%d bytes)\n", millis(), uploadFileName.c_str(), uploadSize);
+        if (isSleepImagePath(uploadPath)) {
+          SleepImageIndex::invalidate();
+        }
       }
     }
   } else if (upload.status == UPLOAD_FILE_ABORTED) {
@@ -534,6 +541,9 @@ void CrossPointWebServer::handleDelete() const {
 
   if (success) {
     Serial.printf("[%lu] [WEB] Successfully deleted: %s\n", millis(), itemPath.c_str());
+    if (isSleepImagePath(itemPath)) {
+      SleepImageIndex::invalidate();
+    }
     server->send(200, "text/plain", "Deleted successfully");
   } else {
     Serial.printf("[%lu] [WEB] Failed to delete: %s\n", millis(), itemPath.c_str());
@@ -0,0 +1,42 @@
+#pragma once
+// Minimal host stand-in for the Arduino core, enough to build the libraries under lib/ for `pio test -e native`.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "HardwareSerial.h"
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+
+using std::max;
+using std::min;
+
+inline unsigned long millis() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long) {}
+inline void yield() {}
+
+// Heap figures are made up on the host, tests that budget memory set freeHeap themselves
+class EspClass {
+ public:
+  uint32_t freeHeap = 200 * 1024;
+  uint32_t getFreeHeap() const { return freeHeap; }
+  uint32_t getHeapSize() const { return 320 * 1024; }
+  uint32_t getMinFreeHeap() const { return freeHeap; }
+  uint32_t getMaxAllocHeap() const { return freeHeap; }
+};
+
+inline EspClass ESP;
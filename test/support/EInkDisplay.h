@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Framebuffer only, nothing is sent anywhere. Tests read back what was drawn through getFrameBuffer().
+class EInkDisplay {
+ public:
+  enum RefreshMode { FULL_REFRESH, HALF_REFRESH, FAST_REFRESH };
+  static constexpr uint16_t DISPLAY_WIDTH = 800;
+  static constexpr uint16_t DISPLAY_HEIGHT = 480;
+  static constexpr uint16_t DISPLAY_WIDTH_BYTES = DISPLAY_WIDTH / 8;
+  static constexpr uint32_t BUFFER_SIZE = DISPLAY_WIDTH_BYTES * DISPLAY_HEIGHT;
+
+  EInkDisplay() = default;
+  EInkDisplay(int, int, int, int, int, int) {}
+  void begin() {}
+  uint8_t* getFrameBuffer() const { return frameBuffer; }
+  void clearScreen(const uint8_t color = 0xFF) const { memset(frameBuffer, color, BUFFER_SIZE); }
+  void drawImage(const uint8_t*, int, int, int, int, bool = false) const {}
+  void displayBuffer(RefreshMode = FAST_REFRESH) {}
+  void displayWindow(int, int, int, int) {}
+  void grayscaleRevert() {}
+  void copyGrayscaleLsbBuffers(const uint8_t*) {}
+  void copyGrayscaleMsbBuffers(const uint8_t*) {}
+  void displayGrayBuffer() {}
+  void cleanupGrayscaleBuffers(const uint8_t*) {}
+  void deepSleep() {}
+
+ private:
+  mutable uint8_t frameBuffer[BUFFER_SIZE] = {};
+};
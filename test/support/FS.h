@@ -0,0 +1,103 @@
+#pragma once
+#include <dirent.h>
+
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+// A host file or directory, shared between copies the way the Arduino handles are
+class File : public Stream {
+  struct Handle {
+    FILE* file = nullptr;
+    DIR* dir = nullptr;
+    std::string path;
+    std::string hostPath;
+    ~Handle() {
+      if (file) fclose(file);
+      if (dir) closedir(dir);
+    }
+  };
+  std::shared_ptr<Handle> handle;
+
+ public:
+  File() = default;
+  File(FILE* file, DIR* dir, const std::string& path, const std::string& hostPath) : handle(new Handle) {
+    handle->file = file;
+    handle->dir = dir;
+    handle->path = path;
+    handle->hostPath = hostPath;
+  }
+
+  size_t write(const uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, const size_t size) override {
+    return handle && handle->file ? fwrite(buffer, 1, size, handle->file) : 0;
+  }
+  using Print::write;
+
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  size_t read(uint8_t* buffer, const size_t size) {
+    return handle && handle->file ? fread(buffer, 1, size, handle->file) : 0;
+  }
+  size_t readBytes(char* buffer, const size_t length) override {
+    return read(reinterpret_cast<uint8_t*>(buffer), length);
+  }
+  int peek() override {
+    if (!handle || !handle->file) return -1;
+    const int c = fgetc(handle->file);
+    if (c != EOF) ungetc(c, handle->file);
+    return c == EOF ? -1 : c;
+  }
+  int available() override { return static_cast<int>(size() - position()); }
+
+  bool seek(const uint32_t pos, const SeekMode mode = SeekSet) {
+    const int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+    return handle && handle->file && fseek(handle->file, pos, whence) == 0;
+  }
+  size_t position() const { return handle && handle->file ? ftell(handle->file) : 0; }
+  size_t size() const {
+    if (!handle || !handle->file) return 0;
+    const long current = ftell(handle->file);
+    fseek(handle->file, 0, SEEK_END);
+    const long end = ftell(handle->file);
+    fseek(handle->file, current, SEEK_SET);
+    return end;
+  }
+  void flush() {
+    if (handle && handle->file) fflush(handle->file);
+  }
+  void close() { handle.reset(); }
+
+  const char* path() const { return handle ? handle->path.c_str() : ""; }
+  const char* name() const {
+    if (!handle) return "";
+    const size_t slash = handle->path.rfind('/');
+    return handle->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+  }
+  bool isDirectory() const { return handle && handle->dir; }
+  File openNextFile();
+  void rewindDirectory() {
+    if (isDirectory()) rewinddir(handle->dir);
+  }
+  time_t getLastWrite() const;
+
+  explicit operator bool() const { return handle != nullptr; }
+};
+
+namespace fs {
+using ::File;
+}
+
+// Directory iteration needs SD to open the entries
+#include "SD.h"
@@ -0,0 +1,36 @@
+#pragma once
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size-- > 0 && write(*buffer++) == 1) {
+      written++;
+    }
+    return written;
+  }
+  size_t write(const char* str) { return write(reinterpret_cast<const uint8_t*>(str), strlen(str)); }
+  size_t write(const char* buffer, const size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+  size_t print(const char* str) { return write(str); }
+  size_t println(const char* str = "") { return write(str) + write("\n"); }
+
+  int printf(const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > 0) {
+      write(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+    }
+    return length;
+  }
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FS.h"
+
+// The SD card is a host directory, tests point root at a scratch directory before touching any file
+class SDFS {
+ public:
+  std::string root = "/tmp";
+
+  std::string hostPath(const char* path) const { return root + (path[0] == '/' ? "" : "/") + path; }
+
+  bool begin() { return true; }
+  bool exists(const char* path) const {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+  }
+  bool exists(const std::string& path) const { return exists(path.c_str()); }
+  bool mkdir(const char* path) const { return ::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path); }
+  bool remove(const char* path) const { return unlink(hostPath(path).c_str()) == 0; }
+  bool rmdir(const char* path) const { return ::rmdir(hostPath(path).c_str()) == 0; }
+  bool rename(const char* from, const char* to) const {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+  }
+
+  File open(const char* path, const char* mode = FILE_READ, const bool create = false) const {
+    const std::string host = hostPath(path);
+    struct stat st;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      DIR* dir = opendir(host.c_str());
+      return dir ? File(nullptr, dir, path, host) : File();
+    }
+    if (mode[0] == 'r' && !create && stat(host.c_str(), &st) != 0) {
+      return File();
+    }
+    FILE* file = fopen(host.c_str(), mode[0] == 'w' ? "w+b" : mode[0] == 'a' ? "a+b" : "rb");
+    return file ? File(file, nullptr, path, host) : File();
+  }
+  File open(const std::string& path, const char* mode = FILE_READ, const bool create = false) const {
+    return open(path.c_str(), mode, create);
+  }
+};
+
+inline SDFS SD;
+
+inline File File::openNextFile() {
+  if (!isDirectory()) return File();
+  while (const dirent* entry = readdir(handle->dir)) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    const std::string child = handle->path + (handle->path.back() == '/' ? "" : "/") + entry->d_name;
+    return SD.open(child.c_str());
+  }
+  return File();
+}
+
+inline time_t File::getLastWrite() const {
+  struct stat st;
+  return handle && stat(handle->hostPath.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char* buffer, const size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      const int c = read();
+      if (c < 0) {
+        break;
+      }
+      buffer[count++] = static_cast<char>(c);
+    }
+    return count;
+  }
+  size_t readBytes(uint8_t* buffer, const size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstring>
+#include <string>
+
+class String : public std::string {
+ public:
+  String() = default;
+  String(const char* str) : std::string(str) {}
+  String(const std::string& str) : std::string(str) {}
+  bool startsWith(const char* prefix) const { return rfind(prefix, 0) == 0; }
+  bool endsWith(const char* suffix) const {
+    const size_t length = strlen(suffix);
+    return size() >= length && compare(size() - length, length, suffix) == 0;
+  }
+};
@@ -0,0 +1,267 @@
+#include <Epub.h>
+#include <Epub/BookSearch.h>
+#include <Epub/CssRuleTable.h>
+#include <Epub/Page.h>
+#include <Epub/parsers/ChapterHtmlSlimParser.h>
+#include <GfxRenderer.h>
+#include <SD.h>
+#include <builtinFonts/bookerly_2b.h>
+#include <builtinFonts/bookerly_bold_2b.h>
+#include <builtinFonts/bookerly_bold_italic_2b.h>
+#include <builtinFonts/bookerly_italic_2b.h>
+#include <miniz.h>
+#include <unity.h>
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+
+// Searches a generated 120 chapter book and checks the text offsets words are found at against the page offsets the
+// layout records, then reports search speed. Chapters have hidden spans and images in the middle of words, which
+// extraction and layout have to handle the same way for the offsets to line up.
+
+namespace {
+// Paths on the stand-in SD card
+constexpr char CARD_DIR[] = "/tmp/test_book_search";
+constexpr char BOOK_PATH[] = "/book.epub";
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char CHAPTER_PATH[] = "/chapter.xhtml";
+constexpr char PAGES_PATH[] = "/pages.bin";
+constexpr int CHAPTERS = 120;
+constexpr int PARAGRAPHS_PER_CHAPTER = 60;
+constexpr int LAYOUT_CHECK_CHAPTERS = 8;
+constexpr int FONT_ID = 1;
+constexpr char QUERY[] = "Lighthouse  Keeper";
+
+const char* const VOCABULARY[] = {"the",    "of",     "and",    "a",      "to",     "in",     "he",     "was",
+                                   "that",   "it",     "his",    "her",    "you",    "with",   "as",     "for",
+                                   "had",    "is",     "on",     "at",     "harbour", "window", "river", "garden",
+                                   "letter", "ship",   "storm",  "keeper", "lantern", "evening", "light", "house",
+                                   "Élodie", "café",   "naïve",  "Straße", "Москва", "Ελλάδα"};
+constexpr int VOCABULARY_SIZE = sizeof(VOCABULARY) / sizeof(VOCABULARY[0]);
+
+EpdFont regular(&bookerly_2b);
+EpdFont bold(&bookerly_bold_2b);
+EpdFont italic(&bookerly_italic_2b);
+EpdFont boldItalic(&bookerly_bold_italic_2b);
+EpdFontFamily fontFamily(&regular, &bold, &italic, &boldItalic);
+EInkDisplay display;
+GfxRenderer renderer(display);
+
+std::shared_ptr<Epub> epub;
+// Visible copies of the query planted in the book
+size_t plantedCount = 0;
+
+// Small fixed LCG so every run builds the same book
+uint32_t randomState = 7;
+int nextRandom(const int range) {
+  randomState = randomState * 1103515245u + 12345u;
+  return static_cast<int>((randomState >> 16) % range);
+}
+
+std::string makeChapter(const int index) {
+  std::string chapter = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                        "<html xmlns=\"http://www.w3.org/1999/xhtml\"><head><title>Chapter</title>"
+                        "<link rel=\"stylesheet\" type=\"text/css\" href=\"style.css\"/></head><body>\n<h2>Chapter " +
+                        std::to_string(index + 1) + "</h2>\n";
+  for (int p = 0; p < PARAGRAPHS_PER_CHAPTER; p++) {
+    chapter += "<p>";
+    const int words = 40 + nextRandom(70);
+    for (int w = 0; w < words; w++) {
+      chapter += VOCABULARY[nextRandom(VOCABULARY_SIZE)];
+      chapter += ' ';
+    }
+    const int extra = nextRandom(100);
+    if (extra < 2) {
+      chapter += "the <i>Lighthouse</i> keeper ";
+      plantedCount++;
+    } else if (extra < 4) {
+      chapter += "<span class=\"hidden\">lighthouse keeper</span> ";
+    } else if (extra < 7) {
+      // Splits the word in two whether or not the image can be shown
+      chapter += "light<img src=\"rule.png\" alt=\"\"/>house keeper ";
+    }
+    chapter += "end.</p>\n";
+  }
+  chapter += "</body></html>\n";
+  return chapter;
+}
+
+bool addEntry(mz_zip_archive* zip, const char* name, const std::string& data) {
+  return mz_zip_writer_add_mem(zip, name, data.data(), data.size(), MZ_DEFAULT_COMPRESSION);
+}
+
+bool writeBook() {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, SD.hostPath(BOOK_PATH).c_str(), 0)) {
+    return false;
+  }
+  std::string manifest = "<item id=\"css\" href=\"style.css\" media-type=\"text/css\"/>"
+                         "<item id=\"nav\" href=\"nav.xhtml\" media-type=\"application/xhtml+xml\" "
+                         "properties=\"nav\"/>";
+  std::string spine;
+  bool ok = addEntry(&zip, "mimetype", "application/epub+zip") &&
+            addEntry(&zip, "META-INF/container.xml",
+                     "<?xml version=\"1.0\"?><container version=\"1.0\" "
+                     "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+                     "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles>"
+                     "</container>") &&
+            addEntry(&zip, "OEBPS/style.css", ".hidden { display: none }\n") &&
+            // The undeclared entity makes the nav fail to parse as XML after its first entry
+            addEntry(&zip, "OEBPS/nav.xhtml",
+                     "<html xmlns=\"http://www.w3.org/1999/xhtml\" xmlns:epub=\"http://www.idpf.org/2007/ops\"><body>"
+                     "<nav epub:type=\"toc\"><ol><li><a href=\"c0.xhtml\">One</a></li>"
+                     "<li><a href=\"c1.xhtml\">Chapter&nbsp;Two</a></li></ol></nav></body></html>");
+  for (int i = 0; ok && i < CHAPTERS; i++) {
+    const std::string id = "c" + std::to_string(i);
+    manifest += "<item id=\"" + id + "\" href=\"" + id + ".xhtml\" media-type=\"application/xhtml+xml\"/>";
+    spine += "<itemref idref=\"" + id + "\"/>";
+    ok = addEntry(&zip, ("OEBPS/" + id + ".xhtml").c_str(), makeChapter(i));
+  }
+  ok = ok && addEntry(&zip, "OEBPS/content.opf",
+                      "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\">"
+                      "<metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>Long Book</dc:title>"
+                      "</metadata><manifest>" +
+                          manifest + "</manifest><spine>" + spine + "</spine></package>");
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  mz_zip_writer_end(&zip);
+  return ok;
+}
+
+double secondsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// A nav that isn't well formed XML doesn't stop the book from opening, it just has no chapter list
+void test_broken_nav_leaves_the_toc_empty() {
+  TEST_ASSERT_EQUAL(CHAPTERS, epub->getSpineItemsCount());
+  TEST_ASSERT_EQUAL(0, epub->getTocItemsCount());
+}
+
+// Every page has to start at a word offset, or at the end of the chapter, whether or not the images resolve
+void test_page_offsets_are_word_offsets() {
+  CssRuleTable cssRules;
+  TEST_ASSERT_TRUE(cssRules.load(epub->getCssRuleTablePath()));
+  const std::string chapterPath = CHAPTER_PATH;
+
+  for (int i = 0; i < LAYOUT_CHECK_CHAPTERS; i++) {
+    const std::string href = epub->getSpineItem(i).href;
+    std::set<uint32_t> wordOffsets;
+    {
+      const auto stream = epub->openItemStream(href, 1024);
+      TEST_ASSERT_NOT_NULL(stream.get());
+      ChapterHtmlSlimParser parser(chapterPath, renderer, 0, 1.0f, 0, 0, 0, 0, false, nullptr);
+      parser.setCssRuleTable(&cssRules);
+      TEST_ASSERT_TRUE(parser.extractWords(*stream, [&](const char*, const size_t length, const uint32_t offset) {
+        wordOffsets.insert(offset);
+        wordOffsets.insert(offset + length + 1);
+        return true;
+      }));
+    }
+
+    File file = SD.open(CHAPTER_PATH, FILE_WRITE);
+    TEST_ASSERT_TRUE(epub->readItemContentsToStream(href, file, 1024));
+    file.close();
+
+    for (const bool imagesResolve : {true, false}) {
+      ChapterHtmlSlimParser parser(
+          chapterPath, renderer, FONT_ID, 0.95f, 8, 10, 22, 10, true, [](std::unique_ptr<Page>) {},
+          [imagesResolve](const char*, int, int, std::string* imagePath, int* width, int* height) {
+            *imagePath = "rule.bmp";
+            *width = 200;
+            *height = 40;
+            return imagesResolve;
+          });
+      parser.setBackend(ChapterHtmlSlimParser::PULL_TOKENIZER);
+      parser.setCssRuleTable(&cssRules);
+      TEST_ASSERT_TRUE(parser.parseAndBuildPages());
+      TEST_ASSERT_TRUE(parser.getPageTextOffsets().size() > 1);
+      for (const uint32_t offset : parser.getPageTextOffsets()) {
+        TEST_ASSERT_TRUE(wordOffsets.count(offset) == 1);
+      }
+    }
+  }
+}
+
+// Expat decodes entities itself, the tokenizer leaves them for the parser, either way they're decoded exactly once
+void test_entities_are_decoded_once() {
+  const std::string chapterPath = CHAPTER_PATH;
+  File file = SD.open(CHAPTER_PATH, FILE_WRITE);
+  const std::string chapter = "<html><body><p>AT&amp;T writes &amp;lt;p&amp;gt; for &lt;p&gt;</p></body></html>";
+  file.write(reinterpret_cast<const uint8_t*>(chapter.data()), chapter.size());
+  file.close();
+
+  for (const auto backend : {ChapterHtmlSlimParser::EXPAT, ChapterHtmlSlimParser::PULL_TOKENIZER}) {
+    File pages = SD.open(PAGES_PATH, FILE_WRITE);
+    ChapterHtmlSlimParser parser(chapterPath, renderer, FONT_ID, 0.95f, 8, 10, 22, 10, true,
+                                 [&pages](std::unique_ptr<Page> page) { page->serialize(pages); });
+    parser.setBackend(backend);
+    TEST_ASSERT_TRUE(parser.parseAndBuildPages());
+    pages.close();
+
+    // Words are stored as plain strings, so the serialized page can be searched for them
+    std::string bytes;
+    pages = SD.open(PAGES_PATH);
+    for (int c = pages.read(); c >= 0; c = pages.read()) {
+      bytes += static_cast<char>(c);
+    }
+    pages.close();
+    for (const char* word : {"AT&T", "&lt;p&gt;", "<p>"}) {
+      TEST_ASSERT_TRUE(bytes.find(word) != std::string::npos);
+    }
+    TEST_ASSERT_TRUE(bytes.find("&amp;") == std::string::npos);
+  }
+}
+
+void test_report_search_speed() {
+  SD.remove((epub->getCachePath() + "/search.bin").c_str());
+  BookSearch search(epub, renderer);
+  TEST_ASSERT_TRUE(search.begin(QUERY));
+
+  const auto start = std::chrono::steady_clock::now();
+  while (!search.isComplete()) {
+    TEST_ASSERT_TRUE(search.searchNextItem([] { return false; }));
+  }
+  const double seconds = secondsSince(start);
+
+  // Hidden copies aren't found and the ones split by an image aren't the query any more
+  TEST_ASSERT_EQUAL(std::min(plantedCount, BookSearch::MAX_RESULTS), search.getResults().size());
+
+  size_t bookBytes = 0;
+  for (int i = 0; i < CHAPTERS; i++) {
+    size_t size = 0;
+    epub->getItemSize(epub->getSpineItem(i).href, &size);
+    bookBytes += size;
+  }
+  char message[160];
+  snprintf(message, sizeof(message), "%d chapters, %zu KB: %zu hits in %.1f ms, %.2f ms per chapter, %.1f MB/s",
+           CHAPTERS, bookBytes / 1024, search.getResults().size(), seconds * 1000, seconds * 1000 / CHAPTERS,
+           bookBytes / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  SD.root = CARD_DIR;
+  Serial.quiet = true;
+  SD.mkdir("/");
+  SD.mkdir(CACHE_DIR);
+  renderer.insertFont(FONT_ID, fontFamily);
+
+  UNITY_BEGIN();
+  if (writeBook()) {
+    epub = std::make_shared<Epub>(BOOK_PATH, CACHE_DIR);
+    epub->clearCache();
+    if (epub->load()) {
+      RUN_TEST(test_broken_nav_leaves_the_toc_empty);
+      RUN_TEST(test_page_offsets_are_word_offsets);
+      RUN_TEST(test_entities_are_decoded_once);
+      RUN_TEST(test_report_search_speed);
+    }
+  }
+  return UNITY_END();
+}
@@ -0,0 +1,98 @@
+#include <Epub/CssRuleTable.h>
+#include <Epub/blocks/TextBlock.h>
+#include <Epub/parsers/CssParser.h>
+#include <SD.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+// Streams stylesheets through CssParser, round trips the rule table through a file and checks the looked up styles
+
+namespace {
+constexpr char TABLE_PATH[] = "/css.bin";
+// Same length and the same FNV-1a hash, only the check hash tells them apart
+constexpr char COLLIDING_SELECTOR_A[] = ".c1022789";
+constexpr char COLLIDING_SELECTOR_B[] = ".c1239192";
+
+bool buildTable(const char* stylesheet, CssRuleTable& table) {
+  CssRuleTable rules;
+  CssParser parser(&rules);
+  // Small chunks so rules straddle writes the way they do when read from the zip
+  for (size_t i = 0; i < strlen(stylesheet); i += 3) {
+    parser.write(reinterpret_cast<const uint8_t*>(stylesheet + i), std::min<size_t>(3, strlen(stylesheet) - i));
+  }
+  return rules.writeToFile(TABLE_PATH) && table.load(TABLE_PATH);
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() { SD.remove(TABLE_PATH); }
+
+void test_cascade() {
+  CssRuleTable table;
+  TEST_ASSERT_TRUE(buildTable("/* comment { } */ @charset \"utf-8\";\n"
+                              "P { text-align: justify }\n"
+                              ".center, h1 { text-align: center; }\n"
+                              "p.note { font-style: italic; text-align: right !important }\n"
+                              "@media print { p { display: none } }\n"
+                              "div > p, #id, a:hover { font-weight: bold }\n"
+                              ".hidden { display: none }\n",
+                              table));
+
+  CssStyle style = table.lookup("p", nullptr);
+  TEST_ASSERT_EQUAL(TextBlock::JUSTIFIED, style.textAlign);
+  TEST_ASSERT_FALSE(style.hidden);
+  TEST_ASSERT_FALSE(style.bold);
+
+  style = table.lookup("h1", nullptr);
+  TEST_ASSERT_EQUAL(TextBlock::CENTER_ALIGN, style.textAlign);
+
+  style = table.lookup("p", "note center");
+  TEST_ASSERT_EQUAL(TextBlock::RIGHT_ALIGN, style.textAlign);
+  TEST_ASSERT_TRUE(style.italic);
+
+  style = table.lookup("span", " hidden ");
+  TEST_ASSERT_TRUE(style.hidden);
+
+  TEST_ASSERT_TRUE(table.lookup("span", "note").isEmpty());
+}
+
+void test_colliding_selectors_stay_apart() {
+  const char* classA = COLLIDING_SELECTOR_A + 1;
+  const char* classB = COLLIDING_SELECTOR_B + 1;
+  const CssSelectorKey keyA =
+      CssRuleTable::extendKey(CssRuleTable::EMPTY_KEY, COLLIDING_SELECTOR_A, strlen(COLLIDING_SELECTOR_A));
+  const CssSelectorKey keyB =
+      CssRuleTable::extendKey(CssRuleTable::EMPTY_KEY, COLLIDING_SELECTOR_B, strlen(COLLIDING_SELECTOR_B));
+  TEST_ASSERT_EQUAL(keyA.hash, keyB.hash);
+  TEST_ASSERT_FALSE(keyA == keyB);
+
+  CssRuleTable table;
+  const std::string both = std::string(COLLIDING_SELECTOR_A) + " { font-weight: bold }\n" + COLLIDING_SELECTOR_B +
+                           " { font-style: italic }\n";
+  TEST_ASSERT_TRUE(buildTable(both.c_str(), table));
+  CssStyle style = table.lookup("p", classA);
+  TEST_ASSERT_TRUE(style.bold);
+  TEST_ASSERT_FALSE(style.italic);
+  style = table.lookup("p", classB);
+  TEST_ASSERT_FALSE(style.bold);
+  TEST_ASSERT_TRUE(style.italic);
+
+  // Probing for a selector that isn't in the table lands on the other one's slot and has to miss
+  CssRuleTable onlyA;
+  TEST_ASSERT_TRUE(buildTable((std::string(COLLIDING_SELECTOR_A) + " { font-weight: bold }").c_str(), onlyA));
+  TEST_ASSERT_TRUE(onlyA.lookup("p", classA).bold);
+  TEST_ASSERT_TRUE(onlyA.lookup("p", classB).isEmpty());
+}
+
+int main() {
+  SD.root = "/tmp";
+  Serial.quiet = true;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_cascade);
+  RUN_TEST(test_colliding_selectors_stay_apart);
+  return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include <GhostingTracker.h>
+#include <unity.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// The refresh policy fed with framebuffers recorded from the reader: two full text pages, two chapter end pages and a
+// page with a dithered illustration. Frames are 800x480 PBM files (1 is black), the framebuffer has 0 for black.
+
+namespace {
+constexpr int WIDTH_BYTES = 100;
+constexpr int HEIGHT = 480;
+constexpr uint32_t SCREEN_PIXELS = WIDTH_BYTES * 8 * HEIGHT;
+// Page turns the reader used to take between slow refreshes, whatever was on them
+constexpr int OLD_PAGES_PER_REFRESH = 15;
+
+std::vector<uint8_t> loadFrame(const char* name) {
+  std::string path = __FILE__;
+  path = path.substr(0, path.rfind('/') + 1) + "frames/" + name + ".pbm";
+  std::vector<uint8_t> frame;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return frame;
+  }
+  int width = 0;
+  int height = 0;
+  if (fscanf(file, "P4 %d %d", &width, &height) == 2 && width == WIDTH_BYTES * 8 && height == HEIGHT) {
+    fgetc(file);
+    frame.resize(WIDTH_BYTES * HEIGHT);
+    if (fread(frame.data(), 1, frame.size(), file) != frame.size()) {
+      frame.clear();
+    }
+    for (uint8_t& byte : frame) {
+      byte = ~byte;
+    }
+  }
+  fclose(file);
+  return frame;
+}
+
+std::vector<uint8_t> textA, textB, sparseA, sparseB, image;
+
+// Turns pages cycling through frames, starting right after a slow refresh, until the tracker asks for the next one
+int pagesUntilFullRefresh(const std::vector<const std::vector<uint8_t>*>& frames) {
+  GhostingTracker tracker(WIDTH_BYTES, HEIGHT);
+  tracker.observe(frames.back()->data());
+  tracker.onFullRefresh();
+  for (int page = 1; page <= GhostingTracker::MAX_PAGES_BETWEEN_FULL_REFRESH; page++) {
+    tracker.observe(frames[page % frames.size()]->data());
+    if (tracker.shouldFullRefresh()) {
+      return page;
+    }
+  }
+  return -1;
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_frames_load() {
+  for (const auto* frame : {&textA, &textB, &sparseA, &sparseB, &image}) {
+    TEST_ASSERT_EQUAL(WIDTH_BYTES * HEIGHT, frame->size());
+  }
+}
+
+void test_budget_decision() {
+  TEST_ASSERT_FALSE(GhostingTracker::exceedsBudget(0, 0, 0, SCREEN_PIXELS));
+  TEST_ASSERT_FALSE(GhostingTracker::exceedsBudget(SCREEN_PIXELS - 1, SCREEN_PIXELS / 2 - 1, 29, SCREEN_PIXELS));
+  TEST_ASSERT_TRUE(GhostingTracker::exceedsBudget(SCREEN_PIXELS * 12 / 10, 0, 1, SCREEN_PIXELS));
+  TEST_ASSERT_TRUE(GhostingTracker::exceedsBudget(0, SCREEN_PIXELS * 6 / 10, 1, SCREEN_PIXELS));
+  TEST_ASSERT_TRUE(
+      GhostingTracker::exceedsBudget(0, 0, GhostingTracker::MAX_PAGES_BETWEEN_FULL_REFRESH, SCREEN_PIXELS));
+}
+
+void test_first_page_gets_full_refresh() {
+  GhostingTracker tracker(WIDTH_BYTES, HEIGHT);
+  tracker.observe(textA.data());
+  TEST_ASSERT_TRUE(tracker.shouldFullRefresh());
+  tracker.onFullRefresh();
+  tracker.observe(textB.data());
+  TEST_ASSERT_FALSE(tracker.shouldFullRefresh());
+}
+
+void test_requested_full_refresh() {
+  GhostingTracker tracker(WIDTH_BYTES, HEIGHT);
+  tracker.observe(textA.data());
+  tracker.onFullRefresh();
+  tracker.requestFullRefresh();
+  tracker.observe(textA.data());
+  TEST_ASSERT_TRUE(tracker.shouldFullRefresh());
+}
+
+void test_unchanged_frames_wait_for_page_limit() {
+  TEST_ASSERT_EQUAL(GhostingTracker::MAX_PAGES_BETWEEN_FULL_REFRESH, pagesUntilFullRefresh({&textA}));
+}
+
+void test_text_pages_keep_old_cadence() {
+  const int pages = pagesUntilFullRefresh({&textA, &textB});
+  TEST_ASSERT_GREATER_OR_EQUAL(OLD_PAGES_PER_REFRESH - 5, pages);
+  TEST_ASSERT_LESS_OR_EQUAL(OLD_PAGES_PER_REFRESH + 5, pages);
+}
+
+void test_sparse_pages_skip_full_refreshes() {
+  const int pages = pagesUntilFullRefresh({&sparseA, &sparseB});
+  TEST_ASSERT_GREATER_THAN(OLD_PAGES_PER_REFRESH, pages);
+}
+
+void test_image_pages_refresh_sooner() {
+  const int pages = pagesUntilFullRefresh({&image, &textA});
+  TEST_ASSERT_GREATER_THAN(0, pages);
+  TEST_ASSERT_LESS_THAN(OLD_PAGES_PER_REFRESH / 2, pages);
+}
+
+void test_report_cadence() {
+  char message[160];
+  snprintf(message, sizeof(message), "pages per slow refresh: text %d, chapter ends %d, text with images %d",
+           pagesUntilFullRefresh({&textA, &textB}), pagesUntilFullRefresh({&sparseA, &sparseB}),
+           pagesUntilFullRefresh({&image, &textA}));
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  textA = loadFrame("text_a");
+  textB = loadFrame("text_b");
+  sparseA = loadFrame("sparse_a");
+  sparseB = loadFrame("sparse_b");
+  image = loadFrame("image");
+
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_load);
+  RUN_TEST(test_budget_decision);
+  RUN_TEST(test_first_page_gets_full_refresh);
+  RUN_TEST(test_requested_full_refresh);
+  RUN_TEST(test_unchanged_frames_wait_for_page_limit);
+  RUN_TEST(test_text_pages_keep_old_cadence);
+  RUN_TEST(test_sparse_pages_skip_full_refreshes);
+  RUN_TEST(test_image_pages_refresh_sooner);
+  RUN_TEST(test_report_cadence);
+  return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include <GifToBmpConverter.h>
+#include <SD.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+// Decodes the fixtures to 2-bit BMPs and checks every pixel's grey level. All of them are 32x24 with a 4 entry color
+// table at exactly 0, 85, 170 and 255, and LZW data from Pillow's encoder:
+// - local_table.gif: index (x / 8 + y / 6) % 4, the global table is all black and the image has its own local table
+// - transparent.gif: the same image with the grey levels as the global table and index 0 (black) transparent
+// - runs.gif: black above row 12 and light grey below, the runs make the encoder send codes one step ahead of the
+//   decoder's table (the KwKwK case)
+// - truncated.gif: the global table version of the first image, cut off half way through the image data
+
+namespace {
+constexpr int BMP_HEADER_SIZE = 70;
+constexpr int WIDTH = 32;
+constexpr int HEIGHT = 24;
+
+class BufferPrint final : public Print {
+ public:
+  std::vector<uint8_t> data;
+  size_t write(const uint8_t c) override {
+    data.push_back(c);
+    return 1;
+  }
+};
+
+struct Bmp {
+  bool ok = false;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> data;
+
+  // Palette index, 0 is black and 3 is white
+  int level(const int x, const int y) const {
+    const int bytesPerRow = (width * 2 + 31) / 32 * 4;
+    const uint8_t byte = data[BMP_HEADER_SIZE + y * bytesPerRow + x / 4];
+    return byte >> (6 - (x % 4) * 2) & 0x03;
+  }
+};
+
+int32_t readInt32(const std::vector<uint8_t>& data, const size_t offset) {
+  return static_cast<int32_t>(data[offset] | data[offset + 1] << 8 | data[offset + 2] << 16 | data[offset + 3] << 24);
+}
+
+Bmp decode(const char* name) {
+  Bmp bmp;
+  File file = SD.open((std::string("/") + name).c_str());
+  if (!file) {
+    return bmp;
+  }
+  BufferPrint out;
+  bmp.ok = GifToBmpConverter::gifStreamToBmpStream(file, out, 0, 0);
+  file.close();
+  if (bmp.ok && out.data.size() >= BMP_HEADER_SIZE) {
+    bmp.width = readInt32(out.data, 18);
+    // Top-down BMPs store a negative height
+    bmp.height = -readInt32(out.data, 22);
+    bmp.data = std::move(out.data);
+  }
+  return bmp;
+}
+
+int stripeLevel(const int x, const int y) { return (x / 8 + y / 6) % 4; }
+
+template <typename Expected>
+void checkLevels(const Bmp& bmp, const Expected& expected) {
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(WIDTH, bmp.width);
+  TEST_ASSERT_EQUAL(HEIGHT, bmp.height);
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL(expected(x, y), bmp.level(x, y));
+    }
+  }
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_local_table_replaces_global() { checkLevels(decode("local_table.gif"), stripeLevel); }
+
+void test_transparent_index_is_white() {
+  checkLevels(decode("transparent.gif"), [](const int x, const int y) {
+    const int level = stripeLevel(x, y);
+    return level == 0 ? 3 : level;
+  });
+}
+
+void test_code_ahead_of_table() {
+  checkLevels(decode("runs.gif"), [](int, const int y) { return y < HEIGHT / 2 ? 0 : 2; });
+}
+
+void test_truncated_data_leaves_background() {
+  const Bmp bmp = decode("truncated.gif");
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(WIDTH, bmp.width);
+  TEST_ASSERT_EQUAL(HEIGHT, bmp.height);
+
+  // Rows decoded before the cut are intact, every row after it is white
+  int decodedRows = 0;
+  while (decodedRows < HEIGHT && bmp.level(0, decodedRows) == stripeLevel(0, decodedRows)) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL(stripeLevel(x, decodedRows), bmp.level(x, decodedRows));
+    }
+    decodedRows++;
+  }
+  TEST_ASSERT_TRUE(decodedRows > 0);
+  TEST_ASSERT_TRUE(decodedRows < HEIGHT);
+  for (int y = decodedRows; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL(3, bmp.level(x, y));
+    }
+  }
+}
+
+int main() {
+  const std::string path = __FILE__;
+  SD.root = path.substr(0, path.rfind('/')) + "/fixtures";
+  Serial.quiet = true;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_local_table_replaces_global);
+  RUN_TEST(test_transparent_index_is_white);
+  RUN_TEST(test_code_ahead_of_table);
+  RUN_TEST(test_truncated_data_leaves_background);
+  return UNITY_END();
+}
@@ -0,0 +1,124 @@
+#include <EpdFont.h>
+#include <Utf8.h>
+#include <builtinFonts/bookerly_2b.h>
+#include <builtinFonts/bookerly_bold_2b.h>
+#include <builtinFonts/bookerly_bold_italic_2b.h>
+#include <builtinFonts/bookerly_italic_2b.h>
+#include <builtinFonts/pixelarial14.h>
+#include <builtinFonts/ubuntu_10.h>
+#include <builtinFonts/ubuntu_bold_10.h>
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// EpdFont::getGlyph checked against the linear interval scan it replaced, then both timed on Latin, accented and
+// Cyrillic text. Run with `pio test -e native -f test_glyph_lookup -v` to see the timings.
+
+namespace {
+const EpdFontData* const FONTS[] = {&bookerly_2b,        &bookerly_bold_2b, &bookerly_italic_2b, &bookerly_bold_italic_2b,
+                                    &pixelarial14,       &ubuntu_10,        &ubuntu_bold_10};
+constexpr int ROUNDS = 2000;
+
+const EpdGlyph* linearGetGlyph(const EpdFontData* data, const uint32_t cp) {
+  for (uint32_t i = 0; i < data->intervalCount; i++) {
+    const EpdUnicodeInterval* interval = &data->intervals[i];
+    if (cp >= interval->first && cp <= interval->last) {
+      return &data->glyph[interval->offset + (cp - interval->first)];
+    }
+  }
+  return nullptr;
+}
+
+const char* const LATIN =
+    "It was the best of times, it was the worst of times, it was the age of wisdom, it was the age of foolishness, it "
+    "was the epoch of belief, it was the epoch of incredulity, it was the season of Light, it was the season of Darkness";
+const char* const ACCENTED =
+    "Je suis allé à la fenêtre pour voir où était passé le garçon; Straße, Ærø, Øresund, naïve façade, déjà vu, "
+    "Ångström, Łódź, Dvořák, Škoda, Čapek, Żółć, crème brûlée et l'œuvre complète de Molière à l'été.";
+const char* const CYRILLIC =
+    "Все счастливые семьи похожи друг на друга, каждая несчастливая семья несчастлива по-своему. Всё смешалось в доме "
+    "Облонских. Жена узнала, что муж был в связи с бывшею в их доме француженкою-гувернанткой.";
+
+template <typename Lookup>
+double timeLookups(const char* text, const Lookup& lookup, uint32_t& checksum) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < ROUNDS; round++) {
+    const auto* cursor = reinterpret_cast<const uint8_t*>(text);
+    uint32_t cp;
+    while ((cp = utf8NextCodepoint(&cursor))) {
+      const EpdGlyph* glyph = lookup(cp);
+      checksum += glyph ? glyph->advanceX : 1;
+    }
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t codepointCount(const char* text) {
+  const auto* cursor = reinterpret_cast<const uint8_t*>(text);
+  size_t count = 0;
+  while (utf8NextCodepoint(&cursor)) {
+    count++;
+  }
+  return count;
+}
+
+void benchmark(const char* label, const char* text) {
+  const EpdFont font(&bookerly_2b);
+  uint32_t linearChecksum = 0;
+  uint32_t checksum = 0;
+  const double linearNs =
+      timeLookups(text, [](const uint32_t cp) { return linearGetGlyph(&bookerly_2b, cp); }, linearChecksum);
+  const double ns = timeLookups(text, [&font](const uint32_t cp) { return font.getGlyph(cp); }, checksum);
+  TEST_ASSERT_EQUAL_UINT32(linearChecksum, checksum);
+
+  const double lookups = static_cast<double>(codepointCount(text)) * ROUNDS;
+  char message[160];
+  snprintf(message, sizeof(message), "%-8s linear scan %6.1f ns/glyph, lookup %6.1f ns/glyph (%.1fx)", label,
+           linearNs / lookups, ns / lookups, linearNs / ns);
+  TEST_MESSAGE(message);
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_builtin_fonts_carry_latin1_table() {
+  for (const EpdFontData* data : FONTS) {
+    TEST_ASSERT_NOT_NULL(data->latin1Lookup);
+  }
+}
+
+void test_lookup_matches_linear_scan() {
+  for (const EpdFontData* data : FONTS) {
+    const EpdFont font(data);
+    for (uint32_t cp = 0; cp < 0x30000; cp++) {
+      TEST_ASSERT_EQUAL_PTR(linearGetGlyph(data, cp), font.getGlyph(cp));
+    }
+  }
+}
+
+void test_lookup_without_table_matches_linear_scan() {
+  EpdFontData data = ubuntu_10;
+  data.latin1Lookup = nullptr;
+  const EpdFont font(&data);
+  for (uint32_t cp = 0; cp < 0x3000; cp++) {
+    TEST_ASSERT_EQUAL_PTR(linearGetGlyph(&data, cp), font.getGlyph(cp));
+  }
+}
+
+void test_benchmark_latin() { benchmark("Latin", LATIN); }
+void test_benchmark_accented() { benchmark("accented", ACCENTED); }
+void test_benchmark_cyrillic() { benchmark("Cyrillic", CYRILLIC); }
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_builtin_fonts_carry_latin1_table);
+  RUN_TEST(test_lookup_matches_linear_scan);
+  RUN_TEST(test_lookup_without_table_matches_linear_scan);
+  RUN_TEST(test_benchmark_latin);
+  RUN_TEST(test_benchmark_accented);
+  RUN_TEST(test_benchmark_cyrillic);
+  return UNITY_END();
+}
@@ -0,0 +1,239 @@
+#include <JpegToBmpConverter.h>
+#include <SD.h>
+#include <unity.h>
+
+#include <chrono>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Decodes the fixtures to 2-bit BMPs and checks the size and grey level of the result:
+// - stripes.jpg: 64x48 RGB 4:2:0, four 16px wide stripes at the four grey levels, black on the left
+// - progressive.jpg: the same image saved progressive, which picojpeg can't decode
+// - odd_gray.jpg: 37x23 single component, black above row 12 and white below, the edge MCUs are partial
+// - odd_color.jpg: 37x23 RGB 4:2:0, black left of column 20 and white right of it
+// - cover.jpg: an 800x1200 4:2:0 cover, only used to time the full and thumbnail decodes
+
+namespace {
+constexpr int BMP_HEADER_SIZE = 70;
+constexpr int BENCH_RUNS = 10;
+
+class NullPrint final : public Print {
+ public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, const size_t size) override { return size; }
+};
+
+class BufferPrint final : public Print {
+ public:
+  std::vector<uint8_t> data;
+  size_t write(const uint8_t c) override {
+    data.push_back(c);
+    return 1;
+  }
+};
+
+struct Bmp {
+  bool ok = false;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> data;
+
+  // Palette index, 0 is black and 3 is white
+  int level(const int x, const int y) const {
+    const int bytesPerRow = (width * 2 + 31) / 32 * 4;
+    const uint8_t byte = data[BMP_HEADER_SIZE + y * bytesPerRow + x / 4];
+    return byte >> (6 - (x % 4) * 2) & 0x03;
+  }
+};
+
+int32_t readInt32(const std::vector<uint8_t>& data, const size_t offset) {
+  return static_cast<int32_t>(data[offset] | data[offset + 1] << 8 | data[offset + 2] << 16 | data[offset + 3] << 24);
+}
+
+Bmp decode(const char* name, const int maxWidth, const int maxHeight, const bool thumbnail = false) {
+  Bmp bmp;
+  File file = SD.open((std::string("/") + name).c_str());
+  if (!file) {
+    return bmp;
+  }
+  BufferPrint out;
+  bmp.ok = thumbnail ? JpegToBmpConverter::jpegFileToThumbnailBmpStream(file, out, maxWidth, maxHeight)
+                     : JpegToBmpConverter::jpegFileToBmpStream(file, out, maxWidth, maxHeight);
+  file.close();
+  if (bmp.ok && out.data.size() >= BMP_HEADER_SIZE) {
+    bmp.width = readInt32(out.data, 18);
+    // Top-down BMPs store a negative height
+    bmp.height = -readInt32(out.data, 22);
+    bmp.data = std::move(out.data);
+  }
+  return bmp;
+}
+
+// Average milliseconds per decode, the output is thrown away
+double timeDecode(const char* name, const int maxWidth, const int maxHeight, const bool thumbnail) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    File file = SD.open((std::string("/") + name).c_str());
+    NullPrint out;
+    if (thumbnail) {
+      JpegToBmpConverter::jpegFileToThumbnailBmpStream(file, out, maxWidth, maxHeight);
+    } else {
+      JpegToBmpConverter::jpegFileToBmpStream(file, out, maxWidth, maxHeight);
+    }
+    file.close();
+  }
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / BENCH_RUNS;
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_baseline_full_size() {
+  const Bmp bmp = decode("stripes.jpg", 0, 0);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(64, bmp.width);
+  TEST_ASSERT_EQUAL(48, bmp.height);
+  TEST_ASSERT_EQUAL(BMP_HEADER_SIZE + 16 * 48, bmp.data.size());
+  for (const int y : {0, 24, 47}) {
+    for (int stripe = 0; stripe < 4; stripe++) {
+      TEST_ASSERT_EQUAL(stripe, bmp.level(stripe * 16 + 8, y));
+    }
+  }
+}
+
+void test_baseline_scaled_down() {
+  const Bmp bmp = decode("stripes.jpg", 32, 0);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(32, bmp.width);
+  TEST_ASSERT_EQUAL(24, bmp.height);
+  for (int stripe = 0; stripe < 4; stripe++) {
+    TEST_ASSERT_EQUAL(stripe, bmp.level(stripe * 8 + 4, 12));
+  }
+}
+
+void test_baseline_never_scaled_up() {
+  const Bmp bmp = decode("stripes.jpg", 480, 800);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(64, bmp.width);
+  TEST_ASSERT_EQUAL(48, bmp.height);
+}
+
+void test_thumbnail_is_one_pixel_per_block() {
+  const Bmp bmp = decode("stripes.jpg", 0, 0, true);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(8, bmp.width);
+  TEST_ASSERT_EQUAL(6, bmp.height);
+  for (int stripe = 0; stripe < 4; stripe++) {
+    TEST_ASSERT_EQUAL(stripe, bmp.level(stripe * 2, 3));
+    TEST_ASSERT_EQUAL(stripe, bmp.level(stripe * 2 + 1, 3));
+  }
+}
+
+void test_progressive_is_rejected() {
+  const Bmp bmp = decode("progressive.jpg", 0, 0);
+  TEST_ASSERT_FALSE(bmp.ok);
+}
+
+void test_odd_size_grayscale() {
+  const Bmp bmp = decode("odd_gray.jpg", 0, 0);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(37, bmp.width);
+  TEST_ASSERT_EQUAL(23, bmp.height);
+  TEST_ASSERT_EQUAL(BMP_HEADER_SIZE + 12 * 23, bmp.data.size());
+  for (const int x : {0, 18, 36}) {
+    TEST_ASSERT_EQUAL(0, bmp.level(x, 0));
+    TEST_ASSERT_EQUAL(0, bmp.level(x, 9));
+    TEST_ASSERT_EQUAL(3, bmp.level(x, 15));
+    TEST_ASSERT_EQUAL(3, bmp.level(x, 22));
+  }
+}
+
+void test_odd_size_color() {
+  const Bmp bmp = decode("odd_color.jpg", 0, 0);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(37, bmp.width);
+  TEST_ASSERT_EQUAL(23, bmp.height);
+  for (const int y : {0, 11, 22}) {
+    TEST_ASSERT_EQUAL(0, bmp.level(0, y));
+    TEST_ASSERT_EQUAL(0, bmp.level(16, y));
+    TEST_ASSERT_EQUAL(3, bmp.level(24, y));
+    TEST_ASSERT_EQUAL(3, bmp.level(36, y));
+  }
+}
+
+void test_odd_size_thumbnail_rounds_up() {
+  const Bmp bmp = decode("odd_gray.jpg", 0, 0, true);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(5, bmp.width);
+  TEST_ASSERT_EQUAL(3, bmp.height);
+  TEST_ASSERT_EQUAL(0, bmp.level(4, 0));
+  TEST_ASSERT_EQUAL(3, bmp.level(4, 2));
+}
+
+void test_read_size_from_header() {
+  for (const auto& [name, width, height] : {std::tuple<const char*, int, int>{"cover.jpg", 800, 1200},
+                                            {"stripes.jpg", 64, 48},
+                                            {"odd_gray.jpg", 37, 23},
+                                            {"progressive.jpg", 0, 0}}) {
+    File file = SD.open((std::string("/") + name).c_str());
+    int readWidth = 0;
+    int readHeight = 0;
+    TEST_ASSERT_TRUE(JpegToBmpConverter::readJpegSize(file, &readWidth, &readHeight));
+    file.close();
+    if (width > 0) {
+      TEST_ASSERT_EQUAL(width, readWidth);
+      TEST_ASSERT_EQUAL(height, readHeight);
+    }
+  }
+}
+
+void test_thumbnail_decode_only_when_it_fills() {
+  // The home screen box is 200x300, an 800x1200 cover only gives 100x150 at 1/8
+  TEST_ASSERT_FALSE(JpegToBmpConverter::thumbnailDecodeFills(800, 1200, 200, 300));
+  TEST_ASSERT_TRUE(JpegToBmpConverter::thumbnailDecodeFills(1600, 2400, 200, 300));
+  // Either side at 8 times the box is enough, the other side then scales down further
+  TEST_ASSERT_TRUE(JpegToBmpConverter::thumbnailDecodeFills(1600, 1000, 200, 300));
+  TEST_ASSERT_TRUE(JpegToBmpConverter::thumbnailDecodeFills(1000, 2400, 200, 300));
+  TEST_ASSERT_TRUE(JpegToBmpConverter::thumbnailDecodeFills(1600, 100, 200, 0));
+  TEST_ASSERT_FALSE(JpegToBmpConverter::thumbnailDecodeFills(1599, 2399, 200, 300));
+  // Without a box the full decode is wanted
+  TEST_ASSERT_FALSE(JpegToBmpConverter::thumbnailDecodeFills(4000, 4000, 0, 0));
+}
+
+// Sizes the reader uses for the sleep screen cover and the home screen thumbnail
+void test_report_decode_time() {
+  const Bmp thumb = decode("cover.jpg", 200, 300, true);
+  TEST_ASSERT_TRUE(thumb.ok);
+  TEST_ASSERT_EQUAL(100, thumb.width);
+  TEST_ASSERT_EQUAL(150, thumb.height);
+
+  const double fullMs = timeDecode("cover.jpg", 480, 800, false);
+  const double thumbMs = timeDecode("cover.jpg", 200, 300, true);
+  char message[128];
+  snprintf(message, sizeof(message), "800x1200 cover: full 480x800 %.1fms, thumbnail 200x300 %.1fms", fullMs, thumbMs);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(thumbMs < fullMs);
+}
+
+int main() {
+  const std::string path = __FILE__;
+  SD.root = path.substr(0, path.rfind('/')) + "/fixtures";
+  Serial.quiet = true;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_baseline_full_size);
+  RUN_TEST(test_baseline_scaled_down);
+  RUN_TEST(test_baseline_never_scaled_up);
+  RUN_TEST(test_thumbnail_is_one_pixel_per_block);
+  RUN_TEST(test_progressive_is_rejected);
+  RUN_TEST(test_odd_size_grayscale);
+  RUN_TEST(test_odd_size_color);
+  RUN_TEST(test_odd_size_thumbnail_rounds_up);
+  RUN_TEST(test_read_size_from_header);
+  RUN_TEST(test_thumbnail_decode_only_when_it_fills);
+  RUN_TEST(test_report_decode_time);
+  return UNITY_END();
+}
@@ -0,0 +1,174 @@
+#include <DitheredBmpWriter.h>
+#include <GfxRenderer.h>
+#include <PlaneBitmap.h>
+#include <SD.h>
+#include <unity.h>
+
+#include <vector>
+
+// Writes a BMP with the image converters' writer, splits it into planes and draws them, then checks every pixel of
+// the framebuffer in each render mode. The image is 13x21 so its last strip has padding rows, and it is drawn at a
+// top edge that isn't a multiple of 8.
+
+namespace {
+constexpr char CARD_DIR[] = "/tmp/test_plane_bitmap";
+constexpr char BMP_PATH[] = "/image.bmp";
+constexpr char PLANES_PATH[] = "/image.plb";
+constexpr int WIDTH = 13;
+constexpr int HEIGHT = 21;
+constexpr int DRAW_X = 5;
+constexpr int DRAW_Y = 19;
+// Rounded down to the strip the image starts in
+constexpr int DRAWN_Y = 16;
+
+EInkDisplay display;
+GfxRenderer renderer(display);
+
+// Panel level, 0 is black and 3 is white. Exactly 0, 85, 170 or 255, so dithering leaves it as is.
+int imageLevel(const int x, const int y) { return (x + 2 * y) % 4; }
+
+bool writeImage(const bool grey) {
+  File bmp = SD.open(BMP_PATH, FILE_WRITE);
+  DitheredBmpWriter writer(bmp, WIDTH, HEIGHT, 0, 0);
+  if (!writer.begin()) {
+    return false;
+  }
+  std::vector<uint8_t> row(WIDTH);
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      const int level = imageLevel(x, y);
+      row[x] = (grey ? level : (level / 2) * 3) * 85;
+    }
+    writer.writeRow(row.data());
+  }
+  bmp.close();
+
+  bmp = SD.open(BMP_PATH);
+  File planes = SD.open(PLANES_PATH, FILE_WRITE);
+  const bool success = PlaneBitmap::writeFromBmp(bmp, planes, nullptr);
+  planes.close();
+  bmp.close();
+  return success;
+}
+
+bool draw() {
+  File planes = SD.open(PLANES_PATH);
+  const bool success = PlaneBitmap::draw(renderer, planes, DRAW_X, DRAW_Y);
+  planes.close();
+  return success;
+}
+
+// Whether the framebuffer bit for a portrait pixel is set
+bool bitAt(const int x, const int y) {
+  const uint8_t* frameBuffer = renderer.getFrameBuffer();
+  const uint8_t byte =
+      frameBuffer[(EInkDisplay::DISPLAY_HEIGHT - 1 - x) * EInkDisplay::DISPLAY_WIDTH_BYTES + y / 8];
+  return byte >> (7 - y % 8) & 1;
+}
+
+template <typename Expected>
+void checkPlane(const Expected& expected) {
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL(expected(imageLevel(x, y)), bitAt(DRAW_X + x, DRAWN_Y + y));
+    }
+  }
+}
+}  // namespace
+
+void setUp() {
+  renderer.setRenderMode(GfxRenderer::BW);
+  renderer.clearScreen();
+}
+void tearDown() {}
+
+void test_header_records_grayscale() {
+  TEST_ASSERT_TRUE(writeImage(true));
+  File planes = SD.open(PLANES_PATH);
+  PlaneBitmap::Header header;
+  TEST_ASSERT_TRUE(PlaneBitmap::readHeader(planes, header));
+  planes.close();
+  TEST_ASSERT_EQUAL(WIDTH, header.width);
+  TEST_ASSERT_EQUAL(HEIGHT, header.height);
+  TEST_ASSERT_TRUE(header.hasGrayscale);
+
+  TEST_ASSERT_TRUE(writeImage(false));
+  planes = SD.open(PLANES_PATH);
+  TEST_ASSERT_TRUE(PlaneBitmap::readHeader(planes, header));
+  planes.close();
+  TEST_ASSERT_FALSE(header.hasGrayscale);
+}
+
+void test_bw_plane_top_row_first() {
+  TEST_ASSERT_TRUE(writeImage(true));
+  TEST_ASSERT_TRUE(draw());
+  // A set bit is white, only white pixels stay set in the BW pass
+  checkPlane([](const int level) { return level == 3; });
+
+  // The first strip's byte for column 0 holds rows 16 to 23, the image's rows 0 to 7 with row 0 in the top bit
+  uint8_t expected = 0;
+  for (int row = 0; row < 8; row++) {
+    expected |= (imageLevel(0, row) == 3) << (7 - row);
+  }
+  const uint8_t* frameBuffer = renderer.getFrameBuffer();
+  TEST_ASSERT_EQUAL(expected,
+                    frameBuffer[(EInkDisplay::DISPLAY_HEIGHT - 1 - DRAW_X) * EInkDisplay::DISPLAY_WIDTH_BYTES + 2]);
+}
+
+void test_strips_replace_whole_bytes() {
+  TEST_ASSERT_TRUE(writeImage(true));
+  renderer.clearScreen(0x00);
+  TEST_ASSERT_TRUE(draw());
+  checkPlane([](const int level) { return level == 3; });
+
+  // Padding below the last image row is written as white, columns either side are untouched
+  for (int y = DRAWN_Y + HEIGHT; y < DRAWN_Y + 24; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_TRUE(bitAt(DRAW_X + x, y));
+    }
+  }
+  for (int y = DRAWN_Y; y < DRAWN_Y + 24; y++) {
+    TEST_ASSERT_FALSE(bitAt(DRAW_X - 1, y));
+    TEST_ASSERT_FALSE(bitAt(DRAW_X + WIDTH, y));
+  }
+}
+
+void test_grayscale_planes() {
+  TEST_ASSERT_TRUE(writeImage(true));
+
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
+  TEST_ASSERT_TRUE(draw());
+  checkPlane([](const int level) { return level == 1; });
+
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+  TEST_ASSERT_TRUE(draw());
+  checkPlane([](const int level) { return level == 1 || level == 2; });
+}
+
+void test_no_grayscale_leaves_grey_passes_alone() {
+  TEST_ASSERT_TRUE(writeImage(false));
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+  TEST_ASSERT_TRUE(draw());
+  for (int y = DRAWN_Y; y < DRAWN_Y + 24; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_FALSE(bitAt(DRAW_X + x, y));
+    }
+  }
+}
+
+int main() {
+  SD.root = CARD_DIR;
+  Serial.quiet = true;
+  SD.mkdir("/");
+
+  UNITY_BEGIN();
+  RUN_TEST(test_header_records_grayscale);
+  RUN_TEST(test_bw_plane_top_row_first);
+  RUN_TEST(test_strips_replace_whole_bytes);
+  RUN_TEST(test_grayscale_planes);
+  RUN_TEST(test_no_grayscale_leaves_grey_passes_alone);
+  return UNITY_END();
+}
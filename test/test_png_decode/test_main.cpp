@@ -0,0 +1,131 @@
+#include <PngToBmpConverter.h>
+#include <SD.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+// Decodes the fixtures to 2-bit BMPs and checks every pixel's grey level. All of them are 20x10, split over two IDAT
+// chunks, and row y uses filter type y % 5, so each one goes through None, Sub, Up, Average and Paeth:
+// - gray8.png: 8-bit grey, level (x / 4 + y) % 4 at exactly 0, 85, 170 and 255
+// - rgb8.png: the same pattern as 8-bit RGB, the filters step over 3 bytes per pixel
+// - gray16_trns.png: the same pattern as 16-bit grey, the last column is the tRNS key and shows as white
+// - palette_trns.png: 4-bit palette, index (x / 4 + y) % 5 with entries black, dark, light, black made transparent
+//   through tRNS and white past the end of tRNS
+// - short_plte.png: a PLTE chunk that claims 4 entries and ends after 1
+
+namespace {
+constexpr int BMP_HEADER_SIZE = 70;
+constexpr int WIDTH = 20;
+constexpr int HEIGHT = 10;
+
+class BufferPrint final : public Print {
+ public:
+  std::vector<uint8_t> data;
+  size_t write(const uint8_t c) override {
+    data.push_back(c);
+    return 1;
+  }
+};
+
+struct Bmp {
+  bool ok = false;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> data;
+
+  // Palette index, 0 is black and 3 is white
+  int level(const int x, const int y) const {
+    const int bytesPerRow = (width * 2 + 31) / 32 * 4;
+    const uint8_t byte = data[BMP_HEADER_SIZE + y * bytesPerRow + x / 4];
+    return byte >> (6 - (x % 4) * 2) & 0x03;
+  }
+};
+
+int32_t readInt32(const std::vector<uint8_t>& data, const size_t offset) {
+  return static_cast<int32_t>(data[offset] | data[offset + 1] << 8 | data[offset + 2] << 16 | data[offset + 3] << 24);
+}
+
+Bmp decode(const char* name, const int maxWidth = 0, const int maxHeight = 0) {
+  Bmp bmp;
+  File file = SD.open((std::string("/") + name).c_str());
+  if (!file) {
+    return bmp;
+  }
+  BufferPrint out;
+  bmp.ok = PngToBmpConverter::pngStreamToBmpStream(file, out, maxWidth, maxHeight);
+  file.close();
+  if (bmp.ok && out.data.size() >= BMP_HEADER_SIZE) {
+    bmp.width = readInt32(out.data, 18);
+    // Top-down BMPs store a negative height
+    bmp.height = -readInt32(out.data, 22);
+    bmp.data = std::move(out.data);
+  }
+  return bmp;
+}
+
+int stripeLevel(const int x, const int y) { return (x / 4 + y) % 4; }
+
+template <typename Expected>
+void checkLevels(const char* name, const Expected& expected) {
+  const Bmp bmp = decode(name);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(WIDTH, bmp.width);
+  TEST_ASSERT_EQUAL(HEIGHT, bmp.height);
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL(expected(x, y), bmp.level(x, y));
+    }
+  }
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_gray8_every_filter() { checkLevels("gray8.png", stripeLevel); }
+
+void test_rgb8_every_filter() { checkLevels("rgb8.png", stripeLevel); }
+
+void test_gray16_with_transparent_key() {
+  checkLevels("gray16_trns.png", [](const int x, const int y) { return x == WIDTH - 1 ? 3 : stripeLevel(x, y); });
+}
+
+void test_palette_with_trns() {
+  // Index 3 is transparent black and index 4 white without a tRNS entry, both end up white
+  static constexpr int PALETTE_LEVELS[] = {0, 1, 2, 3, 3};
+  checkLevels("palette_trns.png", [](const int x, const int y) { return PALETTE_LEVELS[(x / 4 + y) % 5]; });
+}
+
+void test_scaled_down() {
+  const Bmp bmp = decode("gray8.png", WIDTH / 2, 0);
+  TEST_ASSERT_TRUE(bmp.ok);
+  TEST_ASSERT_EQUAL(WIDTH / 2, bmp.width);
+  TEST_ASSERT_EQUAL(HEIGHT / 2, bmp.height);
+}
+
+void test_short_palette_is_rejected() { TEST_ASSERT_FALSE(decode("short_plte.png").ok); }
+
+void test_inflate_needs_heap() {
+  const uint32_t freeHeap = ESP.freeHeap;
+  ESP.freeHeap = 40 * 1024;
+  const Bmp bmp = decode("gray8.png");
+  ESP.freeHeap = freeHeap;
+  TEST_ASSERT_FALSE(bmp.ok);
+}
+
+int main() {
+  const std::string path = __FILE__;
+  SD.root = path.substr(0, path.rfind('/')) + "/fixtures";
+  Serial.quiet = true;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_gray8_every_filter);
+  RUN_TEST(test_rgb8_every_filter);
+  RUN_TEST(test_gray16_with_transparent_key);
+  RUN_TEST(test_palette_with_trns);
+  RUN_TEST(test_scaled_down);
+  RUN_TEST(test_short_palette_is_rejected);
+  RUN_TEST(test_inflate_needs_heap);
+  return UNITY_END();
+}
@@ -0,0 +1,105 @@
+#include <GfxRenderer.h>
+#include <builtinFonts/ubuntu_10.h>
+#include <unity.h>
+
+#include <cstring>
+#include <vector>
+
+// GfxRenderer::readStrips and drawStrips, which the reader uses to keep its status bar as panel bytes. Strips read out
+// and drawn back have to give the same frame as drawing directly, including over content already on the page.
+
+namespace {
+constexpr int FONT_ID = 1;
+// Same rows as the reader's status bar
+constexpr int TOP = 776;
+constexpr int HEIGHT = 24;
+constexpr int LEFT = 10;
+constexpr int WIDTH = 460;
+
+EpdFont font(&ubuntu_10);
+EpdFontFamily fontFamily(&font);
+EInkDisplay display;
+GfxRenderer renderer(display);
+
+void drawStatus() {
+  renderer.fillRect(LEFT, TOP + 7, 15, 10);
+  renderer.drawText(FONT_ID, LEFT + 20, TOP, "84%");
+  renderer.drawText(FONT_ID, LEFT + 90, TOP, "Chapter Twelve: The Lighthouse");
+}
+
+// A text line whose descenders reach into the top rows of the status bar
+void drawContent() { renderer.fillRect(0, TOP - 4, GfxRenderer::getScreenWidth(), 6); }
+
+std::vector<uint8_t> frame() {
+  const uint8_t* frameBuffer = renderer.getFrameBuffer();
+  return std::vector<uint8_t>(frameBuffer, frameBuffer + GfxRenderer::getBufferSize());
+}
+}  // namespace
+
+void setUp() { renderer.clearScreen(); }
+void tearDown() {}
+
+void test_bit_order_is_top_row_first() {
+  renderer.drawPixel(LEFT + 3, TOP + 1);
+  renderer.drawPixel(LEFT + 3, TOP + 15);
+  std::vector<uint8_t> strips(WIDTH * HEIGHT / 8);
+  renderer.readStrips(LEFT, TOP, WIDTH, HEIGHT, strips.data());
+
+  // One column after another, a cleared bit is black and the most significant bit is the top row of the byte
+  TEST_ASSERT_EQUAL(0xBF, strips[3 * 3]);
+  TEST_ASSERT_EQUAL(0xFE, strips[3 * 3 + 1]);
+  TEST_ASSERT_EQUAL(0xFF, strips[3 * 3 + 2]);
+  TEST_ASSERT_EQUAL(0xFF, strips[4 * 3]);
+}
+
+void test_round_trip_restores_the_frame() {
+  drawContent();
+  drawStatus();
+  const auto expected = frame();
+
+  std::vector<uint8_t> strips(WIDTH * HEIGHT / 8);
+  renderer.readStrips(LEFT, TOP, WIDTH, HEIGHT, strips.data());
+  renderer.clearScreen();
+  drawContent();
+  renderer.drawStrips(LEFT, TOP, WIDTH, HEIGHT, strips.data(), false);
+  TEST_ASSERT_TRUE(frame() == expected);
+}
+
+void test_black_only_keeps_what_is_underneath() {
+  drawContent();
+  drawStatus();
+  const auto expected = frame();
+
+  renderer.clearScreen();
+  drawStatus();
+  std::vector<uint8_t> strips(WIDTH * HEIGHT / 8);
+  renderer.readStrips(LEFT, TOP, WIDTH, HEIGHT, strips.data());
+  renderer.clearScreen();
+  drawContent();
+  renderer.drawStrips(LEFT, TOP, WIDTH, HEIGHT, strips.data(), true);
+  TEST_ASSERT_TRUE(frame() == expected);
+}
+
+void test_off_screen_columns_are_skipped() {
+  const auto expected = frame();
+  std::vector<uint8_t> strips(WIDTH * HEIGHT / 8, 0x00);
+  renderer.drawStrips(GfxRenderer::getScreenWidth(), TOP, WIDTH, HEIGHT, strips.data(), false);
+  TEST_ASSERT_TRUE(frame() == expected);
+
+  renderer.readStrips(-WIDTH, TOP, WIDTH, HEIGHT, strips.data());
+  for (const uint8_t byte : strips) {
+    TEST_ASSERT_EQUAL(0xFF, byte);
+  }
+}
+
+int main() {
+  Serial.quiet = true;
+  renderer.insertFont(FONT_ID, fontFamily);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_bit_order_is_top_row_first);
+  RUN_TEST(test_round_trip_restores_the_frame);
+  RUN_TEST(test_black_only_keeps_what_is_underneath);
+  RUN_TEST(test_off_screen_columns_are_skipped);
+  return UNITY_END();
+}
@@ -0,0 +1,299 @@
+#include <Epub/parsers/XhtmlTokenizer.h>
+#include <HardwareSerial.h>
+#include <expat.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Tokenizes a generated chapter with XhtmlTokenizer and with expat, fed the way ChapterHtmlSlimParser feeds them,
+// then reports the throughput and heap of each. Element and text counts have to agree for the numbers to compare.
+// The broken markup cases run the tokenizer with small buffers so comments, CDATA ends and tags cross buffer refills.
+
+namespace {
+constexpr int CHAPTER_PARAGRAPHS = 3000;
+constexpr int BENCH_RUNS = 10;
+// ChapterHtmlSlimParser::parseWithExpat reads the file in blocks of this size
+constexpr size_t EXPAT_READ_SIZE = 1024;
+// XhtmlTokenizer's default read buffer, what the parser uses
+constexpr size_t TOKENIZER_BUFFER_SIZE = 2048;
+// Small enough for the broken markup cases to cross refills, large enough for ensureAvailable(9)
+constexpr size_t SMALL_BUFFER_SIZE = 32;
+
+class MemoryStream final : public Stream {
+  const std::string& data;
+  size_t position = 0;
+
+ public:
+  explicit MemoryStream(const std::string& data) : data(data) {}
+  int available() override { return static_cast<int>(data.size() - position); }
+  int read() override { return position < data.size() ? static_cast<uint8_t>(data[position++]) : -1; }
+  int peek() override { return position < data.size() ? static_cast<uint8_t>(data[position]) : -1; }
+  size_t readBytes(char* buffer, const size_t length) override {
+    const size_t count = std::min(length, data.size() - position);
+    memcpy(buffer, data.data() + position, count);
+    position += count;
+    return count;
+  }
+  size_t write(uint8_t) override { return 0; }
+};
+
+struct Counts {
+  int startTags = 0;
+  int endTags = 0;
+  size_t textBytes = 0;
+};
+
+// Only entities expat knows without a DTD, so both sides see the same document
+std::string makeChapter() {
+  std::string chapter =
+      "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+      "<html xmlns=\"http://www.w3.org/1999/xhtml\"><head><title>Chapter</title>"
+      "<link rel=\"stylesheet\" type=\"text/css\" href=\"style.css\"/></head><body>\n"
+      "<h2 class=\"chapter\" id=\"c1\">Chapter One</h2>\n";
+  for (int i = 0; i < CHAPTER_PARAGRAPHS; i++) {
+    chapter += "<p class=\"indent\">It was a dark and stormy night; the rain fell in torrents &#8212; except at "
+               "occasional intervals, when it was checked by a <em>violent gust</em> of wind which swept up the "
+               "streets &amp; rattled along the housetops.</p>\n";
+    if (i % 50 == 49) {
+      chapter += "<div class=\"break\"><img src=\"images/rule.png\" alt=\"\"/></div><br/>\n";
+    }
+  }
+  chapter += "</body></html>\n";
+  return chapter;
+}
+
+Counts tokenize(const std::string& chapter) {
+  Counts counts;
+  MemoryStream input(chapter);
+  XhtmlTokenizer tokenizer(input, TOKENIZER_BUFFER_SIZE);
+  if (!tokenizer.begin()) {
+    return counts;
+  }
+  for (auto token = tokenizer.next(); token != XhtmlTokenizer::TOKEN_END; token = tokenizer.next()) {
+    if (token == XhtmlTokenizer::TOKEN_START_TAG) {
+      counts.startTags++;
+    } else if (token == XhtmlTokenizer::TOKEN_END_TAG) {
+      counts.endTags++;
+    } else {
+      counts.textBytes += tokenizer.getText().size();
+    }
+  }
+  return counts;
+}
+
+// Expat allocations go through these so the peak can be read back
+size_t expatHeap = 0;
+size_t expatPeakHeap = 0;
+
+void* expatMalloc(const size_t size) {
+  auto* block = static_cast<size_t*>(malloc(size + sizeof(size_t)));
+  if (!block) {
+    return nullptr;
+  }
+  *block = size;
+  expatHeap += size;
+  expatPeakHeap = std::max(expatPeakHeap, expatHeap);
+  return block + 1;
+}
+
+void expatFree(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  auto* block = static_cast<size_t*>(ptr) - 1;
+  expatHeap -= *block;
+  free(block);
+}
+
+void* expatRealloc(void* ptr, const size_t size) {
+  if (!ptr) {
+    return expatMalloc(size);
+  }
+  auto* block = static_cast<size_t*>(ptr) - 1;
+  const size_t oldSize = *block;
+  block = static_cast<size_t*>(realloc(block, size + sizeof(size_t)));
+  if (!block) {
+    return nullptr;
+  }
+  *block = size;
+  expatHeap = expatHeap - oldSize + size;
+  expatPeakHeap = std::max(expatPeakHeap, expatHeap);
+  return block + 1;
+}
+
+const XML_Memory_Handling_Suite expatMemory = {expatMalloc, expatRealloc, expatFree};
+
+void XMLCALL expatStart(void* userData, const XML_Char*, const XML_Char**) {
+  static_cast<Counts*>(userData)->startTags++;
+}
+
+void XMLCALL expatEnd(void* userData, const XML_Char*) { static_cast<Counts*>(userData)->endTags++; }
+
+void XMLCALL expatText(void* userData, const XML_Char*, const int len) {
+  static_cast<Counts*>(userData)->textBytes += len;
+}
+
+Counts parseExpat(const std::string& chapter) {
+  Counts counts;
+  const XML_Parser parser = XML_ParserCreate_MM(nullptr, &expatMemory, nullptr);
+  if (!parser) {
+    return counts;
+  }
+  XML_SetUserData(parser, &counts);
+  XML_SetElementHandler(parser, expatStart, expatEnd);
+  XML_SetCharacterDataHandler(parser, expatText);
+
+  for (size_t position = 0; position < chapter.size();) {
+    void* const buf = XML_GetBuffer(parser, EXPAT_READ_SIZE);
+    if (!buf) {
+      break;
+    }
+    const size_t len = std::min(EXPAT_READ_SIZE, chapter.size() - position);
+    memcpy(buf, chapter.data() + position, len);
+    position += len;
+    if (XML_ParseBuffer(parser, static_cast<int>(len), position == chapter.size()) == XML_STATUS_ERROR) {
+      counts = Counts();
+      break;
+    }
+  }
+  XML_ParserFree(parser);
+  return counts;
+}
+
+// Tokens written back as markup, adjacent text tokens run together as they may be split at any buffer refill
+std::string trace(const std::string& markup, const size_t bufferSize = SMALL_BUFFER_SIZE) {
+  MemoryStream input(markup);
+  XhtmlTokenizer tokenizer(input, bufferSize);
+  if (!tokenizer.begin()) {
+    return "";
+  }
+  std::string out;
+  for (auto token = tokenizer.next(); token != XhtmlTokenizer::TOKEN_END; token = tokenizer.next()) {
+    if (token == XhtmlTokenizer::TOKEN_START_TAG) {
+      out += "<" + std::string(tokenizer.getName()) + ">";
+    } else if (token == XhtmlTokenizer::TOKEN_END_TAG) {
+      out += "</" + std::string(tokenizer.getName()) + ">";
+    } else {
+      out += tokenizer.getText();
+    }
+  }
+  return out;
+}
+
+// Megabytes of markup per second
+template <typename ParseFn>
+double megabytesPerSecond(const std::string& chapter, ParseFn parse) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    parse(chapter);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return chapter.size() * static_cast<double>(BENCH_RUNS) / elapsed.count() / 1e6;
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_both_backends_see_the_same_document() {
+  const std::string chapter = makeChapter();
+  const Counts tokens = tokenize(chapter);
+  const Counts expat = parseExpat(chapter);
+  TEST_ASSERT_TRUE(tokens.startTags > CHAPTER_PARAGRAPHS * 2);
+  TEST_ASSERT_EQUAL(expat.startTags, tokens.startTags);
+  TEST_ASSERT_EQUAL(expat.endTags, tokens.endTags);
+  TEST_ASSERT_EQUAL(tokens.startTags, tokens.endTags);
+}
+
+void test_stray_end_tag_is_dropped() {
+  TEST_ASSERT_EQUAL_STRING("<p>one two</p>", trace("<p>one</b> two</p></span>").c_str());
+}
+
+void test_bare_less_than_is_text() {
+  TEST_ASSERT_EQUAL_STRING("<p>1 < 2 and 3<4 <</p>", trace("<p>1 < 2 and 3<4 <</p>").c_str());
+}
+
+void test_open_elements_are_closed() {
+  // At the end of the input, by an end tag that skips over them, and after a tag cut off by the end of the input
+  TEST_ASSERT_EQUAL_STRING("<div><p>text</p></div>", trace("<div><p>text").c_str());
+  TEST_ASSERT_EQUAL_STRING("<div><p><i>text</i></p></div>after", trace("<div><p><i>text</div>after").c_str());
+  TEST_ASSERT_EQUAL_STRING("<p>text</p>", trace("<p>text<span class=\"cut").c_str());
+}
+
+void test_comment_and_cdata_across_refills() {
+  const std::string markup =
+      "<p>before<!-- a comment -- with dashes -> and a > inside -->middle<![CDATA[a <b> ]] ] c]]>after</p>";
+  // Every buffer size moves the refill to a different spot in the comment, its end and the CDATA end
+  for (size_t bufferSize = 12; bufferSize <= markup.size() + 1; bufferSize++) {
+    TEST_ASSERT_EQUAL_STRING("<p>beforemiddlea <b> ]] ] cafter</p>", trace(markup, bufferSize).c_str());
+  }
+}
+
+void test_tag_longer_than_buffer_is_dropped() {
+  const std::string markup = "<p>a<img src=\"" + std::string(SMALL_BUFFER_SIZE * 3, 'x') + ".png\"/>b</p>";
+  TEST_ASSERT_EQUAL_STRING("<p>ab</p>", trace(markup).c_str());
+}
+
+void test_nesting_past_the_limit_stays_balanced() {
+  constexpr int depth = XhtmlTokenizer::MAX_OPEN_ELEMENTS + 6;
+  std::string markup;
+  for (int i = 0; i < depth; i++) {
+    markup += "<div>";
+  }
+  markup += "x";
+  for (int i = 0; i < depth; i++) {
+    markup += "</div>";
+  }
+
+  // Elements past the limit are treated as empty and the end tags left over for them are dropped
+  std::string expected;
+  for (int i = 0; i < XhtmlTokenizer::MAX_OPEN_ELEMENTS; i++) {
+    expected += "<div>";
+  }
+  for (int i = XhtmlTokenizer::MAX_OPEN_ELEMENTS; i < depth; i++) {
+    expected += "<div></div>";
+  }
+  expected += "x";
+  for (int i = 0; i < XhtmlTokenizer::MAX_OPEN_ELEMENTS; i++) {
+    expected += "</div>";
+  }
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), trace(markup).c_str());
+}
+
+void test_report_throughput_and_heap() {
+  const std::string chapter = makeChapter();
+  const double tokenizerRate = megabytesPerSecond(chapter, tokenize);
+  const double expatRate = megabytesPerSecond(chapter, parseExpat);
+
+  // The tokenizer allocates its read buffer and open element names once in begin() and nothing after
+  const size_t tokenizerHeap =
+      sizeof(XhtmlTokenizer) + TOKENIZER_BUFFER_SIZE + XhtmlTokenizer::OPEN_ELEMENT_NAMES_SIZE;
+  expatPeakHeap = 0;
+  parseExpat(chapter);
+
+  char message[192];
+  snprintf(message, sizeof(message),
+           "%zu KB chapter: tokenizer %.1f MB/s, %zu bytes heap; expat %.1f MB/s, %zu bytes peak heap",
+           chapter.size() / 1024, tokenizerRate, tokenizerHeap, expatRate, expatPeakHeap);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(tokenizerHeap < expatPeakHeap);
+}
+
+int main() {
+  Serial.quiet = true;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_both_backends_see_the_same_document);
+  RUN_TEST(test_stray_end_tag_is_dropped);
+  RUN_TEST(test_bare_less_than_is_text);
+  RUN_TEST(test_open_elements_are_closed);
+  RUN_TEST(test_comment_and_cdata_across_refills);
+  RUN_TEST(test_tag_longer_than_buffer_is_dropped);
+  RUN_TEST(test_nesting_past_the_limit_stays_balanced);
+  RUN_TEST(test_report_throughput_and_heap);
+  return UNITY_END();
+}